@@ -0,0 +1,149 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    broker.h
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 16:35:12
+*   @brief:   多进程分片部署
+*
+*   每个 main 进程(ShardServer)只加载一个分片的索引(INDEX_PARTITION_NUM/INDEX_PARTITION_ID),
+*   监听一个 unix socket; Broker 将 query 转发给所有分片, 按得分归并各分片的 top-k.
+*   每个分片可以有多个副本进程, 先发给第一个副本, 超过 BROKER_HEDGE_DELAY_MS 未返回时
+*   再发给下一个副本(hedged request), 取先返回的结果.
+*
+*   协议(文本, 按行):
+*     请求: query\n
+*     响应: n\n 后跟 n 行 score\ttitle\turl\n
+*
+*****************************************************************/
+
+#ifndef __BROKER_H_
+#define __BROKER_H_
+
+#include "common.h"
+#include "log_util.h"
+#include "str_util.h"
+#include "time_util.h"
+#include "config_util.h"
+#include "socket_util.h"
+#include "table.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <csignal>
+
+namespace tiny_engine {
+
+// 分片返回的一个结果
+class ShardDoc {
+public:
+    ShardDoc(float s = 0.0,
+            const std::string &t = std::string(),
+            const std::string &u = std::string()) :
+        score(s), title(t), url(u) {}
+public:
+    float score;
+    std::string title;
+    std::string url;
+};
+
+class ShardProtocol {
+public:
+    static std::string encode_request(const std::string &query);
+    static std::string encode_response(const std::vector<ShardDoc> &docs);
+    /**
+     * @brief 解析响应, 数据可能不完整
+     * @param[out] is_complete: 是否已收到完整响应, 为 true 时 docs 有效
+     * @return 格式错误时返回 false
+     */
+    static bool decode_response(const std::string &buf,
+            std::vector<ShardDoc> &docs,
+            bool &is_complete);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ShardProtocol);
+
+private:
+    ShardProtocol();
+};
+
+/**
+ * @brief 分片进程: 在 unix socket 上接收 query, 用本进程的 TinyEngine 检索
+ */
+class ShardServer {
+public:
+    using IDLE_TIMEOUT_MS = std::integral_constant<int, 60000>;
+
+    explicit ShardServer(TinyEngine* engine);
+
+    /**
+     * @brief 监听 socket_path 直到 stop() 被调用, 返回前等待所有连接处理完
+     */
+    bool run(const std::string &socket_path);
+    // 可在信号处理函数中调用
+    static void stop();
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ShardServer);
+
+    void _handle_conn(int fd);
+
+private:
+    TinyEngine* engine;
+    std::mutex conn_mutex;
+    std::unordered_set<int> conn_fds; // 处理中的连接, 退出时 shutdown 以唤醒阻塞的读
+    static volatile sig_atomic_t is_stopped;
+};
+
+class Broker {
+public:
+    using MAX_RESULT_NUM = std::integral_constant<int, 20>;
+    using HEDGE_DELAY_MS = std::integral_constant<int, 50>;
+    using TIMEOUT_MS = std::integral_constant<int, 1000>;
+
+    Broker(const std::string &config = "./conf/broker.conf");
+
+    bool init();
+
+    /**
+     * @brief 转发给所有分片并归并结果, 按得分降序, 同一 url 只保留一个
+     * @return 所有分片都失败时返回 false; 部分分片超时时返回其余分片的结果
+     */
+    bool search(const std::string &query, std::vector<ShardDoc> &result);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(Broker);
+
+    // 发往某个分片某个副本的一次请求
+    struct ShardCall {
+        int fd;
+        std::size_t shard_idx;
+        std::string buf; // 已收到的响应
+        std::vector<ShardDoc> docs; // 从 buf 解析出的结果, 完整时才作为该分片的结果
+    };
+
+    /**
+     * @brief 向分片的下一个副本发送请求, 连接失败时继续尝试后面的副本
+     * @return 没有可用副本时返回 false
+     */
+    bool _call_next_replica(const std::string &request,
+            std::size_t shard_idx,
+            std::vector<std::size_t> &next_replica,
+            std::vector<ShardCall> &calls);
+
+private:
+    std::shared_ptr<ConfigUtil> configs;
+    // 每个分片的副本 socket 路径, 按优先级排列
+    std::vector<std::vector<std::string>> shard_sockets;
+    int hedge_delay_ms;
+    int timeout_ms;
+    int max_result_num;
+};
+
+}; // end of namespace tiny_engine
+#endif // __BROKER_H_
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -32,6 +32,10 @@ public:
     bool get_value(const std::string &key, float &value) const;
     bool get_value(const std::string &key, double &value) const;
     bool get_value(const std::string &key, std::string &value) const;
+    /**
+     * @brief 覆盖配置项(如命令行参数), init 之前或之后调用均生效
+     */
+    void set_value(const std::string &key, const std::string &value);
 
 private:
     DISALLOW_COPY_AND_ASSIGN(ConfigUtil);
@@ -39,6 +43,7 @@ private:
 private:
     std::string config_file;
     std::unordered_map<std::string, std::string> config_map;
+    std::unordered_map<std::string, std::string> override_map;
 };
 
 }; // end of namespace tiny_engine
@@ -14,62 +14,110 @@
 
 #include "math_util.h"
 #include "log_util.h"
-#include <unordered_map>
 #include <string>
+#include <bitset>
 
 namespace tiny_engine {
+
+/**
+ * @brief 引擎计算的所有特征, 名字与 conf/feature.conf 一致; 新增特征在此追加
+ *        conf/feature.conf 只决定模型输入的列, 不影响特征 id
+ */
+#define TINY_ENGINE_FEATURES(XX) \
+    XX(F_Q_LEN) \
+    XX(F_Q_TERM_CNT) \
+    XX(F_U_LEN) \
+    XX(F_U_TERM_CNT) \
+    XX(F_QU_STR_LEN_CQR) \
+    XX(F_QU_STR_LEN_CTR) \
+    XX(F_QU_STR_LEN_COVERAGE) \
+    XX(F_QU_TERM_WEI_CQR) \
+    XX(F_QU_TERM_WEI_CTR) \
+    XX(F_QU_TERM_WEI_COVERAGE) \
+    XX(F_QU_TERM_CNT_CQR) \
+    XX(F_QU_TERM_CNT_CTR) \
+    XX(F_QU_TERM_CNT_COVERAGE) \
+    XX(F_QU_TERM_LCSTR) \
+    XX(F_QU_TERM_LCSTR_OVER_Q) \
+    XX(F_QU_TERM_LCSTR_OVER_U) \
+    XX(F_QU_TERM_LCSEQ) \
+    XX(F_QU_TERM_LCSEQ_OVER_Q) \
+    XX(F_QU_TERM_LCSEQ_OVER_U) \
+    XX(F_QU_TERM_EDIST) \
+    XX(F_QU_TERM_EDIST_OVER_Q) \
+    XX(F_QU_TERM_EDIST_OVER_U) \
+    XX(F_QU_STR_LCSTR) \
+    XX(F_QU_STR_LCSTR_OVER_Q) \
+    XX(F_QU_STR_LCSTR_OVER_U) \
+    XX(F_QU_STR_LCSEQ) \
+    XX(F_QU_STR_LCSEQ_OVER_Q) \
+    XX(F_QU_STR_LCSEQ_OVER_U) \
+    XX(F_QU_STR_EDIST) \
+    XX(F_QU_STR_EDIST_OVER_Q) \
+    XX(F_QU_STR_EDIST_OVER_U) \
+    XX(F_QU_EXTRA) \
+    XX(F_QU_MISS) \
+    XX(F_QU_DISORDER) \
+    XX(F_QU_PROXIMITY) \
+    XX(F_QU_VSM) \
+    XX(F_QU_BM25) \
+    XX(F_QU_HIT_TERM_CNT) \
+    XX(F_QU_HIT_DIVERSITY)
+
+enum FEATURE_ID {
+#define TINY_ENGINE_FEATURE_ID(name) name,
+    TINY_ENGINE_FEATURES(TINY_ENGINE_FEATURE_ID)
+#undef TINY_ENGINE_FEATURE_ID
+    FEATURE_NUM
+};
+
+/**
+ * @brief 一个候选 doc 的特征, 按 FEATURE_ID 存在定长数组中, 未设置的特征视为 missing
+ *        特征名只用于加载 feature map 及调试输出
+ */
 class FeatureMgr {
 public:
-    FeatureMgr() {}
+    FeatureMgr();
 
     void init();
 
-    // only suitable for float, int, double, Type
+    // only suitable for float, int, double, Type; 浮点数保留 3 位有效数字
     template <typename Type>
-    void add_feature(const std::string &key, Type value);
-    
-    template <typename Type>
-    void add_feature(const std::string &&key, Type value);
+    void add_feature(FEATURE_ID fid, Type value);
 
     template <typename Type>
-    bool get_feature(const std::string &key, Type &value) const;
+    bool get_feature(FEATURE_ID fid, Type &value) const;
 
-    template <typename Type>
-    bool get_feature(const std::string &&key, Type &value) const;
+    bool has_feature(FEATURE_ID fid) const { return value_mask.test(fid); }
+    // 按 FEATURE_ID 下标, 未设置的特征值为 0
+    const float* values() const { return value_arr; }
 
     std::string to_str() const;
     bool is_empty() const;
-    std::unordered_map<std::string, float> get_features() const;
 
-public:
-    std::unordered_map<std::string, float> name_value_map; // fname : fvalue
-};
+    static const char* get_name(FEATURE_ID fid);
+    static bool get_id(const std::string &name, FEATURE_ID &fid);
 
-template <typename Type>
-void FeatureMgr::add_feature(const std::string &key, Type value) {
-    name_value_map[key] = static_cast<float>(MathUtil::round(value, 3));
-}
+private:
+    float value_arr[FEATURE_NUM];
+    std::bitset<FEATURE_NUM> value_mask; // 已设置的特征
+};
 
 template <typename Type>
-void FeatureMgr::add_feature(const std::string &&key, Type value) {
-    name_value_map[key] = static_cast<float>(MathUtil::round(value, 3));
+void FeatureMgr::add_feature(FEATURE_ID fid, Type value) {
+    value_arr[fid] = static_cast<float>(MathUtil::round(value, 3));
+    value_mask.set(fid);
 }
 
 template <typename Type>
-bool FeatureMgr::get_feature(const std::string &key, Type &value) const {
-    auto iter = name_value_map.find(key);
-    if (iter != name_value_map.end()) {
-        value = iter->second;
+bool FeatureMgr::get_feature(FEATURE_ID fid, Type &value) const {
+    if (value_mask.test(fid)) {
+        value = value_arr[fid];
         return true;
     }
     return false;
 }
 
-template <typename Type>
-bool FeatureMgr::get_feature(const std::string &&key, Type &value) const {
-    return get_feature(key, value);
-}
-
 }; // end of namespace tiny_engine
 #endif // __FEATURE_MGR_H_
 /* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
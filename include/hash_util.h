@@ -0,0 +1,68 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    hash_util.h
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 23:41:26
+*   @brief:   稳定的 64 位字符串哈希, 用于 doc/term 签名
+*
+*   算法为 XXH64(https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md),
+*   结果与官方实现一致, 按小端读取输入, 与编译器/标准库/机器字节序无关,
+*   签名可以落盘或在进程之间传递. 算法或种子有改动时, 需要升级 INDEX_FILE_VERSION
+*
+*****************************************************************/
+
+#ifndef __HASH_UTIL_H_
+#define __HASH_UTIL_H_
+
+#include "common.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tiny_engine {
+
+class HashUtil {
+public:
+    // 签名使用的种子
+    using SIGN_SEED = std::integral_constant<uint64_t, 0>;
+
+    static uint64_t hash64(const char* data, std::size_t len, uint64_t seed = SIGN_SEED::value);
+    static uint64_t hash64(const std::string &str, uint64_t seed = SIGN_SEED::value);
+    /**
+     * @brief 批量计算, 结果与逐个调用 hash64 相同, 用于一个 title/query 的所有切词
+     *        相邻串之间没有数据依赖, 乱序执行已能重叠各串的乘法链; 多个短串交错/无分支计算
+     *        实测反而更慢(长度不同导致的分支及补齐开销), 所以逐个计算
+     */
+    static void hash64(const std::vector<std::string> &strs,
+            std::vector<uint64_t> &hashes,
+            uint64_t seed = SIGN_SEED::value);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(HashUtil);
+
+    using PRIME64_1 = std::integral_constant<uint64_t, 0x9E3779B185EBCA87ULL>;
+    using PRIME64_2 = std::integral_constant<uint64_t, 0xC2B2AE3D27D4EB4FULL>;
+    using PRIME64_3 = std::integral_constant<uint64_t, 0x165667B19E3779F9ULL>;
+    using PRIME64_4 = std::integral_constant<uint64_t, 0x85EBCA77C2B2AE63ULL>;
+    using PRIME64_5 = std::integral_constant<uint64_t, 0x27D4EB2F165667C5ULL>;
+    // 不短于 STRIPE_LEN 的输入按 4 路累加器处理
+    using STRIPE_LEN = std::integral_constant<std::size_t, 32>;
+
+    static uint64_t _read64(const char* ptr);
+    static uint32_t _read32(const char* ptr);
+    static uint64_t _rotl(uint64_t value, int bits);
+    static uint64_t _round(uint64_t acc, uint64_t input);
+    static uint64_t _merge_round(uint64_t acc, uint64_t value);
+    static uint64_t _avalanche(uint64_t hash);
+    // 处理不足 STRIPE_LEN 的尾部并 avalanche
+    static uint64_t _finalize(uint64_t hash, const char* ptr, std::size_t len);
+
+private:
+    HashUtil();
+    ~HashUtil();
+};
+
+}; // end of namespace tiny_engine
+#endif // __HASH_UTIL_H_
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,199 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    index_io.h
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 10:12:36
+*   @brief:   二进制索引文件读写: 写端顺序写 ofstream, 读端 mmap 整个文件后按游标解析
+*
+*   文件布局(小端, 与机器字节序一致, 不跨端使用):
+*       IndexFileHeader | body
+*   body 由 Table 负责组织, 这里只提供定长字段/字符串/数组的编解码
+*
+*****************************************************************/
+
+#ifndef __INDEX_IO_H_
+#define __INDEX_IO_H_
+
+#include "common.h"
+#include "log_util.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <type_traits>
+
+namespace tiny_engine {
+
+// 索引文件魔数及版本号, 格式有不兼容改动时 version + 1; 签名算法(HashUtil)变化时同样需要 + 1
+#define INDEX_FILE_MAGIC "TINYIDX"
+#define INDEX_FILE_VERSION 7
+
+enum INDEX_FILE_TYPE {
+    FWD_INDEX_FILE = 1,
+    INV_INDEX_FILE = 2
+};
+
+struct IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t file_type; // INDEX_FILE_TYPE
+    uint64_t item_cnt; // 正排为doc数, 倒排为term数
+    uint64_t doc_cnt; // 建库时的正排大小, 用于校验正排/倒排是否配套
+    uint64_t src_size; // 原始数据文件(INDEX_FILE)大小, 用于判断索引是否过期
+    uint64_t src_mtime; // 原始数据文件修改时间
+    uint64_t body_size; // header 之后的字节数
+};
+
+/**
+ * @brief 只读 mmap 文件, 析构时自动 munmap
+ */
+class MmapFile {
+public:
+    MmapFile();
+    ~MmapFile();
+
+    bool open(const std::string &path);
+    void close();
+
+    const char* data() const;
+    std::size_t size() const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(MmapFile);
+
+private:
+    int fd;
+    char* addr;
+    std::size_t length;
+};
+
+/**
+ * @brief 顺序写二进制文件, 先写到 path.tmp, commit() 时 rename 成正式文件, 避免写一半的文件被加载
+ */
+class BinaryWriter {
+public:
+    explicit BinaryWriter(const std::string &path);
+    ~BinaryWriter();
+
+    bool is_open() const;
+
+    template <typename Type>
+    void write_pod(const Type &value);
+
+    void write_str(const std::string &str);
+
+    template <typename Type>
+    void write_vec(const std::vector<Type> &vec);
+
+    // 在文件头部回填 header
+    bool write_header(const IndexFileHeader &header);
+    uint64_t get_body_size() const;
+    bool commit();
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(BinaryWriter);
+
+private:
+    std::string file_path;
+    std::string tmp_path;
+    std::ofstream ofs;
+    uint64_t body_size;
+};
+
+/**
+ * @brief mmap 内存上的只读游标, 所有读操作都做越界检查, 越界后 ok() 返回 false
+ */
+class BinaryReader {
+public:
+    BinaryReader(const char* data, std::size_t size);
+
+    template <typename Type>
+    bool read_pod(Type &value);
+
+    bool read_str(std::string &str);
+
+    template <typename Type>
+    bool read_vec(std::vector<Type> &vec);
+
+    bool ok() const;
+    std::size_t remain() const;
+
+private:
+    bool _check(std::size_t bytes);
+
+private:
+    const char* cursor;
+    const char* end;
+    bool is_ok;
+};
+
+class IndexIO {
+public:
+    static void init_header(INDEX_FILE_TYPE type, IndexFileHeader &header);
+    /**
+     * @brief 校验 header 的魔数、版本号及文件类型
+     */
+    static bool check_header(const IndexFileHeader &header,
+            INDEX_FILE_TYPE type,
+            std::size_t file_size);
+    /**
+     * @brief 获取原始数据文件的大小及修改时间, 文件不存在时返回 false
+     */
+    static bool get_src_stat(const std::string &path, uint64_t &size, uint64_t &mtime);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(IndexIO);
+
+private:
+    IndexIO();
+    ~IndexIO();
+};
+
+// -----------------------------------------------------------
+
+template <typename Type>
+void BinaryWriter::write_pod(const Type &value) {
+    static_assert(std::is_trivially_copyable<Type>::value, "pod type required");
+    ofs.write(reinterpret_cast<const char*>(&value), sizeof(Type));
+    body_size += sizeof(Type);
+}
+
+template <typename Type>
+void BinaryWriter::write_vec(const std::vector<Type> &vec) {
+    static_assert(std::is_trivially_copyable<Type>::value, "pod type required");
+    write_pod(static_cast<uint32_t>(vec.size()));
+    if (!vec.empty()) {
+        ofs.write(reinterpret_cast<const char*>(vec.data()), sizeof(Type) * vec.size());
+        body_size += sizeof(Type) * vec.size();
+    }
+}
+
+template <typename Type>
+bool BinaryReader::read_pod(Type &value) {
+    static_assert(std::is_trivially_copyable<Type>::value, "pod type required");
+    EXPECT_TRUE_OR_RETURN(_check(sizeof(Type)), false);
+    memcpy(&value, cursor, sizeof(Type));
+    cursor += sizeof(Type);
+    return true;
+}
+
+template <typename Type>
+bool BinaryReader::read_vec(std::vector<Type> &vec) {
+    static_assert(std::is_trivially_copyable<Type>::value, "pod type required");
+    uint32_t cnt = 0;
+    EXPECT_TRUE_OR_RETURN(read_pod(cnt), false);
+    EXPECT_TRUE_OR_RETURN(_check(sizeof(Type) * cnt), false);
+    vec.resize(cnt);
+    if (cnt > 0) {
+        memcpy(vec.data(), cursor, sizeof(Type) * cnt);
+        cursor += sizeof(Type) * cnt;
+    }
+    return true;
+}
+
+}; // end of namespace tiny_engine
+#endif // __INDEX_IO_H_
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
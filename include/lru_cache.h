@@ -0,0 +1,225 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    lru_cache.h
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 21:05:37
+*   @brief:   分片 LRU 缓存, 可多线程并发读写
+*
+*   key 按哈希分到各分片, 每个分片一把锁、一个 LRU 链表, 容量按字节数(由调用方估算)平分.
+*   每个条目带一个版本号(如索引的 generation), 查询时版本不一致视为过期并删除,
+*   索引更新后不需要遍历清空缓存.
+*
+*****************************************************************/
+
+#ifndef __LRU_CACHE_H_
+#define __LRU_CACHE_H_
+
+#include "common.h"
+#include "str_util.h"
+#include <string>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+namespace tiny_engine {
+
+template <typename Value>
+class LruCache {
+public:
+    using SHARD_NUM = std::integral_constant<int, 16>;
+
+    /**
+     * @param[in] capacity: 总容量(字节), 各分片平分
+     * @param[in] shard_num: 分片数, 小于 1 时为 1
+     */
+    explicit LruCache(std::size_t capacity, int shard_num = SHARD_NUM::value);
+
+    /**
+     * @brief 命中且版本一致时返回 true 并移到 LRU 头部; 版本不一致时删除该条目
+     */
+    bool get(const std::string &key, uint64_t version, Value &value);
+    /**
+     * @brief 插入或覆盖, 超出分片容量时从 LRU 尾部淘汰; charge 超过分片容量时不插入
+     * @param[in] charge: 条目占用的字节数, 由调用方估算
+     */
+    void put(const std::string &key, uint64_t version, const Value &value, std::size_t charge);
+    void clear();
+
+    std::size_t capacity() const { return shard_capacity * shards.size(); }
+    // 单个条目的 charge 上限, 即分片容量
+    std::size_t max_charge() const { return shard_capacity; }
+    std::size_t memory_usage() const;
+    std::size_t size() const;
+    uint64_t hit_cnt() const { return hits; }
+    uint64_t miss_cnt() const { return misses; }
+    /**
+     * @brief 条目数, 占用内存, 命中/未命中/过期/淘汰次数, 命中率
+     */
+    std::string stats() const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(LruCache);
+
+    // 只引用 Entry::key, 生命期与条目相同
+    struct StrRef {
+        explicit StrRef(const std::string &str) : str(&str) {}
+        bool operator==(const StrRef &other) const { return *str == *other.str; }
+        const std::string* str;
+    };
+    struct StrRefHash {
+        std::size_t operator()(const StrRef &ref) const {
+            return std::hash<std::string>()(*ref.str);
+        }
+    };
+
+    struct Entry {
+        Entry(const std::string &key, uint64_t version, const Value &value, std::size_t charge) :
+            key(key), version(version), value(value), charge(charge) {}
+
+        std::string key;
+        uint64_t version;
+        Value value;
+        std::size_t charge;
+    };
+    using EntryList = std::list<Entry>;
+
+    struct Shard {
+        Shard() : usage(0) {}
+
+        std::mutex mutex;
+        EntryList lru; // 头部为最近使用
+        // 指向 lru 中的条目, key 指向条目自身的 key, 不另存一份
+        std::unordered_map<StrRef, typename EntryList::iterator, StrRefHash> table;
+        std::size_t usage;
+    };
+
+    Shard& _get_shard(const std::string &key) {
+        return *shards[std::hash<std::string>()(key) % shards.size()];
+    }
+    // 调用方持有分片锁
+    void _erase(Shard &shard, typename EntryList::iterator it);
+
+private:
+    std::size_t shard_capacity;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> expires; // 版本不一致
+    std::atomic<uint64_t> evictions;
+};
+
+template <typename Value>
+LruCache<Value>::LruCache(std::size_t capacity, int shard_num) :
+    hits(0),
+    misses(0),
+    expires(0),
+    evictions(0) {
+    shard_num = std::max(shard_num, 1);
+    shard_capacity = capacity / shard_num;
+    for (int i = 0; i < shard_num; ++i) {
+        shards.emplace_back(new Shard());
+    }
+}
+
+template <typename Value>
+bool LruCache<Value>::get(const std::string &key, uint64_t version, Value &value) {
+    auto &shard = _get_shard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.table.find(StrRef(key));
+    if (it == shard.table.end()) {
+        ++misses;
+        return false;
+    }
+    if (it->second->version != version) {
+        _erase(shard, it->second);
+        ++expires;
+        ++misses;
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    value = it->second->value;
+    ++hits;
+    return true;
+}
+
+template <typename Value>
+void LruCache<Value>::put(const std::string &key,
+        uint64_t version,
+        const Value &value,
+        std::size_t charge) {
+    charge += sizeof(Entry) + key.size();
+    if (charge > shard_capacity) {
+        return;
+    }
+    auto &shard = _get_shard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.table.find(StrRef(key));
+    if (it != shard.table.end()) {
+        _erase(shard, it->second);
+    }
+    while (!shard.lru.empty() && shard.usage + charge > shard_capacity) {
+        _erase(shard, std::prev(shard.lru.end()));
+        ++evictions;
+    }
+    shard.lru.emplace_front(key, version, value, charge);
+    shard.table.insert(std::make_pair(StrRef(shard.lru.front().key), shard.lru.begin()));
+    shard.usage += charge;
+}
+
+template <typename Value>
+void LruCache<Value>::clear() {
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->table.clear();
+        shard->lru.clear();
+        shard->usage = 0;
+    }
+}
+
+template <typename Value>
+std::size_t LruCache<Value>::memory_usage() const {
+    std::size_t usage = 0;
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        usage += shard->usage;
+    }
+    return usage;
+}
+
+template <typename Value>
+std::size_t LruCache<Value>::size() const {
+    std::size_t num = 0;
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        num += shard->lru.size();
+    }
+    return num;
+}
+
+template <typename Value>
+std::string LruCache<Value>::stats() const {
+    uint64_t hit = hits;
+    uint64_t miss = misses;
+    return StrUtil::format(
+            "entries[{}] memory[{}/{} bytes] hit[{}] miss[{}] expire[{}] evict[{}] hit_rate[{}]",
+            size(), memory_usage(), capacity(), hit, miss, uint64_t(expires),
+            uint64_t(evictions), hit + miss > 0 ? static_cast<float>(hit) / (hit + miss) : 0.0f);
+}
+
+template <typename Value>
+void LruCache<Value>::_erase(Shard &shard, typename EntryList::iterator it) {
+    shard.usage -= it->charge;
+    shard.table.erase(StrRef(it->key));
+    shard.lru.erase(it);
+}
+
+}; // end of namespace tiny_engine
+#endif // __LRU_CACHE_H_
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -16,16 +16,17 @@
 #include <vector>
 #include <algorithm>
 #include <numeric> // accumulate
-#include <iomanip> // setprecision
-#include <sstream>
+#include <type_traits> // is_floating_point
+#include <utility> // declval
+#include <stdint.h>
 
 namespace tiny_engine {
 
 class MathUtil {
 public:
     /**
-     * @brief 
-     *        type: only suitble for float, double
+     * @brief  bits λЧ, ԭ
+     *         setprecision(bits) ٶһ,  stringstream
      * @ref: https://blog.csdn.net/LaoJiu_/article/details/71703696
      */
     template <typename Type>
@@ -75,13 +76,15 @@ public:
     /**
      * @brief /ַı༭
      *      Type: ֧ .size(), Լoperator[], operator== 
+     *      Խ϶һΪ pattern,  BIT_PARALLEL_WORDS * 64 Ԫʱλ㷨,
+     *      ߳ڸõĹ DP, ÿεʱڴ
      */
     template <typename Type>
     static int edit_distance(
             const Type &first,
             const Type &second);
     /**
-     * @brief У
+     * @brief У, ʵַʽͬ edit_distance
      */
     template <typename Type>
     static int longest_common_subsequence(
@@ -89,6 +92,7 @@ public:
             const Type &second);
     /**
      * @brief Ӵ
+     *      ϶һ 64 Ԫʱλ㷨, Խɨ, ڴ
      */
     template <typename Type>
     static int longest_continuous_substring(
@@ -117,6 +121,14 @@ public:
      */
     template <typename Type>
     static Type median(std::vector<Type> &array);
+    /**
+     * @brief λ(nearest-rank),  ratio Ϊ 0.99 ʱ p99
+     * @param[in] sorted_array:е
+     * @param[in] ratio:[0, 1]
+     * @return
+     */
+    template <typename Type>
+    static Type percentile(const std::vector<Type> &sorted_array, double ratio);
     /**
      * @brief tf
      * @param[in] term_freq_in_one_doc : termĳdocеƵ
@@ -140,6 +152,43 @@ public:
     template <typename Type>
     static float sigmoid(Type x);
 
+    // λ㷨н϶һÿԪռ 1 bit, ռõ 64 λ
+    using BIT_PARALLEL_WORDS = std::integral_constant<std::size_t, 4>;
+
+private:
+    template <typename Type>
+    using ElemType = typename std::decay<decltype(std::declval<const Type&>()[0])>::type;
+    /**
+     * @brief pattern ÿԪسλõ(Peq): ֽԪذֱֵ,
+     *        (unicode 㡢term ǩ)ÿѰַϣ, Բ
+     */
+    template <typename Elem,
+             bool IS_BYTE = std::is_integral<Elem>::value && sizeof(Elem) == 1,
+             bool IS_INTEGRAL = std::is_integral<Elem>::value>
+    class MatchMask;
+    /**
+     * @brief Myers/Hyyro λб༭, pattern  64 λֿ, 䴫ˮƽֵ
+     */
+    template <typename Type>
+    static int _edit_distance_bit_parallel(const Type &pattern, const Type &text);
+    template <typename Type>
+    static int _edit_distance_dp(const Type &pattern, const Type &text);
+    /**
+     * @brief Allison-Dix/Hyyro λ: V' = (V + (V & M)) | (V & ~M)
+     */
+    template <typename Type>
+    static int _lcs_bit_parallel(const Type &pattern, const Type &text);
+    template <typename Type>
+    static int _lcs_dp(const Type &pattern, const Type &text);
+    /**
+     * @brief λӴ: жǷڱȵǰ 1 ĹӴ,
+     *         len еƥλ벻Ϊ 0, ֻ֧ pattern  64 Ԫ
+     */
+    template <typename Type>
+    static int _lcstr_bit_parallel(const Type &pattern, const Type &text);
+    template <typename Type>
+    static int _lcstr_diagonal(const Type &first, const Type &second);
+
 private:
     DISALLOW_COPY_AND_ASSIGN(MathUtil);
 
@@ -152,10 +201,29 @@ private:
 
 template <typename Type>
 Type MathUtil::round(Type value, int bits) {
-    std::stringstream ss;
-    ss << std::setprecision(bits) << value;
-    ss >> value;
-    return value;
+    if (!std::is_floating_point<Type>::value || bits < 1 || !std::isfinite(value) || 0 == value) {
+        return value;
+    }
+    double abs_value = std::fabs(static_cast<double>(value));
+    int exp10 = static_cast<int>(std::floor(std::log10(abs_value))) - bits + 1;
+    double scale = std::pow(10.0, std::abs(exp10));
+    double scaled = exp10 < 0 ? abs_value * scale : abs_value / scale;
+    // scaled ; scaled ǡ .5 ʱȷֵλ, ʮһ
+    double residual = exp10 < 0 ? std::fma(abs_value, scale, -scaled)
+                                : -std::fma(scaled, scale, -abs_value);
+    double digits = std::nearbyint(scaled);
+    if (scaled - std::floor(scaled) == 0.5 && 0 != residual) {
+        digits = residual > 0 ? std::ceil(scaled) : std::floor(scaled);
+    }
+    // 10  float пɾȷʾʱ Type , ⾭ double 
+    Type result = 0;
+    if (scale <= 1e7) {
+        result = exp10 < 0 ? static_cast<Type>(digits) / static_cast<Type>(scale)
+                           : static_cast<Type>(digits) * static_cast<Type>(scale);
+    } else {
+        result = static_cast<Type>(exp10 < 0 ? digits / scale : digits * scale);
+    }
+    return value < 0 ? -result : result;
 }
 
 template <typename Type>
@@ -237,73 +305,339 @@ Type MathUtil::manhattan_distance(
     return lp_distance<Type>(first, second, 1);
 }
 
+template <typename Elem>
+class MathUtil::MatchMask<Elem, true, true> {
+public:
+    template <typename Type>
+    explicit MatchMask(const Type &pattern) : slot_num(1) {
+        // 0 ŲλΪȫ 0 , δ pattern гֵԪضָ, ʱ޷֧
+        std::fill(slots, slots + 256, 0);
+        std::fill(masks[0], masks[0] + BIT_PARALLEL_WORDS::value, 0);
+        for (std::size_t i = 0; i < pattern.size(); ++i) {
+            auto c = static_cast<unsigned char>(pattern[i]);
+            if (0 == slots[c]) {
+                slots[c] = slot_num++;
+                std::fill(masks[slots[c]], masks[slots[c]] + BIT_PARALLEL_WORDS::value, 0);
+            }
+            masks[slots[c]][i >> 6] |= uint64_t(1) << (i & 63);
+        }
+    }
+
+    const uint64_t* get(Elem elem) const {
+        return masks[slots[static_cast<unsigned char>(elem)]];
+    }
+
+private:
+    uint16_t slot_num;
+    uint16_t slots[256];
+    uint64_t masks[257][BIT_PARALLEL_WORDS::value];
+};
+
+template <typename Elem>
+class MathUtil::MatchMask<Elem, false, true> {
+public:
+    template <typename Type>
+    explicit MatchMask(const Type &pattern) : slot_num(1), bucket_mask(1), shift(63) {
+        // ͰΪС pattern  8  2 , ֻõͰ
+        while (bucket_mask + 1 < 8 * pattern.size()) {
+            bucket_mask = (bucket_mask << 1) | 1;
+            --shift;
+        }
+        std::fill(slots, slots + bucket_mask + 1, 0);
+        std::fill(keys, keys + bucket_mask + 1, Elem());
+        std::fill(masks[0], masks[0] + BIT_PARALLEL_WORDS::value, 0);
+        for (std::size_t i = 0; i < pattern.size(); ++i) {
+            auto pos = _find(pattern[i]);
+            if (0 == slots[pos]) {
+                keys[pos] = pattern[i];
+                slots[pos] = slot_num++;
+                std::fill(masks[slots[pos]], masks[slots[pos]] + BIT_PARALLEL_WORDS::value, 0);
+            }
+            masks[slots[pos]][i >> 6] |= uint64_t(1) << (i & 63);
+        }
+    }
+
+    const uint64_t* get(Elem elem) const {
+        return masks[slots[_find(elem)]];
+    }
+
+private:
+    //  elem ڵͰ, ʱĵһͰ(λ 0 Ϊȫ 0 )
+    std::size_t _find(Elem elem) const {
+        std::size_t pos = (static_cast<uint64_t>(elem) * 0x9e3779b97f4a7c15ull) >> shift;
+        // Ͱ key , ö·ֵ, Ԥķ֧
+        while ((0 != slots[pos]) & (keys[pos] != elem)) {
+            pos = (pos + 1) & bucket_mask;
+        }
+        return pos;
+    }
+
+    static const std::size_t MAX_BUCKET_NUM = BIT_PARALLEL_WORDS::value * 64 * 8;
+
+    uint16_t slot_num;
+    std::size_t bucket_mask;
+    int shift;
+    Elem keys[MAX_BUCKET_NUM];
+    uint16_t slots[MAX_BUCKET_NUM];
+    uint64_t masks[BIT_PARALLEL_WORDS::value * 64 + 1][BIT_PARALLEL_WORDS::value];
+};
+
+template <typename Elem>
+class MathUtil::MatchMask<Elem, false, false> {
+public:
+    template <typename Type>
+    explicit MatchMask(const Type &pattern) : symbol_num(0) {
+        std::fill(zero, zero + BIT_PARALLEL_WORDS::value, 0);
+        for (std::size_t i = 0; i < pattern.size(); ++i) {
+            auto idx = _find(pattern[i]);
+            if (idx == symbol_num) {
+                symbols[symbol_num++] = &pattern[i];
+                std::fill(masks[idx], masks[idx] + BIT_PARALLEL_WORDS::value, 0);
+            }
+            masks[idx][i >> 6] |= uint64_t(1) << (i & 63);
+        }
+    }
+
+    const uint64_t* get(const Elem &elem) const {
+        auto idx = _find(elem);
+        return idx < symbol_num ? masks[idx] : zero;
+    }
+
+private:
+    std::size_t _find(const Elem &elem) const {
+        std::size_t idx = 0;
+        while (idx < symbol_num && !(*symbols[idx] == elem)) {
+            ++idx;
+        }
+        return idx;
+    }
+
+    static const std::size_t MAX_SYMBOL_NUM = BIT_PARALLEL_WORDS::value * 64;
+
+    std::size_t symbol_num;
+    const Elem* symbols[MAX_SYMBOL_NUM]; // ָ pattern ״γֵλ
+    uint64_t zero[BIT_PARALLEL_WORDS::value];
+    uint64_t masks[MAX_SYMBOL_NUM][BIT_PARALLEL_WORDS::value];
+};
+
 template <typename Type>
 int MathUtil::edit_distance(
         const Type &first,
         const Type &second) {
-    const auto ROW = 1 + first.size();
-    const auto COLUMN = 1 + second.size();
-    std::vector<std::vector<int>> dp(ROW, std::vector<int>(COLUMN, 0));
-    for (std::size_t i = 0; i < ROW; ++i) {
-        dp[i][0] = i;
-    }
-    for (std::size_t j = 0; j < COLUMN; ++j) {
-        dp[0][j] = j;
-    }
-    for (std::size_t i = 1; i < ROW; ++i) {
-        for (std::size_t j = 1; j < COLUMN; ++j) {
-            dp[i][j] = (first[i - 1] == second[j - 1] ? \
-                        dp[i - 1][j - 1] : \
-                        dp[i - 1][j - 1] + 1);
-
-            dp[i][j] = std::min(dp[i][j],
-                                std::min(dp[i - 1][j] + 1, dp[i][j - 1] + 1));
+    // ༭Գ, Խ϶һΪ pattern
+    const auto &pattern = first.size() <= second.size() ? first : second;
+    const auto &text = first.size() <= second.size() ? second : first;
+    if (pattern.size() == 0) {
+        return static_cast<int>(text.size());
+    }
+    if (pattern.size() <= BIT_PARALLEL_WORDS::value * 64) {
+        return _edit_distance_bit_parallel(pattern, text);
+    }
+    return _edit_distance_dp(pattern, text);
+}
+
+template <typename Type>
+int MathUtil::_edit_distance_bit_parallel(const Type &pattern, const Type &text) {
+    const std::size_t word_num = (pattern.size() + 63) / 64;
+    MatchMask<ElemType<Type>> peq(pattern);
+    // ÿеĴֱֵ D[i][j] - D[i-1][j]: pv Ϊ +1, mv Ϊ -1
+    uint64_t pv[BIT_PARALLEL_WORDS::value];
+    uint64_t mv[BIT_PARALLEL_WORDS::value];
+    std::fill(pv, pv + BIT_PARALLEL_WORDS::value, ~uint64_t(0));
+    std::fill(mv, mv + BIT_PARALLEL_WORDS::value, 0);
+    const uint64_t HIGH_BIT = uint64_t(1) << 63;
+    const uint64_t LAST_BIT = uint64_t(1) << ((pattern.size() - 1) & 63);
+    int score = static_cast<int>(pattern.size());
+    if (1 == word_num) {
+        // : pattern  64 Ԫ, 䴫
+        uint64_t p = pv[0];
+        uint64_t m = mv[0];
+        for (std::size_t j = 0; j < text.size(); ++j) {
+            uint64_t eq = peq.get(text[j])[0];
+            uint64_t xv = eq | m;
+            uint64_t xh = (((eq & p) + p) ^ p) | eq;
+            uint64_t ph = m | ~(xh | p);
+            uint64_t mh = p & xh;
+            score += static_cast<int>((ph & LAST_BIT) != 0) - static_cast<int>((mh & LAST_BIT) != 0);
+            ph = (ph << 1) | 1;
+            mh <<= 1;
+            p = mh | ~(xv | ph);
+            m = ph & xv;
+        }
+        return score;
+    }
+    for (std::size_t j = 0; j < text.size(); ++j) {
+        const uint64_t* eq_arr = peq.get(text[j]);
+        int hin = 1; //  0  D[0][j] = j, ˮƽֵΪ +1
+        for (std::size_t w = 0; w < word_num; ++w) {
+            uint64_t p = pv[w];
+            uint64_t m = mv[w];
+            uint64_t eq = eq_arr[w];
+            uint64_t hin_neg = hin < 0 ? 1 : 0;
+            uint64_t xv = eq | m;
+            eq |= hin_neg;
+            uint64_t xh = (((eq & p) + p) ^ p) | eq;
+            uint64_t ph = m | ~(xh | p);
+            uint64_t mh = p & xh;
+            // һЧλˮƽֵһ, һ鼴÷ֵı仯
+            uint64_t high = w + 1 < word_num ? HIGH_BIT : LAST_BIT;
+            int hout = static_cast<int>((ph & high) != 0) - static_cast<int>((mh & high) != 0);
+            ph = (ph << 1) | (hin > 0 ? 1 : 0);
+            mh = (mh << 1) | hin_neg;
+            pv[w] = mh | ~(xv | ph);
+            mv[w] = ph & xv;
+            hin = hout;
+        }
+        score += hin;
+    }
+    return score;
+}
+
+template <typename Type>
+int MathUtil::_edit_distance_dp(const Type &pattern, const Type &text) {
+    // , ߳ڸ
+    thread_local std::vector<int> row;
+    row.resize(pattern.size() + 1);
+    for (std::size_t i = 0; i < row.size(); ++i) {
+        row[i] = static_cast<int>(i);
+    }
+    for (std::size_t j = 0; j < text.size(); ++j) {
+        int diag = row[0];
+        row[0] = static_cast<int>(j + 1);
+        for (std::size_t i = 1; i < row.size(); ++i) {
+            int up = row[i];
+            row[i] = std::min(pattern[i - 1] == text[j] ? diag : diag + 1,
+                              std::min(up + 1, row[i - 1] + 1));
+            diag = up;
         }
     }
-    return dp[ROW - 1][COLUMN - 1];
+    return row.back();
 }
 
 template <typename Type>
 int MathUtil::longest_common_subsequence(
         const Type &first,
         const Type &second) {
-    std::vector<std::vector<int>> dp(first.size() + 1,
-                                    std::vector<int>(second.size() + 1, 0));
-    for (decltype(first.size()) i = 1; i < first.size() + 1; ++i) {
-        for (decltype(second.size()) j = 1; j < second.size() + 1; ++j) {
-            if (first[i - 1] == second[j - 1]) {
-                dp[i][j] = dp[i - 1][j - 1] + 1;
-            } else {
-                dp[i][j] = std::max(dp[i][j - 1], dp[i - 1][j]);
-            }
+    const auto &pattern = first.size() <= second.size() ? first : second;
+    const auto &text = first.size() <= second.size() ? second : first;
+    if (pattern.size() == 0) {
+        return 0;
+    }
+    if (pattern.size() <= BIT_PARALLEL_WORDS::value * 64) {
+        return _lcs_bit_parallel(pattern, text);
+    }
+    return _lcs_dp(pattern, text);
+}
+
+template <typename Type>
+int MathUtil::_lcs_bit_parallel(const Type &pattern, const Type &text) {
+    const std::size_t word_num = (pattern.size() + 63) / 64;
+    MatchMask<ElemType<Type>> peq(pattern);
+    // v Ϊ 0 λƥϵ pattern λ
+    uint64_t v[BIT_PARALLEL_WORDS::value];
+    std::fill(v, v + BIT_PARALLEL_WORDS::value, ~uint64_t(0));
+    if (1 == word_num) {
+        for (std::size_t j = 0; j < text.size(); ++j) {
+            uint64_t u = v[0] & peq.get(text[j])[0];
+            v[0] = (v[0] + u) | (v[0] - u);
+        }
+    }
+    for (std::size_t j = 0; j < text.size() && word_num > 1; ++j) {
+        const uint64_t* eq_arr = peq.get(text[j]);
+        uint64_t carry = 0;
+        for (std::size_t w = 0; w < word_num; ++w) {
+            uint64_t u = v[w] & eq_arr[w];
+            uint64_t sum = v[w] + carry;
+            uint64_t next_carry = sum < carry ? 1 : 0;
+            sum += u;
+            next_carry |= sum < u ? 1 : 0;
+            v[w] = sum | (v[w] - u);
+            carry = next_carry;
+        }
+    }
+    int result = 0;
+    for (std::size_t w = 0; w < word_num; ++w) {
+        uint64_t valid = ~uint64_t(0);
+        if (w + 1 == word_num && (pattern.size() & 63) != 0) {
+            valid = (uint64_t(1) << (pattern.size() & 63)) - 1;
+        }
+        result += __builtin_popcountll(~v[w] & valid);
+    }
+    return result;
+}
+
+template <typename Type>
+int MathUtil::_lcs_dp(const Type &pattern, const Type &text) {
+    thread_local std::vector<int> row;
+    row.assign(pattern.size() + 1, 0);
+    for (std::size_t j = 0; j < text.size(); ++j) {
+        int diag = 0;
+        for (std::size_t i = 1; i < row.size(); ++i) {
+            int up = row[i];
+            row[i] = pattern[i - 1] == text[j] ? diag + 1 : std::max(up, row[i - 1]);
+            diag = up;
         }
     }
-    return dp[first.size()][second.size()];
+    return row.back();
 }
 
 template <typename Type>
 int MathUtil::longest_continuous_substring(
         const Type &first,
         const Type &second) {
-    int result = -1;
-    std::vector<std::vector<int>> dp(first.size(), std::vector<int>(second.size(), 0));
-    for (decltype(first.size()) i = 0; i < first.size(); ++i) {
-        dp[i][0] = (first[i] == second[0] ? 1 : 0);
-    }
-    for (decltype(second.size()) j = 0; j < second.size(); ++j) {
-        dp[0][j] = (first[0] == second[j] ? 1 : 0);
-    }
-    for (decltype(first.size()) i = 0; i < first.size(); ++i) {
-        for (decltype(second.size()) j = 0; j < second.size(); ++j) {
-            if (i < 1 || j < 1) {
-                result = std::max(result, dp[i][j]);
-                continue;
+    const auto &pattern = first.size() <= second.size() ? first : second;
+    const auto &text = first.size() <= second.size() ? second : first;
+    if (pattern.size() == 0) {
+        return 0;
+    }
+    if (pattern.size() <= 64) {
+        return _lcstr_bit_parallel(pattern, text);
+    }
+    return _lcstr_diagonal(pattern, text);
+}
+
+template <typename Type>
+int MathUtil::_lcstr_bit_parallel(const Type &pattern, const Type &text) {
+    MatchMask<ElemType<Type>> peq(pattern);
+    //  64 еƥ, ƥ䳤Ȳ pattern 
+    uint64_t eqs[64];
+    std::size_t result = 0;
+    for (std::size_t j = 0; j < text.size() && result < pattern.size(); ++j) {
+        eqs[j & 63] = peq.get(text[j])[0];
+        // ÿһг 1, ֻжǷ text[j] βΪ result + 1 ĹӴ
+        std::size_t len = result + 1;
+        if (j + 1 < len) {
+            continue;
+        }
+        uint64_t run = eqs[j & 63];
+        for (std::size_t k = 1; k < len && 0 != run; ++k) {
+            run &= eqs[(j - k) & 63] << k;
+        }
+        result += 0 != run ? 1 : 0;
+    }
+    return static_cast<int>(result);
+}
+
+template <typename Type>
+int MathUtil::_lcstr_diagonal(const Type &first, const Type &second) {
+    // Խͳƥ䳤, ʣ೤ȲǰĶԽֱ
+    const std::size_t ROW = first.size();
+    const std::size_t COLUMN = second.size();
+    std::size_t result = 0;
+    for (std::size_t diag = 1; diag < ROW + COLUMN; ++diag) {
+        std::size_t i = diag < COLUMN ? 0 : diag - COLUMN;
+        std::size_t j = diag < COLUMN ? COLUMN - diag : 0;
+        std::size_t len = std::min(ROW - i, COLUMN - j);
+        std::size_t run = 0;
+        for (std::size_t k = 0; k < len && run + len - k > result; ++k) {
+            if (first[i + k] == second[j + k]) {
+                result = std::max(result, ++run);
+            } else {
+                run = 0;
             }
-            dp[i][j] = (first[i] == second[j] ? dp[i - 1][j - 1] + 1 : 0);
-            result = std::max(dp[i][j], result);
         }
     }
-    return result;
+    return static_cast<int>(result);
 }
 
 template <typename Type>
@@ -340,6 +674,14 @@ Type MathUtil::median(std::vector<Type> &array) {
     return array[mid_pos];
 }
 
+template <typename Type>
+Type MathUtil::percentile(const std::vector<Type> &sorted_array, double ratio) {
+    EXPECT_FALSE_OR_RETURN(sorted_array.empty(), Type());
+    ratio = std::min(std::max(ratio, 0.0), 1.0);
+    auto rank = static_cast<std::size_t>(std::ceil(ratio * sorted_array.size()));
+    return sorted_array[rank > 0 ? rank - 1 : 0];
+}
+
 template <typename Type>
 float MathUtil::sigmoid(Type x) {
     return 1.0 / (1 + exp(-x));
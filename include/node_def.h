@@ -12,37 +12,38 @@
 #pragma once
 #include "str_util.h"
 #include "feature_mgr.h"
+#include "posting_list.h"
 
 #include <memory>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace tiny_engine {
 
-// 切词信息
+// 切词信息, 不保存明文: 需要时按 offset/length 从原串中取
 class TermNode {
 public:
     TermNode(std::size_t sign,
-            const std::string &txt,
             uint16_t off = 0,
             uint16_t len = 0,
+            bool space = false,
             uint16_t dup = 0,
             float wei = 0.0);
-    TermNode(const TermNode &other);
-    TermNode& operator=(const TermNode &other);
     bool operator==(const TermNode &other) const;
     bool operator<(const TermNode &other) const;
     std::string to_str() const;
 
 public:
     std::size_t token_sign; // term签名
-    std::string token;  // term明文
+    uint32_t term_id; // TermDict 中的 id, 查询时不在字典中的 term 为 TermDict::INVALID_ID
+    float wei; // tf * idf
     uint16_t offset; // offset in unicode, 字符粒度
     uint16_t length; // length in unicode, 即真实的字符长度, 一个汉字长度为1
     uint16_t dup; // 表示term第几次出现, 从1开始计数
-    float wei; // tf * idf
+    bool is_space; // 空白 term, 不进短语/邻近匹配的位置
 };
 
 // term 同义词改写节点
@@ -68,10 +69,41 @@ public:
     std::vector<uint16_t> offsets; // 所有字符粒度的 offset
 };
 
+/**
+ * @brief doc/query 内 term 到 GlobalTermInfo 的映射, 按 key 升序存放在数组中, 二分查找
+ *        一个 title/query 只有几十个 term, 比哈希表省内存, 查找时也不用计算哈希
+ */
+template <typename Key>
+class TermInfoMap {
+public:
+    using Item = std::pair<Key, GlobalTermInfo>;
+    using const_iterator = typename std::vector<Item>::const_iterator;
+
+    // 只读查找, 不存在时返回 nullptr
+    const GlobalTermInfo* find(Key key) const;
+    // 只读查找, 不存在时返回空的 GlobalTermInfo; 分片并行召回时不能用 operator[]
+    const GlobalTermInfo& get(Key key) const;
+    // 不存在时按序插入空的 GlobalTermInfo, 只在切词后构造时使用
+    GlobalTermInfo& operator[](Key key);
+    bool contains(Key key) const { return nullptr != find(key); }
+
+    std::size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    void clear() { items.clear(); }
+    const_iterator begin() const { return items.begin(); }
+    const_iterator end() const { return items.end(); }
+
+private:
+    const_iterator _lower_bound(Key key) const;
+
+private:
+    std::vector<Item> items;
+};
+
 // 正排 value: 正排 doc 节点, doc相关feature
 class DocInfo {
 public:
-    DocInfo() {}
+    DocInfo() : doc_id(0) {}
     DocInfo(std::size_t sign,
             const std::string &t,
             const std::string &u,
@@ -79,48 +111,42 @@ public:
             float module = 0.0);
 public:
     std::size_t doc_sign; // doc签名
+    uint32_t doc_id; // 稠密的内部doc编号, 建库时按加入顺序分配, 倒排拉链中存放的是它
     std::string title; // title明文
     std::string url; // url明文
     uint32_t title_len; // unicode length
+    std::vector<uint32_t> title_chars; // title的unicode码点, 建库/加载时解码, 字符粒度特征使用
     std::vector<TermNode> terms; // title切词
-    std::unordered_map<std::size_t, GlobalTermInfo> term_map;
+    TermInfoMap<uint32_t> term_map; // key=term_id
     float vec_module; // 所有切词terms tf*idf 向量的模
     float wei_sum; // ∑ idf
 };
 
-// 倒排 doc 节点: 倒排的 value
-class DocNode {
-public:
-    DocNode() {}
-    DocNode(std::size_t sign);
-    bool operator==(const DocNode &other) const;
-    std::size_t operator()() const;
-public:
-    std::size_t doc_sign;
-};
-
-struct DocNodeHash {
-    std::size_t operator()(const DocNode &node) const {
-        return node.doc_sign;
-    }
-};
-
 // 倒排 term 节点: 倒排的 key
 class InvTermInfo {
 public:
-    InvTermInfo() {}
+    InvTermInfo() : max_tf(0) {}
     InvTermInfo(std::size_t sign,
+            uint32_t id,
             const std::string &t,
             uint16_t len = 0,
             uint16_t tf = 0,
             float idf = 0.0);
+    /**
+     * @brief 拉链上 doc_id 在 [begin_doc, end_doc) 内的游标, 不拷贝拉链
+     */
+    PostingCursor cursor(uint32_t begin_doc = 0,
+            uint32_t end_doc = PostingCursor::END_DOC::value) const;
 public:
     std::size_t term_sign; // term签名
+    uint32_t term_id; // TermDict 中的 id
     std::string term_txt; // term明文
     uint16_t term_len; // term长度
     uint16_t term_freq; // term在所有doc中出现的总次数
+    uint16_t max_tf; // term在单个doc中出现的最大次数, 用于计算 WAND 得分上界
     float idf;
-    std::unordered_set<DocNode, DocNodeHash> docs;
+    PostingList docs; // 倒排拉链, doc_id 升序, 分块压缩
+    PositionList positions; // 位置信息(可选), 与 docs 按下标对齐
 };
 
 // QU匹配的term信息
@@ -143,6 +169,18 @@ public:
     bool is_stopword;
 };
 
+// query中的短语/邻近约束: "a b" 要求 term 在 doc 中按序紧邻出现; "a b"~N 要求所有 term
+// 出现在长度不超过 N 个 term 的窗口内, 不要求顺序
+class PhraseNode {
+public:
+    PhraseNode() : window(0) {}
+public:
+    std::string text; // 短语明文
+    std::vector<std::size_t> term_signs; // 短语切词(去掉停用词及空白)
+    std::vector<uint16_t> term_pos; // 每个 term 相对于第一个 term 的位置
+    uint16_t window; // 0 表示精确短语
+};
+
 // query相关feature
 class QueryInfo {
 public:
@@ -150,12 +188,17 @@ public:
     QueryInfo(const std::string &q);
     void init();
     std::string to_str() const;
+    // 估算占用的字节数, 用于缓存计费
+    std::size_t mem_size() const;
 public:
     std::string query; // query明文
     uint32_t query_len; // unicode length
+    std::vector<uint32_t> query_chars; // query的unicode码点, 切词时解码
     std::vector<TermNode> terms; // query切词
     std::vector<std::vector<SynTermNode>> syns; // 每个term的同义词改写, 与term切词对齐
-    std::unordered_map<std::size_t, GlobalTermInfo> term_map; // key=sign
+    std::vector<PhraseNode> phrases; // 短语/邻近约束, 召回时过滤
+    // key=sign: 缓存的 QueryInfo 与索引无关, 不在字典中的 term 也要区分
+    TermInfoMap<std::size_t> term_map;
     float vec_module; // terms tf*idf 向量的模
     float wei_sum; // ∑ idf
 };
@@ -175,6 +218,7 @@ public:
     std::shared_ptr<FeatureMgr> feature_mgr;
 
     bool recall_by_syn; // 是否由同义词召回
+    float recall_score; // WAND 召回得分, 分片召回结果归并时使用
     // qu相关性打分的特征
     uint16_t term_hits; // doc与query的term交集个数(包含重复)
     float vsm;
@@ -189,4 +233,34 @@ public:
     float final_score;
 };
 
+// -----------------------------------------------------------
+
+template <typename Key>
+typename TermInfoMap<Key>::const_iterator TermInfoMap<Key>::_lower_bound(Key key) const {
+    return std::lower_bound(items.begin(), items.end(), key,
+            [](const Item &item, Key k) { return item.first < k; });
+}
+
+template <typename Key>
+const GlobalTermInfo* TermInfoMap<Key>::find(Key key) const {
+    auto iter = _lower_bound(key);
+    return iter != items.end() && iter->first == key ? &iter->second : nullptr;
+}
+
+template <typename Key>
+const GlobalTermInfo& TermInfoMap<Key>::get(Key key) const {
+    static const GlobalTermInfo empty_info;
+    auto info = find(key);
+    return nullptr != info ? *info : empty_info;
+}
+
+template <typename Key>
+GlobalTermInfo& TermInfoMap<Key>::operator[](Key key) {
+    auto iter = items.begin() + (_lower_bound(key) - items.cbegin());
+    if (iter == items.end() || iter->first != key) {
+        iter = items.insert(iter, std::make_pair(key, GlobalTermInfo()));
+    }
+    return iter->second;
+}
+
 };
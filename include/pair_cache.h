@@ -0,0 +1,135 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    pair_cache.h
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 22:14:08
+*   @brief:   高频 term 对的倒排交集缓存
+*
+*   每次召回记录 query 中 term 两两组成的 term 对的次数; 后台线程每 PAIR_MINE_INTERVAL_S 秒
+*   选出次数最多的 PAIR_HOT_NUM 个 term 对作为热门 term 对, 并将计数减半, 使热度随时间衰减.
+*   启动时先挖掘 PAIR_QUERY_LOG(每行第一列为 query) 中的 term 对.
+*   只有热门 term 对的交集允许进入缓存(准入控制), 交集按索引 generation 失效.
+*
+*****************************************************************/
+
+#ifndef __PAIR_CACHE_H_
+#define __PAIR_CACHE_H_
+
+#include "common.h"
+#include "log_util.h"
+#include "str_util.h"
+#include "config_util.h"
+#include "lru_cache.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+
+namespace tiny_engine {
+
+class PairCache {
+public:
+    using PAIR_CACHE_SIZE_MB = std::integral_constant<int, 0>;
+    using HOT_PAIR_NUM = std::integral_constant<int, 1024>;
+    using MIN_PAIR_COUNT = std::integral_constant<int, 2>;
+    using MINE_INTERVAL_S = std::integral_constant<int, 60>;
+    // 计数的 term 对数上限, 达到后只累加已有的 term 对
+    using MAX_TRACKED_PAIRS = std::integral_constant<int, 1 << 18>;
+    using COUNTER_SHARD_NUM = std::integral_constant<int, 16>;
+
+    // <term_sign, term_sign>, 小的在前
+    using TermPair = std::pair<std::size_t, std::size_t>;
+    using DocList = std::vector<uint32_t>;
+    // 将一个 query 转成参与计数的 term sign(去掉停用词及空白), 用于挖掘 PAIR_QUERY_LOG
+    using Tokenizer = std::function<void(const std::string&, std::vector<std::size_t>&)>;
+
+    PairCache();
+    ~PairCache();
+
+    /**
+     * @brief PAIR_CACHE_SIZE_MB 为 0 时不开启, 不启动后台线程
+     */
+    bool init(std::shared_ptr<ConfigUtil> configs, Tokenizer tokenizer);
+    void stop();
+    bool is_enabled() const { return nullptr != cache; }
+
+    static TermPair make_pair(std::size_t first, std::size_t second);
+
+    /**
+     * @brief 记录一个 query 的 term, 两两计数; 重复的 term 只计一次
+     */
+    void record(const std::vector<std::size_t> &term_signs);
+    bool is_hot(const TermPair &pair) const;
+    /**
+     * @brief 估算的交集大小超过单条上限时不必求交, 求出后也无法缓存
+     */
+    bool is_admissible(std::size_t doc_cnt) const;
+
+    bool get(const TermPair &pair, uint64_t generation, std::shared_ptr<const DocList> &docs);
+    // 只缓存热门 term 对
+    void put(const TermPair &pair, uint64_t generation, std::shared_ptr<const DocList> docs);
+    // 一次召回用交集预填充 top-k 后调用, 用于统计
+    void add_seed_stats(std::size_t seed_doc_cnt);
+
+    /**
+     * @brief 挖掘一次热门 term 对, 后台线程定期调用
+     */
+    void mine();
+    /**
+     * @brief 热门 term 对数, 计数中的 term 对数, 交集缓存的条目/内存/命中率, 预填充的次数及 doc 数
+     */
+    std::string stats() const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(PairCache);
+
+    struct PairHash {
+        std::size_t operator()(const TermPair &pair) const {
+            return pair.first * 31 + pair.second;
+        }
+    };
+    using PairSet = std::unordered_set<TermPair, PairHash>;
+    using DocListCache = LruCache<std::shared_ptr<const DocList>>;
+
+    struct CounterShard {
+        std::mutex mutex;
+        std::unordered_map<TermPair, uint32_t, PairHash> counts;
+    };
+
+    static std::string _to_key(const TermPair &pair);
+    void _load_query_log(const std::string &file);
+    void _mine_loop();
+
+private:
+    std::unique_ptr<DocListCache> cache; // 未开启时为 nullptr
+    Tokenizer tokenizer;
+    std::string query_log;
+    int hot_pair_num;
+    int min_pair_count;
+    int mine_interval_s;
+
+    CounterShard counter_shards[COUNTER_SHARD_NUM::value];
+    std::atomic<std::size_t> tracked_cnt;
+    // 当前的热门 term 对, 通过 std::atomic_load/atomic_store 读写
+    std::shared_ptr<const PairSet> hot_pairs;
+
+    std::atomic<uint64_t> seed_cnt;
+    std::atomic<uint64_t> seed_doc_cnt;
+
+    std::thread mine_thread;
+    std::mutex mine_mutex;
+    std::condition_variable mine_cond;
+    bool is_stopped;
+};
+
+}; // end of namespace tiny_engine
+#endif // __PAIR_CACHE_H_
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
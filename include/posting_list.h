@@ -0,0 +1,245 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    posting_list.h
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 14:05:11
+*   @brief:   压缩倒排拉链
+*
+*   doc_id 升序, 每 128 个 doc_id 为一个 block:
+*     1. 先做差分(d-gap), block 内第一个 doc_id 与上一个 block 的最大 doc_id 做差
+*     2. 按 block 内最大差值的位数 bits 做定长 bit-packing
+*     3. 采用 4 路纵向布局(第 i 个值放在第 i % 4 路), 每路 32 个值占 bits 个 32 位字,
+*        4 路的同一个字相邻存放, 解码时一条 SSE 指令可同时处理 4 个值, 再做向量前缀和还原
+*   每个 block 一个跳表项(最大 doc_id, 数据偏移, bits), 可按 doc_id 跳过整个 block 不解码;
+*   不足 128 个的尾部不压缩, 直接存原值, 便于建库时追加
+*
+*****************************************************************/
+
+#ifndef __POSTING_LIST_H_
+#define __POSTING_LIST_H_
+
+#include "common.h"
+#include "index_io.h"
+#include <cstdint>
+#include <vector>
+#include <cstddef>
+#include <iterator>
+
+namespace tiny_engine {
+
+class PostingList {
+public:
+    using BLOCK_SIZE = std::integral_constant<uint32_t, 128>;
+    using LANE_NUM = std::integral_constant<uint32_t, 4>;
+
+    // block 跳表项
+    struct SkipEntry {
+        uint32_t max_doc_id; // block 内最大 doc_id
+        uint32_t offset; // block 数据在 packed 中的起始下标(32位字)
+        uint32_t bits; // block 内差值的位宽
+    };
+
+    // 顺序遍历拉链, 按 block 解码到内部缓存
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = uint32_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const uint32_t*;
+        using reference = uint32_t;
+
+        Iterator(const PostingList* list, uint32_t pos);
+        uint32_t operator*() const;
+        Iterator& operator++();
+        bool operator==(const Iterator &other) const;
+        bool operator!=(const Iterator &other) const;
+        bool is_end() const;
+        // 当前 doc 在拉链中的下标
+        std::size_t rank() const;
+        /**
+         * @brief 跳到第一个 >= doc_id 的位置, 按跳表跳过整个 block, 不解码
+         */
+        Iterator& advance_to(uint32_t doc_id);
+
+    private:
+        void _fill();
+
+    private:
+        const PostingList* list;
+        uint32_t pos; // 在整个拉链中的下标
+        uint32_t buf_begin; // buf[0] 对应的下标
+        uint32_t buf_size;
+        uint32_t buf[BLOCK_SIZE::value];
+    };
+
+    PostingList();
+
+    /**
+     * @brief 插入 doc_id, 已存在时返回 false
+     *        doc_id 大于当前最大值时直接追加(建库时的常见情况), 否则需要有序插入, 可能重新编码
+     */
+    bool add(uint32_t doc_id);
+    /**
+     * @brief 删除 doc_id, 不存在时返回 false
+     *        在尾部时直接删除, 否则整体解码后重新编码
+     */
+    bool remove(uint32_t doc_id);
+    bool contains(uint32_t doc_id) const;
+    // 小于 doc_id 的个数, doc_id 存在时即为其下标
+    std::size_t rank(uint32_t doc_id) const;
+    /**
+     * @brief 追加另一个拉链, other 中的 doc_id 须都大于 back()
+     */
+    void append(const PostingList &other);
+
+    std::size_t size() const;
+    bool empty() const;
+    uint32_t back() const;
+
+    Iterator begin() const;
+    Iterator end() const;
+
+    std::size_t block_cnt() const;
+    const SkipEntry& get_skip(std::size_t block_idx) const;
+    /**
+     * @brief 解码第 block_idx 个 block(尾部未压缩部分的编号为 block_cnt()), 返回 doc_id 个数
+     * @param[out] out: 至少 BLOCK_SIZE 个元素
+     */
+    uint32_t decode_block(std::size_t block_idx, uint32_t* out) const;
+    void decode(std::vector<uint32_t> &out) const;
+    void encode(const std::vector<uint32_t> &doc_ids);
+
+    // 压缩后占用的字节数
+    std::size_t memory_usage() const;
+
+    void dump(BinaryWriter &writer) const;
+    bool load(BinaryReader &reader);
+
+    /**
+     * @brief bit-packing 编解码, 处理一个完整 block
+     *        in/out 为 BLOCK_SIZE 个差值, packed 为 bits * LANE_NUM 个字
+     */
+    static void pack_block(const uint32_t* in, uint32_t bits, uint32_t* packed);
+    static void unpack_block(const uint32_t* packed, uint32_t bits, uint32_t base, uint32_t* out);
+
+private:
+    void _flush_tail();
+    static uint32_t _bit_width(uint32_t value);
+    static void _unpack_block_scalar(const uint32_t* packed, uint32_t bits,
+            uint32_t base, uint32_t* out);
+
+private:
+    uint32_t doc_cnt;
+    std::vector<SkipEntry> skips;
+    std::vector<uint32_t> packed;
+    std::vector<uint32_t> tail; // 未满一个 block 的尾部, 不压缩
+};
+
+// 逐个遍历是召回的热点, 以下在头文件中内联
+inline uint32_t PostingList::Iterator::operator*() const {
+    return buf[pos - buf_begin];
+}
+
+inline PostingList::Iterator& PostingList::Iterator::operator++() {
+    ++pos;
+    if (pos - buf_begin >= buf_size && pos < list->doc_cnt) {
+        _fill();
+    }
+    return *this;
+}
+
+inline bool PostingList::Iterator::is_end() const {
+    return pos >= list->doc_cnt;
+}
+
+inline std::size_t PostingList::Iterator::rank() const {
+    return pos;
+}
+
+/**
+ * @brief 拉链上 doc_id 在 [begin_doc, end_doc) 内的只读游标
+ *        直接按 block 解码压缩拉链, 不拷贝拉链, 也不申请堆内存; 召回, WAND, 短语求交都通过它遍历倒排.
+ *        游标不持有拉链, 使用期间须由调用方保证拉链(索引快照)不被释放
+ */
+class PostingCursor {
+public:
+    using END_DOC = std::integral_constant<uint32_t, UINT32_MAX>;
+
+    explicit PostingCursor(const PostingList &list,
+            uint32_t begin_doc = 0,
+            uint32_t end_doc = END_DOC::value);
+
+    // 当前 doc_id, 遍历完时为 END_DOC
+    uint32_t doc_id() const { return curr_doc; }
+    bool is_end() const { return END_DOC::value == curr_doc; }
+    // 移到下一个 doc, 返回新的 doc_id
+    uint32_t next();
+    /**
+     * @brief 移到第一个 >= target 的 doc, target 不大于当前 doc_id 时不移动
+     * @return 新的 doc_id
+     */
+    uint32_t advance_to(uint32_t target);
+    // 当前 doc 在整个拉链中的下标, 用于取 PositionList 中的位置信息
+    std::size_t rank() const { return iter.rank(); }
+    // 遍历代价的估计(拉链长度), 多路求交时用代价最小的游标驱动
+    std::size_t cost() const { return list_size; }
+
+private:
+    void _update_doc_id();
+
+private:
+    PostingList::Iterator iter;
+    uint32_t end_doc;
+    uint32_t curr_doc;
+    std::size_t list_size;
+};
+
+/**
+ * @brief 倒排拉链的位置信息(可选), 与 PostingList 按下标对齐
+ *        第 i 个 doc 的位置为 positions[offsets[i], offsets[i + 1]),
+ *        值为 term 在 doc 切词结果中的下标(不计空白 term), 升序
+ */
+class PositionList {
+public:
+    PositionList();
+
+    // 在第 rank 个 doc 处插入其位置信息
+    void insert(std::size_t rank, const std::vector<uint16_t> &pos);
+    // 删除第 rank 个 doc 的位置信息
+    void remove(std::size_t rank);
+    // 追加另一个位置列表, 与 PostingList::append 配合使用
+    void append(const PositionList &other);
+
+    const uint16_t* begin(std::size_t rank) const;
+    const uint16_t* end(std::size_t rank) const;
+
+    // doc 个数
+    std::size_t size() const;
+    bool empty() const;
+    std::size_t memory_usage() const;
+
+    void dump(BinaryWriter &writer) const;
+    bool load(BinaryReader &reader);
+
+private:
+    std::vector<uint32_t> offsets; // doc 个数 + 1, 无位置信息时为空
+    std::vector<uint16_t> positions;
+};
+
+inline uint32_t PostingCursor::next() {
+    if (!is_end()) {
+        ++iter;
+        _update_doc_id();
+    }
+    return curr_doc;
+}
+
+inline void PostingCursor::_update_doc_id() {
+    curr_doc = iter.is_end() || *iter >= end_doc ? END_DOC::value : *iter;
+}
+
+}; // end of namespace tiny_engine
+#endif // __POSTING_LIST_H_
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
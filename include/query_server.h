@@ -0,0 +1,114 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    query_server.h
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 18:10:27
+*   @brief:   多线程检索服务(./bin/main -d 2)
+*
+*   监听 unix socket 或本机 TCP 端口(SERVER_ADDRESS), 每行一个 JSON 请求, 每个请求返回一行 JSON:
+*     请求: {"id": 1, "query": "...", "timeout_ms": 50}, id 可选, 原样返回;
+*           timeout_ms 可选, 不填时使用 SEARCH_TIMEOUT_MS
+*     响应: {"id": 1, "status": 0, "msg": "ok", "cost_us": 1234, "degrade": ["skip_model"],
+*            "results": [{"title": "...", "url": "...", "score": 0.5}, ...]}
+*           degrade 为超出时间预算时触发的降级, 见 DEGRADE_FLAG
+*   每个连接一个读线程(连接断开后在 accept 循环中回收), 将请求放入有界队列(SERVER_QUEUE_SIZE);
+*   MAX_PARALLEL_TASKS 个 worker 从队列取请求, 共用同一个 TinyEngine 检索. 队列满时读线程阻塞, 不再读取该连接的请求(背压).
+*   同一连接上的多个请求可能乱序返回, 客户端按 id 对应
+*
+*****************************************************************/
+
+#ifndef __QUERY_SERVER_H_
+#define __QUERY_SERVER_H_
+
+#include "common.h"
+#include "log_util.h"
+#include "time_util.h"
+#include "config_util.h"
+#include "socket_util.h"
+#include "table.h"
+#include "../third_party/jieba/limonp/Condition.hpp" // BoundedBlockingQueue.hpp 未自行包含
+#include "../third_party/jieba/limonp/BoundedBlockingQueue.hpp"
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <unordered_set>
+#include <csignal>
+
+namespace tiny_engine {
+
+class QueryServer {
+public:
+    using QUEUE_SIZE = std::integral_constant<int, 1024>;
+    using WORKER_NUM = std::integral_constant<int, 8>;
+    using IDLE_TIMEOUT_MS = std::integral_constant<int, 60000>;
+    // 响应中的 status
+    using STATUS_OK = std::integral_constant<int, 0>;
+    using STATUS_BAD_REQUEST = std::integral_constant<int, 1>;
+
+    explicit QueryServer(const TinyEngine* engine,
+            const std::string &config = "./conf/sys.conf");
+
+    bool init();
+
+    /**
+     * @brief 监听直到 stop() 被调用, 返回前处理完已入队的请求
+     * @param[in] address: "tcp:<port>" 监听 127.0.0.1:<port>, 否则为 unix socket 路径;
+     *                     为空时使用配置中的 SERVER_ADDRESS
+     */
+    bool run(const std::string &address = std::string());
+    // 可在信号处理函数中调用
+    static void stop();
+
+    /**
+     * @brief 处理一行 JSON 请求, 返回一行 JSON 响应(不含 '\n'),
+     *        请求格式错误时 status 为 STATUS_BAD_REQUEST
+     */
+    std::string handle_request(const std::string &line) const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(QueryServer);
+
+    // 一个客户端连接, 读线程和处理其请求的 worker 共同持有, 最后一个持有者释放时关闭
+    struct Connection {
+        explicit Connection(int fd) : fd(fd) {}
+        ~Connection() { SocketUtil::close_fd(fd); }
+
+        int fd;
+        std::mutex write_mutex; // 多个 worker 可能同时写同一个连接
+    };
+
+    struct Request {
+        std::shared_ptr<Connection> conn;
+        std::string line;
+        struct timeval enqueue_time;
+    };
+
+    int _listen(const std::string &address) const;
+    void _read_loop(std::shared_ptr<Connection> conn);
+    // 取到 nullptr 时退出
+    void _work_loop();
+
+private:
+    const TinyEngine* engine;
+    std::shared_ptr<ConfigUtil> configs;
+    std::string server_address;
+    int worker_num;
+    int queue_size;
+    std::unique_ptr<limonp::BoundedBlockingQueue<std::shared_ptr<Request>>> queue;
+
+    std::mutex conn_mutex;
+    std::unordered_set<int> conn_fds; // 读线程未结束的连接, 退出时 shutdown 以唤醒阻塞的读
+
+    std::atomic<uint64_t> served_cnt;
+    std::atomic<uint64_t> total_cost_us; // 含排队时间
+    static volatile sig_atomic_t is_stopped;
+};
+
+}; // end of namespace tiny_engine
+#endif // __QUERY_SERVER_H_
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,135 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    search_pipeline.h
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 19:02:44
+*   @brief:   流水线检索
+*
+*   将 TinyEngine::search 拆成 切词 -> 召回 -> 排序 -> 截断输出 四个阶段, 每个阶段有自己的
+*   worker 线程, 阶段之间用有界队列连接: 第 N+1 个 query 切词时第 N 个 query 可以在排序,
+*   批量检索时提高吞吐. 输出阶段只有一个线程, 按提交顺序回调, 结果与依次调用 search 一致.
+*   每个阶段统计入队时的队列长度、排队及处理耗时, stop() 时打印, 用于定位瓶颈阶段.
+*
+*****************************************************************/
+
+#ifndef __SEARCH_PIPELINE_H_
+#define __SEARCH_PIPELINE_H_
+
+#include "common.h"
+#include "log_util.h"
+#include "str_util.h"
+#include "time_util.h"
+#include "config_util.h"
+#include "table.h"
+#include "../third_party/jieba/limonp/Condition.hpp" // BoundedBlockingQueue.hpp 未自行包含
+#include "../third_party/jieba/limonp/BoundedBlockingQueue.hpp"
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <map>
+#include <functional>
+
+namespace tiny_engine {
+
+enum PIPELINE_STAGE {
+    STAGE_SEGMENT = 0,
+    STAGE_RECALL,
+    STAGE_RANK,
+    STAGE_OUTPUT,
+    STAGE_NUM
+};
+
+// 流水线中的一个检索请求
+class SearchTask {
+public:
+    explicit SearchTask(const std::string &query = std::string()) :
+        seq(0), ctx(query), is_ok(false) {}
+public:
+    uint64_t seq; // 提交顺序
+    SearchContext ctx;
+    bool is_ok; // 切词失败时为 false, 跳过后续阶段
+    std::vector<TinyEngine::StrStrPair> result;
+    std::vector<float> scores;
+    struct timeval submit_time;
+    struct timeval enqueue_time; // 进入当前阶段队列的时间
+    std::function<void(const SearchTask&)> done;
+};
+
+class SearchPipeline {
+public:
+    using QUEUE_SIZE = std::integral_constant<int, 64>;
+    using STAGE_WORKER_NUM = std::integral_constant<int, 2>;
+    using Callback = std::function<void(const SearchTask&)>;
+
+    // 一个阶段的统计
+    struct StageStats {
+        StageStats() :
+            depth(0), task_cnt(0), busy_us(0), wait_us(0), depth_sum(0), max_depth(0) {}
+        // 当前队列长度, 含阻塞在 Push 上的任务(limonp 的 BoundedBlockingQueue::size 无法编译)
+        std::atomic<uint64_t> depth;
+        std::atomic<uint64_t> task_cnt;
+        std::atomic<uint64_t> busy_us;   // 处理耗时
+        std::atomic<uint64_t> wait_us;   // 在队列中等待的耗时
+        std::atomic<uint64_t> depth_sum; // 入队后的队列长度之和
+        std::atomic<uint64_t> max_depth;
+    };
+
+    explicit SearchPipeline(const TinyEngine* engine,
+            const std::string &config = "./conf/sys.conf");
+    ~SearchPipeline();
+
+    bool init();
+    bool start();
+
+    /**
+     * @brief 提交一个 query, 切词阶段的队列满时阻塞; done 在输出阶段的线程中按提交顺序调用
+     *        只能在一个线程中调用
+     */
+    bool submit(const std::string &query, Callback done);
+
+    /**
+     * @brief 处理完已提交的 query 后停止所有线程, 并打印各阶段统计
+     */
+    void stop();
+
+    /**
+     * @brief 一个阶段的统计: 线程数, 处理的 query 数, 平均/最大队列长度, 平均排队及处理耗时
+     */
+    std::string stats(int stage) const;
+
+    static const char* stage_name(int stage);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(SearchPipeline);
+
+    using TaskQueue = limonp::BoundedBlockingQueue<std::shared_ptr<SearchTask>>;
+
+    void _push(int stage, std::shared_ptr<SearchTask> task);
+    // 取到 nullptr 时退出
+    void _work_loop(int stage);
+    void _run_stage(int stage, SearchTask &task) const;
+    // 输出阶段: 按 seq 顺序回调
+    void _output(std::shared_ptr<SearchTask> task);
+
+private:
+    const TinyEngine* engine;
+    std::shared_ptr<ConfigUtil> configs;
+    int queue_size;
+    int worker_num[STAGE_NUM];
+    std::unique_ptr<TaskQueue> queues[STAGE_NUM];
+    std::vector<std::thread> workers[STAGE_NUM];
+    StageStats stage_stats[STAGE_NUM];
+
+    uint64_t next_seq; // 只在提交线程中使用
+    uint64_t next_output_seq; // 只在输出线程中使用
+    std::map<uint64_t, std::shared_ptr<SearchTask>> pending_output; // 先于前序 query 完成的
+    bool is_running;
+};
+
+}; // end of namespace tiny_engine
+#endif // __SEARCH_PIPELINE_H_
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -16,6 +16,7 @@
 
 #include "common.h"
 #include "str_util.h"
+#include "hash_util.h"
 #include "log_util.h"
 #include "config_util.h"
 #include "node_def.h"
@@ -40,23 +41,64 @@ public:
 
     bool get_token(const std::string &str,
             std::vector<TermNode> &tokens,
-            TOKEN_TYPE type = MIX_MODE);
+            TOKEN_TYPE type = MIX_MODE) const;
 
-    bool update_global_info(
+    /**
+     * @brief 统计每个 term 的频次/首次出现位置/所有 offset, 并填充 tokens 的 dup
+     *        query 以签名为 key; doc 以 term_id 为 key, 调用前需已分配 term_id
+     */
+    static bool update_global_info(
             std::vector<TermNode> &tokens,
-            std::unordered_map<std::size_t, GlobalTermInfo> &out) const;
+            TermInfoMap<std::size_t> &out);
+    static bool update_global_info(
+            std::vector<TermNode> &tokens,
+            TermInfoMap<uint32_t> &out);
 
 private:
     DISALLOW_COPY_AND_ASSIGN(Segment);
 
     bool _get_token(const std::string &str,
             std::vector<cppjieba::Word> &seg_results,
-            TOKEN_TYPE type = MIX_MODE);
+            TOKEN_TYPE type = MIX_MODE) const;
+
+    template <typename Key, typename KeyFunc>
+    static bool _update_global_info(
+            std::vector<TermNode> &tokens,
+            KeyFunc key_func,
+            TermInfoMap<Key> &out);
 
 private:
     std::shared_ptr<cppjieba::Jieba> jieba;
 };
 
+template <typename Key, typename KeyFunc>
+bool Segment::_update_global_info(
+            std::vector<TermNode> &tokens,
+            KeyFunc key_func,
+            TermInfoMap<Key> &out) {
+    EXPECT_FALSE_OR_RETURN(tokens.empty(), false);
+    EXPECT_TRUE_OR_DO(out.empty(), out.clear());
+
+    std::size_t pre_term_sign = 0;
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+        auto &token = tokens[i];
+        auto key = key_func(token);
+        auto tf = out.contains(key) ? 1 : 0;
+        token.dup = tf + 1;
+
+        auto &gti = out[key];
+        if (tf > 0) {
+            gti.term_freq += 1;
+            gti.offsets.push_back(token.offset);
+        } else {
+            gti = GlobalTermInfo(pre_term_sign, 1, i);
+            gti.offsets.push_back(token.offset);
+        }
+        pre_term_sign = token.token_sign;
+    }
+    return true;
+}
+
 }; // end of namespace tiny_engine
 #endif // __SEGMENT_H_
 
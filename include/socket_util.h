@@ -0,0 +1,110 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    socket_util.h
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 16:20:43
+*   @brief:   unix domain socket / 本机 TCP 的简单封装, 供 broker, 分片进程及检索服务使用
+*
+*****************************************************************/
+
+#ifndef __SOCKET_UTIL_H_
+#define __SOCKET_UTIL_H_
+
+#include "common.h"
+#include "log_util.h"
+#include <string>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace tiny_engine {
+
+class SocketUtil {
+public:
+    /**
+     * @brief 在 path 上监听, 已存在的同名文件会先删除
+     * @return 监听 fd, 失败返回 -1
+     */
+    static int listen_unix(const std::string &path, int backlog = 128);
+    /**
+     * @brief 在 127.0.0.1:port 上监听, 只接受本机连接
+     * @return 监听 fd, 失败返回 -1
+     */
+    static int listen_tcp(int port, int backlog = 128);
+    /**
+     * @brief 连接 path, 成功后 fd 为非阻塞
+     * @return fd, 失败返回 -1
+     */
+    static int connect_unix(const std::string &path);
+
+    static bool set_nonblocking(int fd);
+    // 读超时, 防止对端不发数据时一直阻塞
+    static bool set_recv_timeout(int fd, int timeout_ms);
+
+    /**
+     * @brief 写完 data 为止, 非阻塞 fd 写满时等待可写; 对端关闭时返回 false, 不产生 SIGPIPE
+     */
+    static bool write_all(int fd, const std::string &data);
+    /**
+     * @brief 读一行(不含 '\n'), buf 中保存已读但未消费的数据
+     * @return 读到完整一行时返回 true, 对端关闭或出错时返回 false
+     */
+    static bool read_line(int fd, std::string &buf, std::string &line);
+
+    static void close_fd(int &fd);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(SocketUtil);
+
+private:
+    SocketUtil();
+    static bool _fill_unix_addr(const std::string &path, struct sockaddr_un &addr);
+};
+
+/**
+ * @brief 每个连接一个处理线程, 线程结束时自行标记;
+ *        accept 循环中 reap 已结束的线程, 断开的连接不会一直占用线程栈直到退出
+ *        只在 accept 所在的线程中调用, 不加锁
+ */
+class ConnThreadGroup {
+public:
+    ConnThreadGroup() {}
+    ~ConnThreadGroup();
+
+    // 在新线程中执行 func
+    void start(std::function<void()> func);
+    // join 已结束的线程, 返回回收的个数
+    std::size_t reap();
+    // 等待所有线程结束
+    void join_all();
+    std::size_t size() const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(ConnThreadGroup);
+
+    struct ConnThread {
+        ConnThread() : is_done(false) {}
+
+        std::thread thread;
+        std::atomic<bool> is_done;
+    };
+
+private:
+    std::list<std::unique_ptr<ConnThread>> threads;
+};
+
+}; // end of namespace tiny_engine
+#endif // __SOCKET_UTIL_H_
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -32,6 +32,8 @@ public:
     static std::string left_trim_with(const std::string &str, char ch);
     static std::string right_trim_with(const std::string &str, char ch);
     static std::string trim_with(const std::string &str, char ch);
+    // ȥβհ, мĿհ׺ϲΪһո
+    static std::string squeeze_space(const std::string &str);
 
     static std::string to_lower_case(const std::string &str);
     static std::string to_upper_case(const std::string &str);
@@ -56,11 +58,25 @@ public:
     static std::string gbk_to_utf8(const std::string &str);
     static std::string utf8_to_gbk(const std::string &str);
 
+    /**
+     * @brief doc/term ǩ,  HashUtil::hash64; ׼ʵ޹, 
+     */
     static std::size_t str_to_sign(const std::string &str);
     
     // ַ
     static std::size_t get_char_len(const std::string &str);
     static std::size_t get_char_len(const char* str);
+    /**
+     * @brief utf8 Ϊ unicode , Ƿֽڰֽԭ
+     */
+    static void utf8_to_unicode(const std::string &str, std::vector<uint32_t> &code_points);
+    /**
+     * @brief  [offset, offset + len) Ϊ utf8,  utf8_to_unicode (Ϸ utf8 ʱ)
+     *        ڰдʵ offset/length ȡ term 
+     */
+    static std::string unicode_to_utf8(const std::vector<uint32_t> &code_points,
+            std::size_t offset,
+            std::size_t len);
 
     static std::string to_str(std::size_t size, const char* fmt, ...);
 
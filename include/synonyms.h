@@ -16,6 +16,7 @@
 #include "log_util.h"
 #include "str_util.h"
 #include "node_def.h"
+#include "lru_cache.h"
 #include <unordered_map>
 #include <string>
 
@@ -26,10 +27,17 @@ using std::unordered_map;
 
 class Synonyms {
 public:
+    using SYN_CACHE_SIZE_MB = std::integral_constant<int, 0>;
+
     Synonyms() {}
     bool init(std::shared_ptr<ConfigUtil> configs);
     bool get_syns(const string &term, vector<string> &out) const;
+    /**
+     * @brief 开启缓存(SYN_CACHE_SIZE_MB)时, 有同义词的 term 的结果按 term 缓存
+     */
     bool get_syns(const string &term, vector<SynTermNode> &out) const;
+    // 缓存的统计, 未开启时为空
+    std::string get_cache_stats() const;
     float similarity(const string &first, const string &second);
 
 private:
@@ -40,6 +48,9 @@ private:
 private:
     unordered_map<string, string> term_idx_dict; // term, cluster_id
     unordered_map<string, vector<string>> idx_terms_dict; // cluster_id, terms
+    // term, 过滤后的同义词; 词典只读, 版本号固定为 0
+    using SynCache = LruCache<std::shared_ptr<const vector<SynTermNode>>>;
+    std::unique_ptr<SynCache> syn_cache;
 };
 
 };
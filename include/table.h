@@ -22,6 +22,11 @@
 #include "node_def.h"
 #include "segment.h"
 #include "synonyms.h"
+#include "index_io.h"
+#include "lru_cache.h"
+#include "pair_cache.h"
+#include "term_dict.h"
+#include "task_pool.h"
 #ifdef XGBOOST
 #include "xgboost_mgr.h"
 #endif
@@ -31,17 +36,144 @@
 #include <unordered_map>
 #include <string>
 #include <algorithm>
+#include <queue> // priority_queue
+#include <functional> // greater, function
+#include <thread>
 #include <numeric> // accumulate
 #include <memory> // shared_ptr
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include <fstream>
 #include <cstring>
 
 namespace tiny_engine {
 
+using InvTable = std::unordered_map<std::size_t, std::shared_ptr<InvTermInfo>>;
+
+// ʱԤʱĽ, λ
+enum DEGRADE_FLAG {
+    DEGRADE_NONE = 0,
+    DEGRADE_SKIP_SYN_RECALL = 1 << 0,  // ٻʱչͬ
+    DEGRADE_SKIP_STR_FEATURE = 1 << 1, //  order_overlap/distance ַ
+    DEGRADE_SHRINK_2ND_SORT = 1 << 2,  // ټ doc 
+    DEGRADE_SKIP_MODEL = 1 << 3,       // ģʹ,  vsm ÷
+};
+
+// 㵥Ԫ, ÿԪһ; ĵԪǰ
+enum FEATURE_CALC {
+    CALC_VSM = 0,
+    CALC_BM25,
+    CALC_CQR_CTR,
+    CALC_SCATTER_OVERLAP,
+    CALC_TERM_SEQ, // м: query/title  term_id , term ȵ LCS/༭빲
+    CALC_TERM_LCSEQ,
+    CALC_TERM_LCSTR,
+    CALC_TERM_EDIST,
+    CALC_STR_LCSEQ,
+    CALC_STR_LCSTR,
+    CALC_STR_EDIST,
+    CALC_DISORDER,
+    CALC_DIVERSITY,
+    CALC_PROXIMITY,
+    CALC_NUM
+};
+
+/**
+ * @brief μʱԤ, ׶ΰñǷ񽵼; budget_us Ϊ 0 ʱʱ
+ */
+class SearchDeadline {
+public:
+    // ʱﵽԤЩʱ, δӦĽ
+    static constexpr float SYN_RECALL_RATIO = 0.3;
+    static constexpr float STR_FEATURE_RATIO = 0.5;
+    static constexpr float SHRINK_SORT_RATIO = 0.7;
+    static constexpr float MODEL_RATIO = 0.9;
+
+    explicit SearchDeadline(uint64_t budget_us = 0);
+
+    // ڿʼʱ
+    void reset(uint64_t budget_us);
+    uint64_t elapsed_us() const;
+    // ʱﵽԤ ratio ʱ true, ʱʱ false
+    bool is_at_risk(float ratio) const;
+
+public:
+    uint64_t budget_us;
+    struct timeval begin_time;
+};
+
+/**
+ * @brief : doc_id  [base_doc, end_doc()) ڵ/
+ *        ֻη޸, ɾ doc ڿյ deleted_docs , ϲʱ;
+ *        memtable ÿдһ޸, ڵֻε doc
+ */
+class IndexSegment {
+public:
+    explicit IndexSegment(uint32_t base = 0);
+
+    uint32_t end_doc() const;
+    std::shared_ptr<DocInfo> get_doc_info(const std::size_t &doc_sign) const;
+    std::shared_ptr<DocInfo> get_doc_info_by_id(uint32_t doc_id) const;
+    std::shared_ptr<InvTermInfo> get_term_info(const std::size_t &term_sign) const;
+
+public:
+    uint32_t base_doc; // εһ doc_id
+    // doc_sign, doc_info
+    std::unordered_map<std::size_t, std::shared_ptr<DocInfo>> forward_table;
+    // doc_id - base_doc, doc_info; ɾ doc Ϊ nullptr
+    std::vector<std::shared_ptr<DocInfo>> doc_list;
+    // term_sign, term_info
+    InvTable invert_table;
+};
+
+/**
+ * @brief һ: ֻ + һ memtable
+ *        ֻ֮, ѯ߳; ߸ʱһ¿(ֻƶָ뼰 memtable)
+ *        ޸ĺ滻, ɿһѯͷ
+ */
+class IndexData {
+public:
+    IndexData();
+
+    std::shared_ptr<DocInfo> get_doc_info(const std::size_t &doc_sign) const;
+    std::shared_ptr<DocInfo> get_doc_info_by_id(uint32_t doc_id) const;
+    // һе term Ϣ, ֻȡ/ȵ, ͳ get_term_idf
+    std::shared_ptr<InvTermInfo> get_term_info(const std::size_t &term_sign) const;
+    /**
+     * @brief  [begin_doc, end_doc) ཻĸ term ĵ, ε˳(doc_id )
+     */
+    void get_term_infos(const std::size_t &term_sign,
+            uint32_t begin_doc,
+            uint32_t end_doc,
+            std::vector<std::shared_ptr<InvTermInfo>> &term_infos) const;
+    /**
+     * @brief ɸε term_freq ֮ͼ idf,  InvTermInfo::idf ֻʱʹ
+     */
+    float get_term_idf(const std::size_t &term_sign) const;
+    bool is_deleted(uint32_t doc_id) const;
+    // һ doc  doc_id
+    uint32_t end_doc() const;
+
+public:
+    //  doc_id , һ memtable, ֻ
+    std::vector<std::shared_ptr<IndexSegment>> segments;
+    // ֻɾ doc_id
+    std::shared_ptr<const std::unordered_set<uint32_t>> deleted_docs;
+    std::size_t doc_cnt; // Ч doc 
+    uint64_t sum_doc_len;
+    float avg_doc_len;
+    uint64_t generation; // ÿ add_index/delete_index һ, ϲβ; ڽʧЧ
+};
+
 class Table {
 public:
     using MAX_FILE_PATH_LEN = std::integral_constant<int, 128>;
-    using TermDocArrPair = std::pair<std::size_t, std::unordered_set<DocNode, DocNodeHash>>;
+    using TermDocArrPair = std::pair<std::size_t, std::vector<uint32_t>>;
+    using MEMTABLE_SIZE = std::integral_constant<int, 1000>;
+    using MAX_SEGMENT_NUM = std::integral_constant<int, 4>;
+    // ֻɾ doc ñʱϲ, ɾ doc
+    using MAX_DELETED_PERCENT = std::integral_constant<int, 20>;
 
     Table();
     ~Table();
@@ -51,59 +183,213 @@ public:
     void set_fwd_path(const std::string &str);
     void set_inv_path(const std::string &str);
     void set_index_path(const std::string &str);
+    /**
+     * @brief ̲ʱ, ֻ doc_sign % partition_num == partition_id  doc
+     */
+    bool is_own_doc(const std::size_t &doc_sign) const;
+    // ٻص doc , 0 ʾ
+    void set_max_recall_num(int num);
 
+    // ǰ, ڼ䲻߸Ӱ
+    std::shared_ptr<const IndexData> get_index() const;
     std::size_t get_fwd_size() const;
     std::size_t get_inv_size() const;
     std::shared_ptr<DocInfo> get_doc_info(const std::size_t &doc_sign) const;
+    std::shared_ptr<DocInfo> get_doc_info_by_id(uint32_t doc_id) const;
     std::shared_ptr<InvTermInfo> get_term_info(const std::size_t &term_sign) const;
     float get_term_idf(const std::size_t &term_sign) const;
     std::string get_term_txt(const std::size_t &term_sign) const;
 
+    // /ʱ, ߸ʱƽά
     void calc_avg_doc_len();
     float get_avg_doc_len() const;
+    // е(λϢ)ռõֽ
+    std::size_t get_posting_memory() const;
+    // term Խͳ, δʱΪ
+    std::string get_pair_cache_stats() const;
 
-    bool hit_stopword(const std::size_t &term_sign) const;
+    // ͣôڼʱѷ term_id, ֵе term ͣô
+    bool hit_stopword(uint32_t term_id) const;
 
-    bool load_index_from_json();
+    /**
+     * @brief  dump Ķ/ļ(mmap), Ҫдʽ
+     */
+    bool load_index_from_bin();
     bool load_index_from_file(std::shared_ptr<Segment> wordseg);
+    /**
+     * @brief / dump ɶļ, δ仯ʱ
+     */
     bool dump_index() const;
 
+    /**
+     * @brief ߲//ɾ,  recall ִ
+     *        д֮䴮,  doc д memtable, ÿֻ memtable ޸ĺԭ滻;
+     *        memtable ﵽ memtable_size 󶳽Ϊֻ, ɺ̨̺߳ϲ
+     *         url ʱɾ doc,  doc µ doc_id
+     */
     bool add_index(std::shared_ptr<DocInfo> doc_info);
+    bool add_index(const std::vector<std::shared_ptr<DocInfo>> &docs);
     bool delete_index(const std::size_t &doc_sign);
 
     /**
-     * @brief ӵٻ
+     * @brief дʲ DocInfo, ʧʱ nullptr
+     */
+    static std::shared_ptr<DocInfo> make_doc_info(
+            std::shared_ptr<Segment> wordseg,
+            const std::string &title,
+            const std::string &url);
+
+    /**
+     * @brief ӵٻ,  doc_id ֳ index_shard_num Ƭٻ,
+     *        ƬֱһضϺٹ鲢
      * @param[in]:  query: queryfeature
      * @param[out]: result: feature
      */
     bool recall(
             std::shared_ptr<QueryInfo> query_info,
             std::vector<std::shared_ptr<ResInfo>> &result) const;
+    /**
+     * @brief ָĿٻ, ͬһĸ׶ʹͬһݿ
+     * @param[in] deadline: Ϊ nullptr ʱ, ʱﵽ SYN_RECALL_RATIO չͬ
+     * @param[out] degrade_flags: Ϊ nullptr ʱλϴĽ
+     */
+    bool recall(
+            const IndexData &index,
+            std::shared_ptr<QueryInfo> query_info,
+            std::vector<std::shared_ptr<ResInfo>> &result,
+            const SearchDeadline* deadline = nullptr,
+            uint32_t* degrade_flags = nullptr) const;
 
     /**
      * @brief  match_term_info
      * @param[in] term_node: ǰ term  query е
-     * @param[in] term_info: ǰ term  еϢe.g. idf ȣ
+     * @param[in] term_info: ǰ term  еϢ
+     * @param[in] idf: term (ж)е idf
      * @param[in] query_info: queryϢ
      * @param[in] doc_info: ǰ term  doc еϢ
      * @param[out] match_term_info
      */
     bool fill_match_term_info(
             std::shared_ptr<InvTermInfo> term_info,
+            float idf,
             std::shared_ptr<QueryInfo> query_info,
             std::shared_ptr<DocInfo> doc_info,
             std::shared_ptr<MatchTermInfo> mti) const;
 
     bool process_new_doc(
+            const IndexData &index,
             std::shared_ptr<QueryInfo> query_info,
             std::shared_ptr<InvTermInfo> term_info,
-            std::size_t doc_sign,
+            uint32_t doc_id,
             uint16_t term_idx_in_q,
             bool is_syn_recall,
-            std::unordered_map<std::size_t, std::shared_ptr<ResInfo>> &res_map) const;
+            std::unordered_map<uint32_t, std::shared_ptr<ResInfo>> &res_map) const;
+
+    /**
+     * @brief /ڽԼ doc, λʱֱõеλ, дм
+     * @param[out] doc_ids: , 󽻺ƴ
+     */
+    bool match_phrase(
+            const IndexData &index,
+            const PhraseNode &phrase,
+            std::vector<uint32_t> &doc_ids) const;
+
+    /**
+     * @brief  doc дÿ term λ(д±, ƿհ term)
+     */
+    static void calc_term_positions(
+            const std::vector<TermNode> &terms,
+            std::unordered_map<std::size_t, std::vector<uint16_t>> &out);
 
 private:
     DISALLOW_COPY_AND_ASSIGN(Table);
+
+    // WAND ٻһ term(ԭʻͬ)ĵα
+    struct WandCursor {
+        WandCursor(std::shared_ptr<InvTermInfo> info,
+                uint16_t idx,
+                bool syn,
+                float wei,
+                uint16_t tf,
+                uint32_t begin_doc,
+                uint32_t end_doc);
+        void next();
+        void advance_to(uint32_t target);
+
+        std::shared_ptr<InvTermInfo> term_info;
+        PostingCursor cursor; // ޶ڷƬ doc_id 
+        uint32_t doc_id; // ǰ doc_id, 򳬳ƬʱΪ UINT32_MAX
+        uint16_t term_idx; // Ӧԭ query е±
+        bool is_syn;
+        float weight; // idf, ͬٳԸдŶ
+        uint16_t query_tf;
+        float max_score; // ÷Ͻ: weight * min(query_tf, max_tf)
+    };
+
+    /**
+     * @brief  term е doc ٻؽ: ԭʱ match_term_info, ֻͬٻ doc
+     */
+    bool _merge_recall_doc(
+            const IndexData &index,
+            std::shared_ptr<QueryInfo> query_info,
+            std::shared_ptr<InvTermInfo> term_info,
+            uint16_t term_idx,
+            bool is_syn_recall,
+            uint32_t doc_id,
+            std::unordered_map<uint32_t, std::shared_ptr<ResInfo>> &res_map) const;
+    /**
+     * @brief ٻһƬ(doc_id  [begin_doc, end_doc) ) doc, һض
+     * @param[in] phrase_docs: Լ doc, nullptr ʾûԼ
+     * @param[in] seed_docs: WAND ٻʱԤ top-k  doc(), nullptr ʾԤ
+     * @param[out] result:  _is_res_ahead 
+     * @param[out] is_syn_skipped: 򳬳ʱԤͬʱΪ true
+     */
+    bool _recall_shard(
+            const IndexData &index,
+            std::shared_ptr<QueryInfo> query_info,
+            const std::vector<uint32_t>* phrase_docs,
+            const std::vector<uint32_t>* seed_docs,
+            uint32_t begin_doc,
+            uint32_t end_doc,
+            const SearchDeadline* deadline,
+            std::vector<std::shared_ptr<ResInfo>> &result,
+            bool &is_syn_skipped) const;
+    /**
+     * @brief  doc  term ,  WAND ÷Ͻ粻ܽ top-k  doc,
+     *        ֻΪյ top max_recall_num  doc  ResInfo
+     * @param[in] phrase_docs: Լ doc, nullptr ʾûԼ
+     * @param[in] seed_docs: Ȱʵ÷ѵ doc(), ʹֵ̧֦, Ӱٻؽ
+     */
+    bool _wand_recall(
+            const IndexData &index,
+            std::shared_ptr<QueryInfo> query_info,
+            const std::vector<uint32_t>* phrase_docs,
+            const std::vector<uint32_t>* seed_docs,
+            uint32_t begin_doc,
+            uint32_t end_doc,
+            const SearchDeadline* deadline,
+            std::unordered_map<uint32_t, std::shared_ptr<ResInfo>> &res_map,
+            bool &is_syn_skipped) const;
+    // ʱԤʱչͬ
+    static bool _is_syn_recall_at_risk(const SearchDeadline* deadline);
+    // һ: term ǰ, ԭٻ, ٴ title ̵ǰ
+    static bool _is_res_ahead(
+            const std::shared_ptr<ResInfo> &lhs,
+            const std::shared_ptr<ResInfo> &rhs);
+    static bool _is_phrase_miss(const std::vector<uint32_t>* phrase_docs, uint32_t doc_id);
+    /**
+     * @brief ¼ query  term ; WAND ٻ top-k ʱѡ idf ֮ term ,
+     *        佻(л뻺)
+     * @return ûпõ term , 򽻼ֵûʱ nullptr
+     */
+    std::shared_ptr<const PairCache::DocList> _get_pair_docs(
+            const IndexData &index,
+            std::shared_ptr<QueryInfo> query_info) const;
+    //  term ڸе, ȥɾ doc
+    static void _intersect_pair(
+            const IndexData &index,
+            const PairCache::TermPair &pair,
+            PairCache::DocList &docs);
     /**
      * @brief Ž鲢
      * @param[in]  doc_array: ÿtermӦĵ
@@ -114,13 +400,38 @@ private:
             const std::vector<TermDocArrPair> &doc_array,
             std::vector<std::shared_ptr<ResInfo>> &result) const;
 
-    bool _load_fwd_table();
-    bool _load_inv_table();
+    // һԼ doc, ׷ӵ doc_ids
+    bool _match_segment_phrase(
+            const IndexData &index,
+            const IndexSegment &segment,
+            const PhraseNode &phrase,
+            std::vector<uint32_t> &doc_ids) const;
+
+    bool _get_term_positions(
+            const IndexData &index,
+            std::shared_ptr<InvTermInfo> term_info,
+            std::size_t rank,
+            uint32_t doc_id,
+            std::vector<uint16_t> &positions) const;
+    /**
+     * @brief жһ doc ǷԼ
+     * @param[in] positions: ÿ term  doc еλ,  phrase.term_signs 
+     */
+    static bool _is_phrase_hit(
+            const PhraseNode &phrase,
+            const std::vector<std::vector<uint16_t>> &positions);
+
+    // ǰ, ѯʱȡһ, ʹͬһ
+    std::shared_ptr<const IndexData> _get_index() const;
+
+    bool _load_fwd_table(IndexFileHeader &header);
+    bool _load_inv_table(IndexFileHeader &header);
+    void _clear_index();
 
     bool _load_stopword(const std::string &file);
 
-    bool _dump_fwd_table() const;
-    bool _dump_inv_table() const;
+    bool _dump_fwd_table(const IndexSegment &segment) const;
+    bool _dump_inv_table(const IndexSegment &segment) const;
 
     /**
      * @brief ץȡtitleкܶվ, Ҫȥ, ӰԼ׼ȷ; e.g.
@@ -131,16 +442,71 @@ private:
     bool remove_site_description(const std::string &title, std::string &real_title);
     /**
      * @brief
-     * @param[in] doc_info: docfeature
-     * @param[in] update: Ƿterm wei, ĳ, Ӱ콨ٶ
+     * @param[out] segment: дĶ
+     * @param[in] doc_info: docfeature, term wei ɵ÷յ idf 
      */
-    bool _add_to_fwd_table(std::shared_ptr<DocInfo> doc_info, bool update_wei = false);
+    bool _add_to_fwd_table(IndexSegment &segment, std::shared_ptr<DocInfo> doc_info) const;
     /**
      * @brief
      * @param[in] doc_info: docfeature(д)
-     * @param[in] update_idf: Ƿidf, µŵĳ, Ӱ콨ٶ
+     * @param[out] inv_table: дĵ, нʱΪ̵߳ľֲ
      */
-    bool _add_to_inv_table(std::shared_ptr<DocInfo> doc_info, bool update_idf = false);
+    bool _add_to_inv_table(std::shared_ptr<DocInfo> doc_info, InvTable &inv_table) const;
+    /**
+     * @brief ¿ɾ doc: memtable е doc ֱɾ, ֻе doc  deleted
+     * @param[in/out] deleted: ¿յ deleted_docs, һõʱŸ
+     */
+    bool _remove_doc(IndexData &index,
+            std::shared_ptr<DocInfo> doc_info,
+            std::unordered_set<std::size_t> &detached,
+            std::shared_ptr<std::unordered_set<uint32_t>> &deleted);
+    /**
+     * @brief  memtable /ɾ doc, е InvTermInfo ȸ޸
+     * @param[in/out] detached:  memtable иƹ term
+     */
+    bool _remove_from_index(IndexSegment &segment,
+            std::shared_ptr<DocInfo> doc_info,
+            std::unordered_set<std::size_t> &detached);
+    /**
+     * @brief ߸ʱ,  doc 漰 InvTermInfo  memtable иһ, Ӱɿ
+     */
+    void _detach_term_info(IndexSegment &segment,
+            std::shared_ptr<DocInfo> doc_info,
+            std::unordered_set<std::size_t> &detached);
+    // memtable Ϊֻ, ֮ doc дµĿ memtable
+    static void _freeze_memtable(IndexData &index);
+    /**
+     * @brief ÿе idf  doc  term wei/vec_module/wei_sum
+     */
+    void _calc_doc_wei(const IndexData &index, std::shared_ptr<DocInfo> doc_info) const;
+    /**
+     * @brief ֲźϲεĵ, ֲе doc_id ڶе doc_id
+     */
+    bool _merge_inv_table(IndexSegment &segment, InvTable &partial_table);
+    /**
+     * @brief ڵɶκϲΪһ, ɾ doc ؽ, doc_id 
+     * @param[in] index: ṩ deleted_docs  idf õͳ
+     */
+    std::shared_ptr<IndexSegment> _merge_segments(const IndexData &index,
+            std::size_t first,
+            std::size_t last) const;
+    /**
+     * @brief ѡϲֻ [first, last]: ֻγ max_segment_num ʱϲ
+     *        doc ֮ٵ, ϲɾߵĶ
+     * @return Ҫϲʱ false
+     */
+    bool _pick_merge_segments(const IndexData &index,
+            std::size_t &first,
+            std::size_t &last) const;
+    // ̨ϲ߳
+    void _merge_loop();
+    void _stop_merge_thread();
+    /**
+     * @brief  task_num ִ߳ task(task_idx), ȫ󷵻; ֻڽ,
+     *        ѯʱķƬٻʹóפ recall_pool
+     */
+    static void _run_parallel(std::size_t task_num,
+            const std::function<void(std::size_t)> &task);
     /**
      * @brief еŵidf, , ԽͿ
      */
@@ -154,16 +520,72 @@ private:
     char* forward_file_path;
     char* invert_file_path;
     char* index_file_path;
-    float avg_doc_len;
     int max_syn_term_recall;
+    std::atomic<bool> is_index_dirty; // Ƿδ dump ޸
+    bool build_position_index; // ǷڵбλϢ
+    bool is_wand_recall; // Ƿ WAND  top-k ٻ, ٻȫ doc ض
+    int max_parallel_tasks; // ߳
+    int index_shard_num; // ٻʱķƬ, ɵ̺߳ recall_pool ٻ
+    int partition_id; // ̲ʱ̵ķƬ
+    int partition_num; // ̲ʱķƬ
+    int max_recall_num;
+    int memtable_size; // memtable  doc 
+    int max_segment_num; // ֻ, ʱ̨ϲ
 
 private:
-    // doc_sign, doc_info
-    std::unordered_map<std::size_t, std::shared_ptr<DocInfo>> forward_table;
-    // term_sign, term_info
-    std::unordered_map<std::size_t, std::shared_ptr<InvTermInfo>> invert_table;
-    // stopword set
-    std::unordered_set<std::size_t> stopword;
+    // ǰ, ͨ std::atomic_load/atomic_store д
+    std::shared_ptr<IndexData> index_data;
+    // д, 
+    std::mutex update_mutex;
+    std::thread merge_thread;
+    std::mutex merge_mutex;
+    std::condition_variable merge_cond;
+    bool is_merge_stopped;
+    // stopword λͼ, ±Ϊ term_id; غֻ
+    std::vector<bool> stopword;
+    // Ƶ term ԵĽ, ̨ھ߳õ stopword, 
+    std::unique_ptr<PairCache> pair_cache;
+    // Ƭٻصĳפ߳, INDEX_SHARD_NUM - 1 
+    std::unique_ptr<TaskPool> recall_pool;
+};
+
+/**
+ * @brief һμ״̬, д, ٻ, ׶֮䴫
+ *        TinyEngine  search ڼֻ, ߳øԵ SearchContext ɲ
+ */
+class SearchContext {
+public:
+    explicit SearchContext(const std::string &q = std::string(),
+            std::shared_ptr<const IndexData> idx = nullptr,
+            int timeout = -1);
+public:
+    std::string query;
+    int timeout_ms; // ʱԤ, С 0 ʱʹ SEARCH_TIMEOUT_MS, 0 Ϊʱ
+    SearchDeadline deadline; // prepare_query ʱʼʱ
+    uint32_t degrade_flags; // DEGRADE_FLAG
+    std::shared_ptr<const IndexData> index; // ʹͬһ
+    std::shared_ptr<QueryInfo> query_info; // query feature
+    std::vector<std::shared_ptr<ResInfo>> results_info; // ٻصdoc list
+};
+
+/**
+ * @brief һμ׶εĺʱ, /طʱͳ
+ */
+class SearchStat {
+public:
+    SearchStat() :
+        segment_us(0), recall_us(0), rank_us(0), output_us(0), total_us(0),
+        recall_num(0), degrade_flags(DEGRADE_NONE), is_ok(false), is_cache_hit(false) {}
+public:
+    uint64_t segment_us;
+    uint64_t recall_us;
+    uint64_t rank_us;
+    uint64_t output_us; // ض
+    uint64_t total_us;
+    std::size_t recall_num;
+    uint32_t degrade_flags; // DEGRADE_FLAG
+    bool is_ok; // дʧʱΪ false
+    bool is_cache_hit; // нʱ׶κʱΪ 0
 };
 
 class TinyEngine {
@@ -171,6 +593,15 @@ public:
     using MAX_INDEX_RECALL_NUM = std::integral_constant<int, 1000>;
     using MAX_SORT_NUM = std::integral_constant<int, 100>;
     using MAX_RESULT_NUM = std::integral_constant<int, 20>;
+    using SEARCH_TIMEOUT_MS = std::integral_constant<int, 0>;
+    // ʱ doc Сı
+    using SHRINK_2ND_SORT_DIVISOR = std::integral_constant<int, 4>;
+    using BATCH_THREAD_NUM = std::integral_constant<int, 8>;
+    using RESULT_CACHE_SIZE_MB = std::integral_constant<int, 0>;
+    using QUERY_CACHE_SIZE_MB = std::integral_constant<int, 0>;
+    // DEGRADE_SKIP_STR_FEATURE ʱļ㵥Ԫ: CALC_TERM_SEQ ~ CALC_STR_EDIST
+    using STR_FEATURE_CALCS = std::integral_constant<uint32_t,
+            ((1u << (CALC_STR_EDIST + 1)) - 1) & ~((1u << CALC_TERM_SEQ) - 1)>;
     using StrStrPair = std::pair<std::string, std::string>;
 
     TinyEngine(const std::string &config = "./conf/sys.conf",
@@ -181,20 +612,125 @@ public:
     bool stop();
 
     /**
-     * @brief
+     * @brief , ߳̿ɲ, Ҳ add_docs/delete_doc 
      * @query[in] query
      * @result[out] relevent result <titles, url>
+     * @scores[out] Ϊ nullptr ʱÿ÷,  result 
+     * @timeout_ms[in] ʱԤ, С 0 ʱʹ SEARCH_TIMEOUT_MS, 0 Ϊʱ;
+     *                 ԤıԽ, ٻ/򽵼Խ( DEGRADE_FLAG)
+     * @degrade_flags[out] Ϊ nullptr ʱĽ
+     * (RESULT_CACHE_SIZE_MB)ʱ, query ȥβհײϲհ, ԴΪ key;
+     * ֻδĽ, ʱ timeout_ms , º󻺴ĽʧЧ
+     */
+    bool search(const std::string &query,
+            std::vector<StrStrPair> &result,
+            std::vector<float>* scores = nullptr,
+            int timeout_ms = -1,
+            uint32_t* degrade_flags = nullptr) const;
+
+    /**
+     * @brief , ̸߳Դ queries ȡһ query  search
+     * @queries[in] query list
+     * @results[out]  queries , ʧܵ query Ϊ
+     * @stats[out] Ϊ nullptr ʱÿ query ׶εĺʱ,  queries 
+     * @thread_num[in] С 1 ʱʹе MAX_PARALLEL_TASKS
+     */
+    bool search_batch(const std::vector<std::string> &queries,
+            std::vector<std::vector<StrStrPair>> &results,
+            std::vector<SearchStat>* stats = nullptr,
+            int thread_num = 0) const;
+
+    /**
+     * @brief /query д/ͬʻͳ, δʱΪ
+     */
+    std::string get_cache_stats() const;
+
+    /**
+     * @brief ,  "skip_syn_recall"
+     */
+    static void get_degrade_names(uint32_t degrade_flags, std::vector<std::string> &names);
+
+    /**
+     * @brief search ĸ׶, εõȼ search,  SearchPipeline ڲִͬ߳
+     *        prepare_query:  ctx.timeout_ms ʼʱ, ȡ(ctx.index Ϊʱ)д,
+     *                       ʧʱӦ׶
+     *        recall: ٻص ctx.results_info
+     *        rank: 
+     *        fill_result: ضϺ׷ӵ result/scores,  result/scores, 
+     */
+    bool prepare_query(SearchContext &ctx) const;
+    bool recall(SearchContext &ctx) const;
+    bool rank(SearchContext &ctx) const;
+    void fill_result(const SearchContext &ctx,
+            std::vector<StrStrPair> &result,
+            std::vector<float>* scores = nullptr) const;
+    /**
+     * @brief ضϺĽ: query \t  title \t url \t , ÿһ;
+     *        DEBUG ʱȫ, ڼ
+     */
+    void dump_result(const SearchContext &ctx, std::ostream &os) const;
+
+    /**
+     * @brief ߲/ doc,  search ڲ̲ͬ߳
+     * @param[in] docs: <title, url>, url Ѵʱԭ doc
      */
-    bool search(const std::string &query, std::vector<StrStrPair> &result);
+    bool add_docs(const std::vector<StrStrPair> &docs);
+    bool delete_doc(const std::string &url);
+
+    /**
+     * @brief ļе,  init ֮ǰ
+     */
+    void set_config(const std::string &key, const std::string &value);
 
 private:
     DISALLOW_COPY_AND_ASSIGN(TinyEngine);
 
     bool _load_conf();
+    /**
+     * @brief Ҫ(ģ, Լģʱ vsm ÷)ѡ㵥Ԫ,
+     *        DEBUG ʱԱ
+     */
+    void _plan_features();
+    // 㵥Ԫ, ĵԪ, 
+    struct FeatureCalcNode {
+        const char* name;
+        std::vector<FEATURE_CALC> deps;
+        std::vector<FEATURE_ID> features;
+    };
+    //  FEATURE_CALC ±
+    static const std::vector<FeatureCalcNode>& _get_feature_calc_graph();
+    /**
+     * @brief ִ search ĸ׶, stat Ϊ nullptr ʱ¼׶κʱ
+     */
+    bool _search(SearchContext &ctx,
+            std::vector<StrStrPair> &result,
+            std::vector<float>* scores,
+            SearchStat* stat) const;
+    /**
+     * @brief Ȳ, δʱ _search δĽ
+     */
+    bool _search_with_cache(SearchContext &ctx,
+            std::vector<StrStrPair> &result,
+            std::vector<float>* scores,
+            SearchStat* stat) const;
     /**
      * @brief query feature, Ҫд
+     *         QUERY_CACHE_SIZE_MB ʱ, ޹صĲְ query , ֻ term Ȩÿμ
+     */
+    bool _fill_query_info(SearchContext &ctx) const;
+    /**
+     * @brief дʲ޹ص query Ϣ: terms(Ȩ), term_map, syns, phrases
+     */
+    bool _segment_query(SearchContext &ctx) const;
+    /**
+     * @brief /ڽ: "a b" Ϊȷ, "a b"~N ΪԼ
+     * @param[out] phrases: <, N>, ȷʱ N Ϊ 0
+     * @return ȥӺ query
      */
-    bool _fill_query_info(const std::string &query);
+    std::string _parse_phrase_operator(
+            const std::string &query,
+            std::vector<std::pair<std::string, int>> &phrases) const;
+    bool _fill_phrase_info(SearchContext &ctx, const std::string &text, int window) const;
     /**
      * @brief ٻ
      */
@@ -208,38 +744,49 @@ private:
             std::shared_ptr<ResInfo> result,
             std::vector<TermNode> &target);
     /**
-     * @brief 
+     * @brief ֻ _plan_features ѡ
      */
-    bool _calc_features(std::shared_ptr<ResInfo> result);
+    bool _calc_features(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const;
     /**
      * @brief ƥ
      */
-    bool _calc_cqr_ctr(std::shared_ptr<ResInfo> result);
+    bool _calc_cqr_ctr(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const;
     /**
      * @brief
      */
-    bool _calc_vsm(std::shared_ptr<ResInfo> result);
+    bool _calc_vsm(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const;
     /**
      * @brief bm25
      */
-    bool _calc_bm25(std::shared_ptr<ResInfo> result);
+    bool _calc_bm25(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const;
 
     float _calc_bm25_r_factor(uint16_t term_freq_in_query,
                               uint16_t term_freq_in_doc,
                               uint32_t doc_len,
-                              float avg_doc_len);
+                              float avg_doc_len) const;
     /**
-     * @brief 
+     * @brief , ֻ calc_mask е LCS
+     * @param[in] query_seq/title_seq: term_id (CALC_TERM_SEQ), Ҫ term ʱΪ
      */
-    void _calc_order_overlap(std::shared_ptr<ResInfo> result);
+    void _calc_order_overlap(
+            const SearchContext &ctx,
+            std::shared_ptr<ResInfo> result,
+            uint32_t calc_mask,
+            const std::vector<uint32_t> &query_seq,
+            const std::vector<uint32_t> &title_seq) const;
     /**
      * @brief ɢ
      */
-    void _calc_scatter_overlap(std::shared_ptr<ResInfo> result);
+    void _calc_scatter_overlap(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const;
     /**
-     * @brief termΪȼ༭롢ƫƾ
+     * @brief termΪȼ༭롢ƫƾ, ֻ calc_mask еĲ
      */
-    void _calc_distance(std::shared_ptr<ResInfo> result);
+    void _calc_distance(
+            const SearchContext &ctx,
+            std::shared_ptr<ResInfo> result,
+            uint32_t calc_mask,
+            const std::vector<uint32_t> &query_seq,
+            const std::vector<uint32_t> &title_seq) const;
     /**
      * @brief ̾
      */
@@ -249,21 +796,22 @@ private:
     /**
      * @brief disorder
      */
-    void _calc_disorder(std::shared_ptr<ResInfo> result);
-    std::size_t _calc_pair_sign(std::size_t term_sign_i, std::size_t term_sign_j);
+    void _calc_disorder(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const;
+    //  term_id ƴ term Ե key, ͻ
+    static uint64_t _calc_pair_key(uint32_t term_id_i, uint32_t term_id_j);
     /*
      * @brief ɢ
      */
-    void _calc_diversity(std::shared_ptr<ResInfo> result);
+    void _calc_diversity(std::shared_ptr<ResInfo> result) const;
     /**
      * @brief 
      */
-    bool _rank_results();
+    bool _rank_results(SearchContext &ctx) const;
 
     /**
      * @brief titleƮ
      */
-    std::string _title_highlight(std::shared_ptr<ResInfo> result);
+    std::string _title_highlight(std::shared_ptr<ResInfo> result) const;
 
 private:
     // һЩֵ
@@ -271,6 +819,11 @@ private:
     int _max_2nd_sort_num;
     int _max_result_num;
     bool _is_highlight_syn_term;
+    int _search_timeout_ms;
+    int _batch_thread_num;
+    // Ӱ, Ϊ key ǰ׺
+    std::string _result_cache_prefix;
+    uint32_t _feature_calc_mask; // λ 1 << FEATURE_CALC
 
     const float EPSILON = std::numeric_limits<float>::epsilon();
 
@@ -279,11 +832,19 @@ private:
     std::shared_ptr<Segment> wordseg;
     std::shared_ptr<Synonyms> wordsyn;
     std::unique_ptr<Table> table;
+    // һ query Ļ, ̹߳, ֻ
+    struct CachedResult {
+        std::vector<StrStrPair> result;
+        std::vector<float> scores;
+    };
+    using ResultCache = LruCache<std::shared_ptr<const CachedResult>>;
+    std::unique_ptr<ResultCache> result_cache; // δʱΪ nullptr
+    // query -> _segment_query Ľ, ֻ, ʱһټȨ; 汾Ź̶Ϊ 0
+    using QueryInfoCache = LruCache<std::shared_ptr<const QueryInfo>>;
+    std::unique_ptr<QueryInfoCache> query_info_cache;
 #ifdef XGBOOST
     std::unique_ptr<XGBoostMgr> xgb_mgr;
 #endif
-    std::shared_ptr<QueryInfo> query_info; // query feature
-    std::vector<std::shared_ptr<ResInfo>> results_info; // ٻصdoc list
 };
 
 }; // end of namespace tiny_engine
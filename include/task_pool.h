@@ -0,0 +1,75 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    task_pool.h
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 23:58:36
+*   @brief:   常驻线程池, 用于每次查询的分片召回
+*
+*   run(task_num, task) 将 task(0) ~ task(task_num - 1) 分给调用线程和池中的线程执行,
+*   调用线程先执行 task(0), 之后继续认领还没有开始的 task, 全部结束后返回.
+*   池中线程都在忙(多个请求并发召回)时调用线程自己执行完所有 task, 不会比串行慢.
+*   task 之间不能互相等待.
+*
+*****************************************************************/
+
+#ifndef __TASK_POOL_H_
+#define __TASK_POOL_H_
+
+#include "common.h"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+
+namespace tiny_engine {
+
+class TaskPool {
+public:
+    using Task = std::function<void(std::size_t)>;
+
+    explicit TaskPool(std::size_t thread_num);
+    ~TaskPool();
+
+    /**
+     * @brief 并行执行 task(0) ~ task(task_num - 1), 全部结束后返回; 可被多个线程并发调用
+     */
+    void run(std::size_t task_num, const Task &task);
+    void stop();
+    std::size_t thread_num() const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(TaskPool);
+
+    // 一次 run 调用, 调用线程和池中线程通过 next_idx 认领 task
+    struct Batch {
+        Batch(const Task* task, std::size_t task_num) :
+            task(task), task_num(task_num), next_idx(0), done_cnt(0) {}
+
+        const Task* task; // 只在认领到 task 时访问, 此时 run 一定还未返回
+        std::size_t task_num;
+        std::atomic<std::size_t> next_idx;
+        std::size_t done_cnt;
+        std::mutex mutex;
+        std::condition_variable done_cond;
+    };
+
+    // 认领并执行 batch 中的 task, 直到没有未开始的 task; done_cnt 为之前已执行完的个数
+    static void _run_batch(Batch &batch, std::size_t done_cnt = 0);
+    void _work_loop();
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::shared_ptr<Batch>> queue; // 每个元素让一个池中线程参与一次 batch
+    std::mutex queue_mutex;
+    std::condition_variable queue_cond;
+    bool is_stopped;
+};
+
+}; // end of namespace tiny_engine
+#endif // __TASK_POOL_H_
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,75 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    term_dict.h
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 23:05:37
+*   @brief:   term 字典: term 签名 -> 稠密的 term_id
+*
+*   term_id 从 0 开始连续分配, 建库/加载索引/加载停用词时分配, 只增不删, 不落盘;
+*   查询时只查找不分配, 不在字典中的 term 一定不在索引中.
+*   doc 内的 term_map 及停用词表以 term_id 为 key, 用有序数组/位图代替哈希表.
+*
+*   与索引快照一样, 查找读 atomic_load 取到的只读快照, 不加锁;
+*   新分配的 term 先放在加锁的 pending 中, publish 时(或 pending 较多时)合并成新快照再 atomic_store,
+*   只有 pending 非空时查找未命中快照才加锁查 pending
+*
+*****************************************************************/
+
+#ifndef __TERM_DICT_H_
+#define __TERM_DICT_H_
+
+#include "common.h"
+#include "node_def.h"
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+namespace tiny_engine {
+
+class TermDict {
+public:
+    using INVALID_ID = std::integral_constant<uint32_t, UINT32_MAX>;
+    // pending 达到快照大小的 1/PUBLISH_RATIO(且不少于 MIN_PUBLISH_NUM)时自动发布, 复制开销均摊为常数
+    using PUBLISH_RATIO = std::integral_constant<std::size_t, 4>;
+    using MIN_PUBLISH_NUM = std::integral_constant<std::size_t, 1024>;
+
+    // 进程内唯一的字典, 签名相同的 term 在所有索引中 term_id 相同
+    static TermDict& get_instance();
+
+    // 不存在时分配新的 term_id
+    uint32_t add_term(std::size_t term_sign);
+    // 不存在时返回 INVALID_ID
+    uint32_t get_term_id(std::size_t term_sign) const;
+    // 建库: 为切词结果分配 term_id
+    void add_terms(std::vector<TermNode> &terms);
+    // 查询: 为切词结果查找 term_id
+    void resolve_terms(std::vector<TermNode> &terms) const;
+    // 将 pending 合并进快照, 建库/加载索引后及发布新索引快照前调用, 之后的查找不再加锁
+    void publish();
+    std::size_t size() const;
+
+private:
+    TermDict();
+    DISALLOW_COPY_AND_ASSIGN(TermDict);
+
+    using TermIdMap = std::unordered_map<std::size_t, uint32_t>;
+
+    // 调用方持有 write_mutex
+    void _publish_locked();
+
+private:
+    // 已发布的快照, 通过 std::atomic_load/atomic_store 读写
+    std::shared_ptr<const TermIdMap> term_ids;
+    mutable std::mutex write_mutex;
+    TermIdMap pending; // 已分配未发布的 term, 由 write_mutex 保护
+    // pending 的大小; 发布时先 store 快照再清零, 读到 0 后再取的快照一定包含已分配的 term
+    std::atomic<std::size_t> pending_cnt;
+    std::atomic<uint32_t> next_id;
+};
+
+}; // end of namespace tiny_engine
+#endif // __TERM_DICT_H_
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
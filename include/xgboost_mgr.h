@@ -22,11 +22,13 @@
 #include "str_util.h"
 #include "log_util.h"
 #include "config_util.h"
+#include "feature_mgr.h"
 #include "../third_party/xgboost/c_api.h"
 #include <unordered_map>
 #include <vector>
 #include <string>
 #include <memory> // shared_ptr
+#include <mutex>
 
 namespace tiny_engine {
 using std::unordered_map;
@@ -43,20 +45,26 @@ public:
     bool init(std::shared_ptr<ConfigUtil> configs);
     bool load_feature_map(const string &fpath);
     bool load_model(const string &fpath);
+    // 可并发调用, 同一个 booster 的预测串行执行
     bool predict(
-            const vector<unordered_map<string, float>> &features,
+            const vector<const FeatureMgr*> &features,
             vector<float> &out);
+    // 按 feature map 的列顺序直接拷贝每个 doc 的特征数组, 未设置的特征为 missing_value
     bool trans_to_dmatrix(
-            const vector<unordered_map<string, float>> &features,
+            const vector<const FeatureMgr*> &features,
             DMatrixHandle &out) const;
     void trans_to_svm_data(
-            const unordered_map<string, float> &features,
+            const FeatureMgr &features,
             unordered_map<int, float> &out) const;
     std::string to_str() const;
+    // 模型输入的每一列对应的特征, 引擎不计算的为 FEATURE_NUM
+    const vector<FEATURE_ID>& get_column_features() const { return column_features; }
 
 private:
     unordered_map<string, int> feature_map;
+    vector<FEATURE_ID> column_features; // 模型输入的第 i 列对应的特征, 引擎不计算的为 FEATURE_NUM
     BoosterHandle xgb_handler;
+    std::mutex predict_mutex; // XGBoosterPredict 的输出缓存属于 booster, 不能并发预测
 
     float missing_value;
     string model_bin_path;
@@ -0,0 +1,333 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    broker.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 16:52:40
+*   @brief:
+*
+*****************************************************************/
+
+
+#include "../include/broker.h"
+#include <poll.h>
+#include <algorithm>
+
+namespace tiny_engine {
+
+std::string ShardProtocol::encode_request(const std::string &query) {
+    std::string req(query);
+    std::replace(req.begin(), req.end(), '\n', ' ');
+    req.push_back('\n');
+    return req;
+}
+
+std::string ShardProtocol::encode_response(const std::vector<ShardDoc> &docs) {
+    std::string res = std::to_string(docs.size()) + "\n";
+    for (auto &doc : docs) {
+        res += StrUtil::format("{}\t{}\t{}\n", doc.score, doc.title, doc.url);
+    }
+    return res;
+}
+
+bool ShardProtocol::decode_response(const std::string &buf,
+        std::vector<ShardDoc> &docs,
+        bool &is_complete) {
+    is_complete = false;
+    auto end = buf.find('\n');
+    if (end == std::string::npos) {
+        return true;
+    }
+    std::size_t doc_cnt = 0;
+    try {
+        doc_cnt = std::stoul(buf.substr(0, end));
+    } catch (std::exception &e) {
+        LOG_WARNING("invalid response header[%s]", buf.substr(0, end).c_str());
+        return false;
+    }
+    docs.clear();
+    for (std::size_t i = 0; i < doc_cnt; ++i) {
+        auto begin = end + 1;
+        end = buf.find('\n', begin);
+        if (end == std::string::npos) {
+            return true;
+        }
+        // score\ttitle\turl, title 中不含 tab, url 取最后一个 tab 之后的部分
+        auto tab_1st = buf.find('\t', begin);
+        auto tab_2nd = buf.rfind('\t', end);
+        EXPECT_TRUE_OR_RETURN(tab_1st < end && tab_2nd > tab_1st, false);
+        ShardDoc doc;
+        try {
+            doc.score = std::stof(buf.substr(begin, tab_1st - begin));
+        } catch (std::exception &e) {
+            return false;
+        }
+        doc.title = buf.substr(tab_1st + 1, tab_2nd - tab_1st - 1);
+        doc.url = buf.substr(tab_2nd + 1, end - tab_2nd - 1);
+        docs.push_back(std::move(doc));
+    }
+    is_complete = true;
+    return true;
+}
+
+volatile sig_atomic_t ShardServer::is_stopped = 0;
+
+ShardServer::ShardServer(TinyEngine* engine) : engine(engine) {}
+
+void ShardServer::stop() {
+    is_stopped = 1;
+}
+
+bool ShardServer::run(const std::string &socket_path) {
+    EXPECT_NE_OR_RETURN(nullptr, engine, false);
+    int listen_fd = SocketUtil::listen_unix(socket_path);
+    EXPECT_GE_OR_RETURN(listen_fd, 0, false);
+    LOG_INFO("shard server listening on[%s]", socket_path.c_str());
+
+    ConnThreadGroup workers;
+    while (!is_stopped) {
+        workers.reap();
+        // 带超时的 poll, 以便及时响应 stop()
+        struct pollfd pfd = {listen_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        SocketUtil::set_recv_timeout(fd, IDLE_TIMEOUT_MS::value);
+        {
+            std::lock_guard<std::mutex> lock(conn_mutex);
+            conn_fds.insert(fd);
+        }
+        workers.start(std::bind(&ShardServer::_handle_conn, this, fd));
+    }
+
+    SocketUtil::close_fd(listen_fd);
+    unlink(socket_path.c_str());
+    {
+        std::lock_guard<std::mutex> lock(conn_mutex);
+        for (auto fd : conn_fds) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+    workers.join_all();
+    LOG_INFO("shard server on[%s] stopped", socket_path.c_str());
+    return true;
+}
+
+void ShardServer::_handle_conn(int fd) {
+    std::string buf;
+    std::string query;
+    std::vector<TinyEngine::StrStrPair> result;
+    std::vector<float> scores;
+    std::vector<ShardDoc> docs;
+    while (!is_stopped && SocketUtil::read_line(fd, buf, query)) {
+        docs.clear();
+        // search 可重入, 各连接线程直接并发检索
+        if (!engine->search(query, result, &scores)) {
+            result.clear();
+        }
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            docs.emplace_back(scores[i], result[i].first, result[i].second);
+        }
+        if (!SocketUtil::write_all(fd, ShardProtocol::encode_response(docs))) {
+            break;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(conn_mutex);
+        conn_fds.erase(fd);
+    }
+    SocketUtil::close_fd(fd);
+}
+
+Broker::Broker(const std::string &config) :
+    configs(std::make_shared<ConfigUtil>(config)),
+    hedge_delay_ms(HEDGE_DELAY_MS::value),
+    timeout_ms(TIMEOUT_MS::value),
+    max_result_num(MAX_RESULT_NUM::value) {}
+
+bool Broker::init() {
+    EXPECT_TRUE_OR_RETURN_LOGGED(configs->init(), false, "load config file failed");
+
+    int32_t shard_num = 0;
+    EXPECT_TRUE_OR_RETURN_LOGGED(configs->get_value("BROKER_SHARD_NUM", shard_num) && shard_num > 0,
+            false, "key[BROKER_SHARD_NUM] not found or invalid");
+    shard_sockets.assign(shard_num, std::vector<std::string>());
+    for (int32_t i = 0; i < shard_num; ++i) {
+        std::string key = "BROKER_SHARD_" + std::to_string(i);
+        std::string value;
+        if (!configs->get_value(key, value)) {
+            LOG_WARNING("key[%s] not found", key.c_str());
+            return false;
+        }
+        std::vector<std::string> replicas;
+        StrUtil::split(value, ',', replicas);
+        for (auto &replica : replicas) {
+            auto path = StrUtil::trim(replica);
+            if (!path.empty()) {
+                shard_sockets[i].push_back(path);
+            }
+        }
+        if (shard_sockets[i].empty()) {
+            LOG_WARNING("no replica for shard[%d]", i);
+            return false;
+        }
+    }
+
+    if (!configs->get_value("BROKER_HEDGE_DELAY_MS", hedge_delay_ms) || hedge_delay_ms < 0) {
+        hedge_delay_ms = HEDGE_DELAY_MS::value;
+        LOG_WARNING("key[BROKER_HEDGE_DELAY_MS] not found or invalid, set to[%d]", hedge_delay_ms);
+    }
+    if (!configs->get_value("BROKER_TIMEOUT_MS", timeout_ms) || timeout_ms <= 0) {
+        timeout_ms = TIMEOUT_MS::value;
+        LOG_WARNING("key[BROKER_TIMEOUT_MS] not found or invalid, set to[%d]", timeout_ms);
+    }
+    if (!configs->get_value("MAX_RESULT_NUM", max_result_num) || max_result_num <= 0) {
+        max_result_num = MAX_RESULT_NUM::value;
+        LOG_WARNING("key[MAX_RESULT_NUM] not found or invalid, set to[%d]", max_result_num);
+    }
+    return true;
+}
+
+bool Broker::_call_next_replica(const std::string &request,
+        std::size_t shard_idx,
+        std::vector<std::size_t> &next_replica,
+        std::vector<ShardCall> &calls) {
+    auto &replicas = shard_sockets[shard_idx];
+    while (next_replica[shard_idx] < replicas.size()) {
+        auto &path = replicas[next_replica[shard_idx]++];
+        int fd = SocketUtil::connect_unix(path);
+        if (fd < 0) {
+            continue;
+        }
+        if (!SocketUtil::write_all(fd, request)) {
+            LOG_WARNING("send request to[%s] failed", path.c_str());
+            SocketUtil::close_fd(fd);
+            continue;
+        }
+        calls.push_back(ShardCall{fd, shard_idx, std::string(), std::vector<ShardDoc>()});
+        return true;
+    }
+    return false;
+}
+
+bool Broker::search(const std::string &query, std::vector<ShardDoc> &result) {
+    result.clear();
+    auto request = ShardProtocol::encode_request(query);
+    auto shard_num = shard_sockets.size();
+    std::vector<std::size_t> next_replica(shard_num, 0);
+    std::vector<bool> is_done(shard_num, false); // 已返回或所有副本都不可用
+    std::vector<bool> is_answered(shard_num, false);
+    std::vector<std::vector<ShardDoc>> shard_docs(shard_num);
+    std::vector<ShardCall> calls;
+    std::size_t done_cnt = 0;
+
+    for (std::size_t i = 0; i < shard_num; ++i) {
+        if (!_call_next_replica(request, i, next_replica, calls)) {
+            is_done[i] = true; // 所有副本都不可用
+            ++done_cnt;
+        }
+    }
+
+    auto begin = TimeUtil::get_curr_timeval();
+    bool is_hedged = false;
+    std::vector<struct pollfd> pfds;
+    char chunk[4096];
+    while (done_cnt < shard_num && !calls.empty()) {
+        auto now = TimeUtil::get_curr_timeval();
+        int elapsed_ms = TimeUtil::timeval_diff_ms(&now, &begin);
+        if (elapsed_ms >= timeout_ms) {
+            break;
+        }
+        // 超过 hedge 延迟仍未返回的分片, 向下一个副本补发一次请求
+        if (!is_hedged && elapsed_ms >= hedge_delay_ms) {
+            is_hedged = true;
+            for (std::size_t i = 0; i < shard_num; ++i) {
+                if (!is_done[i]) {
+                    _call_next_replica(request, i, next_replica, calls);
+                }
+            }
+        }
+        int wait_ms = timeout_ms - elapsed_ms;
+        if (!is_hedged) {
+            wait_ms = std::min(wait_ms, hedge_delay_ms - elapsed_ms);
+        }
+
+        pfds.clear();
+        for (auto &call : calls) {
+            pfds.push_back({call.fd, POLLIN, 0});
+        }
+        if (poll(pfds.data(), pfds.size(), wait_ms) <= 0) {
+            continue;
+        }
+
+        std::vector<ShardCall> pending_calls;
+        for (std::size_t i = 0; i < calls.size(); ++i) {
+            auto &call = calls[i];
+            bool is_failed = false;
+            bool is_complete = false;
+            // 同一分片已有副本返回时不再读取, 直接丢弃
+            if (pfds[i].revents != 0 && !is_done[call.shard_idx]) {
+                auto n = recv(call.fd, chunk, sizeof(chunk), 0);
+                if (n > 0) {
+                    call.buf.append(chunk, n);
+                    is_failed = !ShardProtocol::decode_response(call.buf, call.docs, is_complete);
+                } else if (n == 0 || (EAGAIN != errno && EINTR != errno)) {
+                    is_failed = true;
+                }
+            }
+            if (is_complete && !is_done[call.shard_idx]) {
+                shard_docs[call.shard_idx].swap(call.docs);
+                is_done[call.shard_idx] = true;
+                is_answered[call.shard_idx] = true;
+                ++done_cnt;
+            }
+            if (is_failed) {
+                LOG_WARNING("shard[%lu] replica failed, query[%s]", call.shard_idx, query.c_str());
+                // 失败时立即尝试下一个副本, 不必等 hedge 延迟
+                if (!is_done[call.shard_idx]) {
+                    _call_next_replica(request, call.shard_idx, next_replica, pending_calls);
+                }
+            }
+            if (is_complete || is_failed || is_done[call.shard_idx]) {
+                SocketUtil::close_fd(call.fd); // 同一分片较慢的副本直接丢弃
+            } else {
+                pending_calls.push_back(std::move(call));
+            }
+        }
+        calls.swap(pending_calls);
+    }
+    for (auto &call : calls) {
+        SocketUtil::close_fd(call.fd);
+    }
+
+    std::size_t answered_cnt = 0;
+    for (std::size_t i = 0; i < shard_num; ++i) {
+        if (!is_answered[i]) {
+            LOG_WARNING("shard[%lu] no response, query[%s]", i, query.c_str());
+            continue;
+        }
+        ++answered_cnt;
+        result.insert(result.end(), shard_docs[i].begin(), shard_docs[i].end());
+    }
+
+    // 归并各分片的 top-k
+    std::stable_sort(result.begin(), result.end(), [](const ShardDoc &a, const ShardDoc &b) {
+        return a.score > b.score;
+    });
+    std::unordered_set<std::string> urls;
+    auto last = std::remove_if(result.begin(), result.end(), [&urls](const ShardDoc &doc) {
+        return !urls.insert(doc.url).second;
+    });
+    result.erase(last, result.end());
+    if (result.size() > static_cast<std::size_t>(max_result_num)) {
+        result.resize(max_result_num);
+    }
+    return answered_cnt > 0;
+}
+
+}; // end of namespace tiny_engine
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
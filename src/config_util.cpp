@@ -99,9 +99,17 @@ bool ConfigUtil::init() {
         auto value = StrUtil::trim(vec[1]);
         config_map[key] = value;
     }
+    for (const auto &item : override_map) {
+        config_map[item.first] = item.second;
+    }
     return true;
 }
 
+void ConfigUtil::set_value(const std::string &key, const std::string &value) {
+    override_map[key] = value;
+    config_map[key] = value;
+}
+
 std::string ConfigUtil::get_config_file() const {
     return config_file;
 }
@@ -14,24 +14,46 @@
 
 namespace tiny_engine {
 
+FeatureMgr::FeatureMgr() {
+    init();
+}
+
 void FeatureMgr::init() {
-    name_value_map.clear();
+    std::fill(value_arr, value_arr + FEATURE_NUM, 0.0f);
+    value_mask.reset();
 }
 
 std::string FeatureMgr::to_str() const {
     jsonxx::json j;
-    for (auto it = name_value_map.begin(); it != name_value_map.end(); ++it) {
-        j[it->first] = it->second;
+    for (int fid = 0; fid < FEATURE_NUM; ++fid) {
+        if (value_mask.test(fid)) {
+            j[get_name(static_cast<FEATURE_ID>(fid))] = value_arr[fid];
+        }
     }
     return j.dump();
 }
 
 bool FeatureMgr::is_empty() const {
-    return name_value_map.empty();
+    return value_mask.none();
 }
 
-std::unordered_map<std::string, float> FeatureMgr::get_features() const {
-    return name_value_map;
+const char* FeatureMgr::get_name(FEATURE_ID fid) {
+    static const char* names[FEATURE_NUM] = {
+#define TINY_ENGINE_FEATURE_NAME(name) #name,
+        TINY_ENGINE_FEATURES(TINY_ENGINE_FEATURE_NAME)
+#undef TINY_ENGINE_FEATURE_NAME
+    };
+    return fid >= 0 && fid < FEATURE_NUM ? names[fid] : "unknown";
+}
+
+bool FeatureMgr::get_id(const std::string &name, FEATURE_ID &fid) {
+    for (int i = 0; i < FEATURE_NUM; ++i) {
+        if (name == get_name(static_cast<FEATURE_ID>(i))) {
+            fid = static_cast<FEATURE_ID>(i);
+            return true;
+        }
+    }
+    return false;
 }
 
 }; // end of namespace tiny_engine
@@ -0,0 +1,120 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    hash_util.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 23:48:10
+*   @brief:
+*
+*****************************************************************/
+
+
+#include "../include/hash_util.h"
+#include <cstring>
+
+namespace tiny_engine {
+
+uint64_t HashUtil::hash64(const char* data, std::size_t len, uint64_t seed) {
+    const char* ptr = data;
+    const char* end = data + len;
+    uint64_t hash = 0;
+    if (len >= STRIPE_LEN::value) {
+        uint64_t v1 = seed + PRIME64_1::value + PRIME64_2::value;
+        uint64_t v2 = seed + PRIME64_2::value;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1::value;
+        const char* limit = end - STRIPE_LEN::value;
+        do {
+            v1 = _round(v1, _read64(ptr));
+            v2 = _round(v2, _read64(ptr + 8));
+            v3 = _round(v3, _read64(ptr + 16));
+            v4 = _round(v4, _read64(ptr + 24));
+            ptr += STRIPE_LEN::value;
+        } while (ptr <= limit);
+        hash = _rotl(v1, 1) + _rotl(v2, 7) + _rotl(v3, 12) + _rotl(v4, 18);
+        hash = _merge_round(hash, v1);
+        hash = _merge_round(hash, v2);
+        hash = _merge_round(hash, v3);
+        hash = _merge_round(hash, v4);
+    } else {
+        hash = seed + PRIME64_5::value;
+    }
+    hash += len;
+    return _finalize(hash, ptr, end - ptr);
+}
+
+uint64_t HashUtil::hash64(const std::string &str, uint64_t seed) {
+    return hash64(str.data(), str.size(), seed);
+}
+
+void HashUtil::hash64(const std::vector<std::string> &strs,
+        std::vector<uint64_t> &hashes,
+        uint64_t seed) {
+    hashes.resize(strs.size());
+    for (std::size_t i = 0; i < strs.size(); ++i) {
+        hashes[i] = hash64(strs[i].data(), strs[i].size(), seed);
+    }
+}
+
+inline uint64_t HashUtil::_read64(const char* ptr) {
+    uint64_t value = 0;
+    memcpy(&value, ptr, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+inline uint32_t HashUtil::_read32(const char* ptr) {
+    uint32_t value = 0;
+    memcpy(&value, ptr, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+inline uint64_t HashUtil::_rotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t HashUtil::_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2::value;
+    acc = _rotl(acc, 31);
+    return acc * PRIME64_1::value;
+}
+
+inline uint64_t HashUtil::_merge_round(uint64_t acc, uint64_t value) {
+    acc ^= _round(0, value);
+    return acc * PRIME64_1::value + PRIME64_4::value;
+}
+
+inline uint64_t HashUtil::_avalanche(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= PRIME64_2::value;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3::value;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t HashUtil::_finalize(uint64_t hash, const char* ptr, std::size_t len) {
+    for (; len >= 8; len -= 8, ptr += 8) {
+        hash ^= _round(0, _read64(ptr));
+        hash = _rotl(hash, 27) * PRIME64_1::value + PRIME64_4::value;
+    }
+    if (len >= 4) {
+        hash ^= static_cast<uint64_t>(_read32(ptr)) * PRIME64_1::value;
+        hash = _rotl(hash, 23) * PRIME64_2::value + PRIME64_3::value;
+        len -= 4;
+        ptr += 4;
+    }
+    for (; len > 0; --len, ++ptr) {
+        hash ^= static_cast<uint64_t>(static_cast<unsigned char>(*ptr)) * PRIME64_5::value;
+        hash = _rotl(hash, 11) * PRIME64_1::value;
+    }
+    return _avalanche(hash);
+}
+
+}; // end of namespace tiny_engine
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,209 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    index_io.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 10:13:02
+*   @brief:
+*
+*****************************************************************/
+
+
+#include "../include/index_io.h"
+#include "../include/file_util.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+namespace tiny_engine {
+
+MmapFile::MmapFile() : fd(-1), addr(nullptr), length(0) {}
+
+MmapFile::~MmapFile() {
+    close();
+}
+
+bool MmapFile::open(const std::string &path) {
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_WARNING("open file[%s] failed, errno=%d", path.c_str(), errno);
+        return false;
+    }
+    struct stat st;
+    if (0 != fstat(fd, &st) || st.st_size <= 0) {
+        LOG_WARNING("stat file[%s] failed or file is empty", path.c_str());
+        close();
+        return false;
+    }
+    length = static_cast<std::size_t>(st.st_size);
+    void* ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == ptr) {
+        LOG_WARNING("mmap file[%s] failed, errno=%d", path.c_str(), errno);
+        length = 0;
+        close();
+        return false;
+    }
+    addr = static_cast<char*>(ptr);
+    // 加载时为顺序读
+    madvise(addr, length, MADV_SEQUENTIAL);
+    return true;
+}
+
+void MmapFile::close() {
+    if (nullptr != addr) {
+        munmap(addr, length);
+        addr = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    length = 0;
+}
+
+const char* MmapFile::data() const {
+    return addr;
+}
+
+std::size_t MmapFile::size() const {
+    return length;
+}
+
+// -----------------------------------------------------------
+
+BinaryWriter::BinaryWriter(const std::string &path) :
+        file_path(path),
+        tmp_path(path + ".tmp"),
+        ofs(tmp_path, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc),
+        body_size(0) {
+    if (ofs.is_open()) {
+        // 先占位, 写完 body 后回填
+        IndexFileHeader header;
+        memset(&header, 0, sizeof(header));
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+}
+
+BinaryWriter::~BinaryWriter() {
+    if (ofs.is_open()) {
+        ofs.close();
+        FileUtil::delete_file(tmp_path);
+    }
+}
+
+bool BinaryWriter::is_open() const {
+    return ofs.is_open();
+}
+
+void BinaryWriter::write_str(const std::string &str) {
+    write_pod(static_cast<uint32_t>(str.size()));
+    ofs.write(str.data(), str.size());
+    body_size += str.size();
+}
+
+bool BinaryWriter::write_header(const IndexFileHeader &header) {
+    EXPECT_TRUE_OR_RETURN(ofs.is_open(), false);
+    auto pos = ofs.tellp();
+    ofs.seekp(0, std::ios::beg);
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.seekp(pos);
+    return ofs.good();
+}
+
+uint64_t BinaryWriter::get_body_size() const {
+    return body_size;
+}
+
+bool BinaryWriter::commit() {
+    EXPECT_TRUE_OR_RETURN(ofs.is_open(), false);
+    ofs.flush();
+    auto good = ofs.good();
+    ofs.close();
+    if (!good) {
+        LOG_WARNING("write file[%s] failed", tmp_path.c_str());
+        FileUtil::delete_file(tmp_path);
+        return false;
+    }
+    EXPECT_TRUE_OR_RETURN_LOGGED(FileUtil::rename(tmp_path, file_path),
+            false, "rename index file failed");
+    return true;
+}
+
+// -----------------------------------------------------------
+
+BinaryReader::BinaryReader(const char* data, std::size_t size) :
+        cursor(data),
+        end(data + size),
+        is_ok(nullptr != data) {}
+
+bool BinaryReader::read_str(std::string &str) {
+    uint32_t len = 0;
+    EXPECT_TRUE_OR_RETURN(read_pod(len), false);
+    EXPECT_TRUE_OR_RETURN(_check(len), false);
+    str.assign(cursor, len);
+    cursor += len;
+    return true;
+}
+
+bool BinaryReader::ok() const {
+    return is_ok;
+}
+
+std::size_t BinaryReader::remain() const {
+    return is_ok ? static_cast<std::size_t>(end - cursor) : 0;
+}
+
+bool BinaryReader::_check(std::size_t bytes) {
+    if (!is_ok || static_cast<std::size_t>(end - cursor) < bytes) {
+        is_ok = false;
+    }
+    return is_ok;
+}
+
+// -----------------------------------------------------------
+
+void IndexIO::init_header(INDEX_FILE_TYPE type, IndexFileHeader &header) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_FILE_MAGIC, std::min(strlen(INDEX_FILE_MAGIC), sizeof(header.magic)));
+    header.version = INDEX_FILE_VERSION;
+    header.file_type = type;
+}
+
+bool IndexIO::check_header(const IndexFileHeader &header,
+        INDEX_FILE_TYPE type,
+        std::size_t file_size) {
+    if (0 != strncmp(header.magic, INDEX_FILE_MAGIC, sizeof(header.magic))) {
+        LOG_WARNING("bad index magic");
+        return false;
+    }
+    if (INDEX_FILE_VERSION != header.version) {
+        LOG_WARNING("index version mismatch, file=%u expect=%u",
+                header.version, INDEX_FILE_VERSION);
+        return false;
+    }
+    if (static_cast<uint32_t>(type) != header.file_type) {
+        LOG_WARNING("index file type mismatch, file=%u expect=%u",
+                header.file_type, static_cast<uint32_t>(type));
+        return false;
+    }
+    if (sizeof(header) + header.body_size != file_size) {
+        LOG_WARNING("index file truncated, body=%lu file=%lu",
+                header.body_size, file_size);
+        return false;
+    }
+    return true;
+}
+
+bool IndexIO::get_src_stat(const std::string &path, uint64_t &size, uint64_t &mtime) {
+    struct stat st;
+    EXPECT_EQ_OR_RETURN(0, stat(path.c_str(), &st), false);
+    size = static_cast<uint64_t>(st.st_size);
+    mtime = static_cast<uint64_t>(st.st_mtime);
+    return true;
+}
+
+}; // end of namespace tiny_engine
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -10,29 +10,59 @@
 
 #include "../include/common.h"
 #include "../include/table.h"
+#include "../include/broker.h"
+#include "../include/query_server.h"
+#include "../include/search_pipeline.h"
 
 #include <iostream>
+#include <fstream>
+#include <algorithm>
 #include <unistd.h>
 #include <getopt.h>
+#include <csignal>
 
 using namespace tiny_engine;
 
 struct globalOptions {
-    int mode;
+    int mode; // 0: ֻ, 1: , 2: Ϊ̼߳( query_server.h)
+    bool build_only; // ֻⲢ dump , 
+    bool use_pipeline; //  SearchPipeline ֽ׶βм stdin е query, ˳򲻱
     std::string conf_path;
     std::string index_path;
+    std::string partition_id; // ̲ʱ̸Ƭ
+    std::string socket_path;  // ǿʱΪƬڸ unix socket ṩ; -d 2 ʱΪַ
+    std::string broker_conf;  // ǿʱΪ broker,  query תƬ
+    std::string replay_path;  // ǿʱ search_batch طŸļе query, ¼ʱֲ
 } g_options;
 
 void parse_args(int argc, char **argv) {
     char ch;
-    while ((ch = getopt(argc, argv, "x:c:d:")) != EOF) { // עַĩβ":"
+    while ((ch = getopt(argc, argv, "x:c:d:p:l:r:f:bP")) != EOF) { // עַĩβ":"
         switch (ch) {
+            case 'b':
+                g_options.build_only = true;
+                break;
+            case 'P':
+                g_options.use_pipeline = true;
+                break;
             case 'x':
                 g_options.index_path = optarg;
                 break;
             case 'c':
                 g_options.conf_path = optarg;
                 break;
+            case 'p':
+                g_options.partition_id = optarg;
+                break;
+            case 'l':
+                g_options.socket_path = optarg;
+                break;
+            case 'r':
+                g_options.broker_conf = optarg;
+                break;
+            case 'f':
+                g_options.replay_path = optarg;
+                break;
             case 'd':
                 try {
                     g_options.mode = std::stoi(std::string(optarg));
@@ -46,10 +76,156 @@ void parse_args(int argc, char **argv) {
     }
 }
 
+void handle_stop_signal(int) {
+    ShardServer::stop();
+    QueryServer::stop();
+}
+
+int run_broker() {
+    Broker broker(g_options.broker_conf);
+    EXPECT_TRUE_OR_RETURN(broker.init(), -1);
+
+    std::string query;
+    std::vector<ShardDoc> result;
+    for (; std::getline(std::cin, query); ) {
+        if (query == "exit") {
+            break;
+        }
+        if (!broker.search(query, result) || g_options.mode == 0) {
+            continue;
+        }
+        for (auto it = result.begin(); it != result.end(); ++it) {
+            std::cout << query << '\t' << it->title << '\t' << it->url << '\n';
+        }
+    }
+    return 0;
+}
+
+int run_pipeline(const TinyEngine* engine) {
+    std::unique_ptr<SearchPipeline> pipeline = nullptr;
+    if (g_options.conf_path.empty()) {
+        pipeline.reset(new SearchPipeline(engine));
+    } else {
+        pipeline.reset(new SearchPipeline(engine, g_options.conf_path));
+    }
+    EXPECT_TRUE_OR_RETURN(pipeline->init(), -1);
+    EXPECT_TRUE_OR_RETURN(pipeline->start(), -1);
+
+    auto print_result = [](const SearchTask &task) {
+        if (g_options.mode == 0) {
+            return;
+        }
+        for (auto it = task.result.begin(); it != task.result.end(); ++it) {
+            std::cout << task.ctx.query << '\t' << it->first << '\t' << it->second << '\n';
+        }
+    };
+    std::string query;
+    for (; std::getline(std::cin, query); ) {
+        if (query == "exit") {
+            break;
+        }
+        if (query.empty()) {
+            continue;
+        }
+        pipeline->submit(query, print_result);
+    }
+    pipeline->stop();
+    return 0;
+}
+
+/**
+ * @brief طļ, ÿеһΪ query, ݱע(query \t title \t url \t label),
+ *         query ͬʱֻһ
+ */
+bool load_replay_queries(const std::string &path, std::vector<std::string> &queries) {
+    std::ifstream ifs(path.c_str(), std::ifstream::in);
+    if (!ifs.is_open()) {
+        LOG_WARNING("open replay file[%s] failed", path.c_str());
+        return false;
+    }
+    queries.clear();
+    std::string line;
+    while (std::getline(ifs, line)) {
+        auto query = line.substr(0, line.find('\t'));
+        if (query.empty() || query == "exit" || (!queries.empty() && queries.back() == query)) {
+            continue;
+        }
+        queries.push_back(std::move(query));
+    }
+    return true;
+}
+
+void report_latency(const std::string &name, std::vector<uint64_t> &costs_us) {
+    std::sort(costs_us.begin(), costs_us.end());
+    LOG_INFO("%s latency(us): avg[%.0f] p50[%lu] p90[%lu] p99[%lu] p999[%lu] max[%lu]",
+            name.c_str(), MathUtil::mean(costs_us),
+            MathUtil::percentile(costs_us, 0.5), MathUtil::percentile(costs_us, 0.9),
+            MathUtil::percentile(costs_us, 0.99), MathUtil::percentile(costs_us, 0.999),
+            costs_us.empty() ? 0 : costs_us.back());
+}
+
+int run_replay(const TinyEngine* engine) {
+    std::vector<std::string> queries;
+    EXPECT_TRUE_OR_RETURN(load_replay_queries(g_options.replay_path, queries), -1);
+
+    std::vector<std::vector<std::pair<std::string, std::string>>> results;
+    std::vector<SearchStat> stats;
+    auto time_begin = TimeUtil::get_curr_timeval();
+    EXPECT_TRUE_OR_RETURN(engine->search_batch(queries, results, &stats), -1);
+    auto time_end = TimeUtil::get_curr_timeval();
+    auto elapsed_us = TimeUtil::timeval_diff_us(&time_begin, &time_end);
+
+    if (g_options.mode != 0) {
+        for (std::size_t i = 0; i < queries.size(); ++i) {
+            for (auto it = results[i].begin(); it != results[i].end(); ++it) {
+                std::cout << queries[i] << '\t' << it->first << '\t' << it->second << '\n';
+            }
+        }
+    }
+
+    // дʧܵ query ֻ QPS, н query ׶κʱ
+    std::size_t failed_cnt = 0;
+    std::size_t degraded_cnt = 0;
+    std::size_t cache_hit_cnt = 0;
+    std::vector<uint64_t> stage_costs[5];
+    for (const auto &stat : stats) {
+        if (!stat.is_ok) {
+            ++failed_cnt;
+            continue;
+        }
+        if (DEGRADE_NONE != stat.degrade_flags) {
+            ++degraded_cnt;
+        }
+        stage_costs[0].push_back(stat.total_us);
+        if (stat.is_cache_hit) {
+            ++cache_hit_cnt;
+            continue;
+        }
+        stage_costs[1].push_back(stat.segment_us);
+        stage_costs[2].push_back(stat.recall_us);
+        stage_costs[3].push_back(stat.rank_us);
+        stage_costs[4].push_back(stat.output_us);
+    }
+    LOG_INFO("replay[%s] query_cnt[%lu] failed[%lu] degraded[%lu] cache_hit[%lu] "
+            "elapsed[%lu ms] qps[%.1f]",
+            g_options.replay_path.c_str(), queries.size(), failed_cnt, degraded_cnt,
+            cache_hit_cnt,
+            elapsed_us / 1000, elapsed_us > 0 ? queries.size() * 1000000.0 / elapsed_us : 0.0);
+    const std::string names[] = {"total", "segment", "recall", "rank", "output"};
+    for (int i = 0; i < 5; ++i) {
+        report_latency(names[i], stage_costs[i]);
+    }
+    return 0;
+}
+
 int main(int argc, char **argv) {
     // parse args
     parse_args(argc, argv);
 
+    if (!g_options.broker_conf.empty()) {
+        return run_broker();
+    }
+
 #ifdef DEBUG
     auto time_1st = TimeUtil::get_curr_timeval();
 #endif
@@ -63,12 +239,56 @@ int main(int argc, char **argv) {
     } else {
         engine.reset(new TinyEngine(g_options.conf_path));
     }
+    if (!g_options.partition_id.empty()) {
+        engine->set_config("INDEX_PARTITION_ID", g_options.partition_id);
+    }
     EXPECT_TRUE_OR_RETURN(engine->init(), -1);
 
 #ifdef DEBUG
     auto time_2nd = TimeUtil::get_curr_timeval();
 #endif
 
+    if (g_options.build_only) {
+        EXPECT_TRUE_OR_RETURN(engine->stop(), -1);
+        return 0;
+    }
+
+    if (g_options.mode == 2) {
+        signal(SIGINT, handle_stop_signal);
+        signal(SIGTERM, handle_stop_signal);
+        std::unique_ptr<QueryServer> server = nullptr;
+        if (g_options.conf_path.empty()) {
+            server.reset(new QueryServer(engine.get()));
+        } else {
+            server.reset(new QueryServer(engine.get(), g_options.conf_path));
+        }
+        EXPECT_TRUE_OR_RETURN(server->init(), -1);
+        EXPECT_TRUE_OR_RETURN(server->run(g_options.socket_path), -1);
+        EXPECT_TRUE_OR_RETURN(engine->stop(), -1);
+        return 0;
+    }
+
+    if (!g_options.socket_path.empty()) {
+        signal(SIGINT, handle_stop_signal);
+        signal(SIGTERM, handle_stop_signal);
+        ShardServer server(engine.get());
+        EXPECT_TRUE_OR_RETURN(server.run(g_options.socket_path), -1);
+        EXPECT_TRUE_OR_RETURN(engine->stop(), -1);
+        return 0;
+    }
+
+    if (!g_options.replay_path.empty()) {
+        EXPECT_EQ_OR_RETURN(0, run_replay(engine.get()), -1);
+        EXPECT_TRUE_OR_RETURN(engine->stop(), -1);
+        return 0;
+    }
+
+    if (g_options.use_pipeline) {
+        EXPECT_EQ_OR_RETURN(0, run_pipeline(engine.get()), -1);
+        EXPECT_TRUE_OR_RETURN(engine->stop(), -1);
+        return 0;
+    }
+
     auto num = 0;
     std::string query;
     std::vector<std::pair<std::string, std::string>> result; // [<title, url> ...]
@@ -76,6 +296,19 @@ int main(int argc, char **argv) {
         if (query == "exit") {
             break;
         }
+#ifdef DEBUG
+        // ׶μ(), ÿ
+        SearchContext ctx(query);
+        if (!engine->prepare_query(ctx)) {
+            continue;
+        }
+        engine->recall(ctx);
+        engine->rank(ctx);
+        ++num;
+        if (g_options.mode != 0) {
+            engine->dump_result(ctx, std::cout);
+        }
+#else
     	if (!engine->search(query, result)) {
     		continue;
     	}
@@ -87,14 +320,17 @@ int main(int argc, char **argv) {
     	for (auto it = result.begin(); it != result.end(); ++it) {
     		std::cout << query << '\t' << it->first << '\t' << it->second << '\n';
     	}
+#endif
     }
 
 #ifdef DEBUG
     auto time_3rd = TimeUtil::get_curr_timeval();
     auto init_time = TimeUtil::timeval_diff_ms(&time_2nd, &time_1st);
-    auto search_time = TimeUtil::timeval_diff_ms(&time_3rd, &time_2nd);
-    LOG_INFO("init_time=[%lu ms] query_cnt[%d] total_search_time[%lu ms] avg_tm[%lu ms] qps[%lu]",
-            init_time, num, search_time, search_time / num, num / (search_time / 1000));
+    auto search_time_us = TimeUtil::timeval_diff_us(&time_3rd, &time_2nd);
+    LOG_INFO("init_time=[%lu ms] query_cnt[%d] total_search_time[%lu ms] avg_tm[%.2f ms] qps[%.1f]",
+            init_time, num, search_time_us / 1000,
+            num > 0 ? search_time_us / 1000.0 / num : 0.0,
+            search_time_us > 0 ? num * 1000000.0 / search_time_us : 0.0);
 #endif
 
     // stop
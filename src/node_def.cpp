@@ -10,62 +10,37 @@
 
 
 #include "../include/node_def.h"
+#include "../include/term_dict.h"
 
 namespace tiny_engine {
 
 TermNode::TermNode(
         std::size_t sign,
-        const std::string &txt,
         uint16_t off,
         uint16_t len,
+        bool space,
         uint16_t dup,
         float wei) :
     token_sign(sign),
-    token(txt),
+    term_id(TermDict::INVALID_ID::value),
+    wei(wei),
     offset(off),
     length(len),
     dup(dup),
-    wei(wei) {}
-
-TermNode::TermNode(const TermNode &other) {
-    if (this != &other) {
-        token_sign = other.token_sign;
-        token = other.token;
-        offset = other.offset;
-        length = other.length;
-        dup = other.dup;
-        wei = other.wei;
-    }
-}
-
-TermNode& TermNode::operator=(const TermNode &other) {
-    if (this != &other) {
-        token_sign = other.token_sign;
-        token = other.token;
-        offset = other.offset;
-        length = other.length;
-        dup = other.dup;
-        wei = other.wei;
-    }
-    return *this;
-}
+    is_space(space) {}
 
 bool TermNode::operator==(const TermNode &other) const {
     return token_sign == other.token_sign;
 }
 
 bool TermNode::operator<(const TermNode &other) const {
-    return token < other.token;
+    return offset < other.offset;
 }
 
 std::string TermNode::to_str() const {
-#ifdef DEBUG
     return StrUtil::format(
-        "{},off={},len={},dup={},wei={},sign={}",
-        token.c_str(), offset, length, dup, wei, token_sign);
-#else
-    return token;
-#endif
+        "off={},len={},dup={},wei={},sign={},id={}",
+        offset, length, dup, wei, token_sign, term_id);
 }
 
 // ----------------------------------------------------------------
@@ -92,6 +67,7 @@ DocInfo::DocInfo(
         const std::vector<TermNode> &tms,
         float module_) :
     doc_sign(sign),
+    doc_id(0),
     title(t),
     url(u),
     terms(tms),
@@ -101,34 +77,30 @@ DocInfo::DocInfo(
         auto p_last_term = std::prev(terms.end());
         title_len = p_last_term->offset + p_last_term->length;
     }
-}
-
-// -----------------------------------------------------------
-
-DocNode::DocNode(std::size_t sign) : doc_sign(sign) {}
-
-bool DocNode::operator==(const DocNode &other) const {
-    return doc_sign == other.doc_sign;
-}
-
-std::size_t DocNode::operator()() const {
-    return doc_sign;
+    StrUtil::utf8_to_unicode(title, title_chars);
 }
 
 // -----------------------------------------------------------
 
 InvTermInfo::InvTermInfo(
         std::size_t sign,
+        uint32_t id,
         const std::string &t,
         uint16_t len,
         uint16_t tf,
         float idf) :
     term_sign(sign),
+    term_id(id),
     term_txt(t),
     term_len(len),
     term_freq(tf),
+    max_tf(0),
     idf(idf) {}
 
+PostingCursor InvTermInfo::cursor(uint32_t begin_doc, uint32_t end_doc) const {
+    return PostingCursor(docs, begin_doc, end_doc);
+}
+
 // -----------------------------------------------------------
 
 MatchTermInfo::MatchTermInfo():
@@ -152,8 +124,11 @@ QueryInfo::QueryInfo(const std::string &q) : query(q) {}
 
 void QueryInfo::init() {
     query.clear();
+    query_chars.clear();
     terms.clear();
+    term_map.clear();
     syns.clear();
+    phrases.clear();
     vec_module = 0.0;
     wei_sum = 0.0;
 }
@@ -166,6 +141,26 @@ std::string QueryInfo::to_str() const {
     return StrUtil::join(vec.begin(), vec.end(), '\t');
 }
 
+std::size_t QueryInfo::mem_size() const {
+    auto size = sizeof(QueryInfo) + query.size() + query_chars.size() * sizeof(uint32_t)
+        + terms.size() * sizeof(TermNode);
+    for (const auto &term_syns : syns) {
+        size += sizeof(term_syns);
+        for (const auto &syn : term_syns) {
+            size += sizeof(SynTermNode) + syn.token.size();
+        }
+    }
+    for (const auto &phrase : phrases) {
+        size += sizeof(PhraseNode) + phrase.text.size()
+            + phrase.term_signs.size() * sizeof(std::size_t)
+            + phrase.term_pos.size() * sizeof(uint16_t);
+    }
+    for (const auto &item : term_map) {
+        size += sizeof(item) + item.second.offsets.size() * sizeof(uint16_t);
+    }
+    return size;
+}
+
 // -----------------------------------------------------------
 
 ResInfo::ResInfo(
@@ -173,6 +168,8 @@ ResInfo::ResInfo(
         std::shared_ptr<DocInfo> doc) :
     doc_sign(sign),
     doc_info(doc),
+    recall_by_syn(false),
+    recall_score(0.0),
     term_hits(0),
     vsm(0.0),
     cqr(0.0),
@@ -0,0 +1,215 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    pair_cache.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 22:31:52
+*   @brief:
+*
+*****************************************************************/
+
+
+#include "../include/pair_cache.h"
+#include <fstream>
+#include <algorithm>
+
+namespace tiny_engine {
+
+PairCache::PairCache() :
+    hot_pair_num(HOT_PAIR_NUM::value),
+    min_pair_count(MIN_PAIR_COUNT::value),
+    mine_interval_s(MINE_INTERVAL_S::value),
+    tracked_cnt(0),
+    hot_pairs(std::make_shared<PairSet>()),
+    seed_cnt(0),
+    seed_doc_cnt(0),
+    is_stopped(false) {}
+
+PairCache::~PairCache() {
+    stop();
+}
+
+bool PairCache::init(std::shared_ptr<ConfigUtil> configs, Tokenizer tokenizer) {
+    EXPECT_NE_OR_RETURN(nullptr, configs, false);
+    int cache_size_mb = 0;
+    if (!configs->get_value("PAIR_CACHE_SIZE_MB", cache_size_mb) || cache_size_mb < 0) {
+        cache_size_mb = PAIR_CACHE_SIZE_MB::value;
+        LOG_WARNING("key[PAIR_CACHE_SIZE_MB] not found or invalid, set to[%d]", cache_size_mb);
+    }
+    if (0 == cache_size_mb) {
+        return true;
+    }
+    if (!configs->get_value("PAIR_HOT_NUM", hot_pair_num) || hot_pair_num < 1) {
+        hot_pair_num = HOT_PAIR_NUM::value;
+        LOG_WARNING("key[PAIR_HOT_NUM] not found or invalid, set to[%d]", hot_pair_num);
+    }
+    if (!configs->get_value("PAIR_MIN_COUNT", min_pair_count) || min_pair_count < 1) {
+        min_pair_count = MIN_PAIR_COUNT::value;
+        LOG_WARNING("key[PAIR_MIN_COUNT] not found or invalid, set to[%d]", min_pair_count);
+    }
+    if (!configs->get_value("PAIR_MINE_INTERVAL_S", mine_interval_s) || mine_interval_s < 1) {
+        mine_interval_s = MINE_INTERVAL_S::value;
+        LOG_WARNING("key[PAIR_MINE_INTERVAL_S] not found or invalid, set to[%d]",
+                mine_interval_s);
+    }
+    configs->get_value("PAIR_QUERY_LOG", query_log);
+    this->tokenizer = tokenizer;
+    cache.reset(new DocListCache(static_cast<std::size_t>(cache_size_mb) << 20));
+    if (!mine_thread.joinable()) {
+        mine_thread = std::thread(&PairCache::_mine_loop, this);
+    }
+    return true;
+}
+
+void PairCache::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mine_mutex);
+        is_stopped = true;
+    }
+    mine_cond.notify_all();
+    if (mine_thread.joinable()) {
+        mine_thread.join();
+    }
+}
+
+PairCache::TermPair PairCache::make_pair(std::size_t first, std::size_t second) {
+    return first < second ? TermPair(first, second) : TermPair(second, first);
+}
+
+void PairCache::record(const std::vector<std::size_t> &term_signs) {
+    auto signs = term_signs;
+    std::sort(signs.begin(), signs.end());
+    signs.erase(std::unique(signs.begin(), signs.end()), signs.end());
+    for (std::size_t i = 0; i < signs.size(); ++i) {
+        for (std::size_t j = i + 1; j < signs.size(); ++j) {
+            TermPair pair(signs[i], signs[j]);
+            auto &shard = counter_shards[PairHash()(pair) % COUNTER_SHARD_NUM::value];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto iter = shard.counts.find(pair);
+            if (iter != shard.counts.end()) {
+                ++iter->second;
+            } else if (tracked_cnt < static_cast<std::size_t>(MAX_TRACKED_PAIRS::value)) {
+                shard.counts[pair] = 1;
+                ++tracked_cnt;
+            }
+        }
+    }
+}
+
+bool PairCache::is_hot(const TermPair &pair) const {
+    return std::atomic_load(&hot_pairs)->count(pair) > 0;
+}
+
+bool PairCache::is_admissible(std::size_t doc_cnt) const {
+    return is_enabled() && doc_cnt * sizeof(uint32_t) + sizeof(DocList) <= cache->max_charge();
+}
+
+bool PairCache::get(const TermPair &pair,
+        uint64_t generation,
+        std::shared_ptr<const DocList> &docs) {
+    EXPECT_TRUE_OR_RETURN(is_enabled(), false);
+    return cache->get(_to_key(pair), generation, docs);
+}
+
+void PairCache::put(const TermPair &pair,
+        uint64_t generation,
+        std::shared_ptr<const DocList> docs) {
+    if (!is_enabled() || nullptr == docs || !is_hot(pair)) {
+        return;
+    }
+    cache->put(_to_key(pair), generation, docs, sizeof(DocList) + docs->size() * sizeof(uint32_t));
+}
+
+void PairCache::add_seed_stats(std::size_t seed_doc_cnt) {
+    ++seed_cnt;
+    this->seed_doc_cnt += seed_doc_cnt;
+}
+
+void PairCache::mine() {
+    std::vector<std::pair<uint32_t, TermPair>> candidates;
+    std::size_t tracked = 0;
+    for (auto &shard : counter_shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto iter = shard.counts.begin(); iter != shard.counts.end(); ) {
+            if (iter->second >= static_cast<uint32_t>(min_pair_count)) {
+                candidates.push_back(std::make_pair(iter->second, iter->first));
+            }
+            // 计数减半, 不再出现的 term 对逐渐被移除
+            iter->second /= 2;
+            if (0 == iter->second) {
+                iter = shard.counts.erase(iter);
+                --tracked_cnt;
+            } else {
+                ++iter;
+            }
+        }
+        tracked += shard.counts.size();
+    }
+    auto hot_num = std::min<std::size_t>(hot_pair_num, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + hot_num, candidates.end(),
+            [](const std::pair<uint32_t, TermPair> &lhs,
+               const std::pair<uint32_t, TermPair> &rhs) {
+                return lhs.first > rhs.first;
+            });
+    auto hot = std::make_shared<PairSet>();
+    for (std::size_t i = 0; i < hot_num; ++i) {
+        hot->insert(candidates[i].second);
+    }
+    std::atomic_store(&hot_pairs, std::shared_ptr<const PairSet>(hot));
+    LOG_INFO("mined %lu hot term pairs, %lu pairs still tracked", hot->size(), tracked);
+}
+
+std::string PairCache::stats() const {
+    EXPECT_TRUE_OR_RETURN(is_enabled(), std::string());
+    return StrUtil::format("hot_pairs[{}] tracked_pairs[{}] seeded[{} queries, {} docs] {}",
+            std::atomic_load(&hot_pairs)->size(), std::size_t(tracked_cnt),
+            uint64_t(seed_cnt), uint64_t(seed_doc_cnt), cache->stats());
+}
+
+std::string PairCache::_to_key(const TermPair &pair) {
+    std::string key(reinterpret_cast<const char*>(&pair.first), sizeof(pair.first));
+    key.append(reinterpret_cast<const char*>(&pair.second), sizeof(pair.second));
+    return key;
+}
+
+void PairCache::_load_query_log(const std::string &file) {
+    std::ifstream ifs(file.c_str(), std::ifstream::in);
+    if (!ifs.is_open()) {
+        LOG_WARNING("open query log[%s] failed", file.c_str());
+        return;
+    }
+    std::string line;
+    std::vector<std::size_t> term_signs;
+    std::size_t query_cnt = 0;
+    while (std::getline(ifs, line)) {
+        auto query = line.substr(0, line.find('\t'));
+        if (query.empty()) {
+            continue;
+        }
+        term_signs.clear();
+        tokenizer(query, term_signs);
+        record(term_signs);
+        ++query_cnt;
+    }
+    LOG_INFO("load %lu queries from query log[%s]", query_cnt, file.c_str());
+}
+
+void PairCache::_mine_loop() {
+    if (!query_log.empty() && nullptr != tokenizer) {
+        _load_query_log(query_log);
+        mine();
+    }
+    std::unique_lock<std::mutex> lock(mine_mutex);
+    while (!is_stopped) {
+        mine_cond.wait_for(lock, std::chrono::seconds(mine_interval_s));
+        if (is_stopped) {
+            break;
+        }
+        lock.unlock();
+        mine();
+        lock.lock();
+    }
+}
+
+}; // end of namespace tiny_engine
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,461 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    posting_list.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 14:05:40
+*   @brief:
+*
+*****************************************************************/
+
+
+#include "../include/posting_list.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace tiny_engine {
+
+PostingList::Iterator::Iterator(const PostingList* list, uint32_t pos) :
+        list(list),
+        pos(pos),
+        buf_begin(0),
+        buf_size(0) {
+    if (pos < list->doc_cnt) {
+        _fill();
+    }
+}
+
+bool PostingList::Iterator::operator==(const Iterator &other) const {
+    return list == other.list && pos == other.pos;
+}
+
+bool PostingList::Iterator::operator!=(const Iterator &other) const {
+    return !(*this == other);
+}
+
+PostingList::Iterator& PostingList::Iterator::advance_to(uint32_t doc_id) {
+    if (is_end() || buf[pos - buf_begin] >= doc_id) {
+        return *this;
+    }
+    if (buf[buf_size - 1] < doc_id) { // 不在当前 block, 查跳表
+        const auto &skips = list->skips;
+        auto next_block = std::min<std::size_t>(buf_begin / BLOCK_SIZE::value + 1, skips.size());
+        auto iter = std::lower_bound(skips.begin() + next_block, skips.end(), doc_id,
+                [](const SkipEntry &entry, uint32_t value) {
+                    return entry.max_doc_id < value;
+                });
+        pos = static_cast<uint32_t>(iter - skips.begin()) * BLOCK_SIZE::value;
+        if (is_end()) {
+            return *this;
+        }
+        _fill();
+        if (buf[buf_size - 1] < doc_id) { // 尾部也没有
+            pos = list->doc_cnt;
+            return *this;
+        }
+    }
+    auto begin = buf + (pos - buf_begin);
+    pos = buf_begin + static_cast<uint32_t>(std::lower_bound(begin, buf + buf_size, doc_id) - buf);
+    return *this;
+}
+
+void PostingList::Iterator::_fill() {
+    auto block_idx = pos / BLOCK_SIZE::value;
+    buf_begin = block_idx * BLOCK_SIZE::value;
+    buf_size = list->decode_block(block_idx, buf);
+}
+
+// -----------------------------------------------------------
+
+PostingCursor::PostingCursor(const PostingList &list, uint32_t begin_doc, uint32_t end_doc) :
+        iter(list.begin()),
+        end_doc(end_doc),
+        curr_doc(END_DOC::value),
+        list_size(list.size()) {
+    iter.advance_to(begin_doc);
+    _update_doc_id();
+}
+
+uint32_t PostingCursor::advance_to(uint32_t target) {
+    if (!is_end() && curr_doc < target) {
+        iter.advance_to(target);
+        _update_doc_id();
+    }
+    return curr_doc;
+}
+
+// -----------------------------------------------------------
+
+PostingList::PostingList() : doc_cnt(0) {}
+
+bool PostingList::add(uint32_t doc_id) {
+    if (empty() || doc_id > back()) {
+        tail.push_back(doc_id);
+        ++doc_cnt;
+        if (tail.size() >= BLOCK_SIZE::value) {
+            _flush_tail();
+        }
+        return true;
+    }
+    // 落在尾部区间内, 直接在未压缩部分插入
+    if (skips.empty() || doc_id > skips.back().max_doc_id) {
+        auto pos = std::lower_bound(tail.begin(), tail.end(), doc_id);
+        if (pos != tail.end() && *pos == doc_id) {
+            return false;
+        }
+        tail.insert(pos, doc_id);
+        ++doc_cnt;
+        if (tail.size() >= BLOCK_SIZE::value) {
+            _flush_tail();
+        }
+        return true;
+    }
+    // 落在已压缩的 block 中, 少见(同一 url 重复建库), 整体解码后重新编码
+    EXPECT_FALSE_OR_RETURN(contains(doc_id), false);
+    std::vector<uint32_t> doc_ids;
+    decode(doc_ids);
+    doc_ids.insert(std::lower_bound(doc_ids.begin(), doc_ids.end(), doc_id), doc_id);
+    encode(doc_ids);
+    return true;
+}
+
+bool PostingList::remove(uint32_t doc_id) {
+    EXPECT_FALSE_OR_RETURN(empty(), false);
+    if (skips.empty() || doc_id > skips.back().max_doc_id) {
+        auto pos = std::lower_bound(tail.begin(), tail.end(), doc_id);
+        EXPECT_TRUE_OR_RETURN(pos != tail.end() && *pos == doc_id, false);
+        tail.erase(pos);
+        --doc_cnt;
+        return true;
+    }
+    EXPECT_TRUE_OR_RETURN(contains(doc_id), false);
+    std::vector<uint32_t> doc_ids;
+    decode(doc_ids);
+    doc_ids.erase(std::lower_bound(doc_ids.begin(), doc_ids.end(), doc_id));
+    encode(doc_ids);
+    return true;
+}
+
+bool PostingList::contains(uint32_t doc_id) const {
+    EXPECT_FALSE_OR_RETURN(empty(), false);
+    auto iter = std::lower_bound(skips.begin(), skips.end(), doc_id,
+            [](const SkipEntry &entry, uint32_t value) {
+                return entry.max_doc_id < value;
+            });
+    if (iter == skips.end()) {
+        return std::binary_search(tail.begin(), tail.end(), doc_id);
+    }
+    uint32_t buf[BLOCK_SIZE::value];
+    auto cnt = decode_block(iter - skips.begin(), buf);
+    return std::binary_search(buf, buf + cnt, doc_id);
+}
+
+std::size_t PostingList::rank(uint32_t doc_id) const {
+    auto iter = std::lower_bound(skips.begin(), skips.end(), doc_id,
+            [](const SkipEntry &entry, uint32_t value) {
+                return entry.max_doc_id < value;
+            });
+    std::size_t block_idx = iter - skips.begin();
+    if (iter == skips.end()) {
+        return block_idx * BLOCK_SIZE::value \
+            + (std::lower_bound(tail.begin(), tail.end(), doc_id) - tail.begin());
+    }
+    uint32_t buf[BLOCK_SIZE::value];
+    auto cnt = decode_block(block_idx, buf);
+    return block_idx * BLOCK_SIZE::value + (std::lower_bound(buf, buf + cnt, doc_id) - buf);
+}
+
+void PostingList::append(const PostingList &other) {
+    for (auto doc_id : other) {
+        add(doc_id);
+    }
+}
+
+std::size_t PostingList::size() const {
+    return doc_cnt;
+}
+
+bool PostingList::empty() const {
+    return 0 == doc_cnt;
+}
+
+uint32_t PostingList::back() const {
+    return tail.empty() ? skips.back().max_doc_id : tail.back();
+}
+
+PostingList::Iterator PostingList::begin() const {
+    return Iterator(this, 0);
+}
+
+PostingList::Iterator PostingList::end() const {
+    return Iterator(this, doc_cnt);
+}
+
+std::size_t PostingList::block_cnt() const {
+    return skips.size();
+}
+
+const PostingList::SkipEntry& PostingList::get_skip(std::size_t block_idx) const {
+    return skips[block_idx];
+}
+
+uint32_t PostingList::decode_block(std::size_t block_idx, uint32_t* out) const {
+    if (block_idx >= skips.size()) {
+        std::copy(tail.begin(), tail.end(), out);
+        return static_cast<uint32_t>(tail.size());
+    }
+    const auto &skip = skips[block_idx];
+    auto base = block_idx > 0 ? skips[block_idx - 1].max_doc_id : 0;
+    unpack_block(packed.data() + skip.offset, skip.bits, base, out);
+    return BLOCK_SIZE::value;
+}
+
+void PostingList::decode(std::vector<uint32_t> &out) const {
+    out.resize(doc_cnt);
+    for (std::size_t i = 0; i < skips.size(); ++i) {
+        decode_block(i, out.data() + i * BLOCK_SIZE::value);
+    }
+    std::copy(tail.begin(), tail.end(), out.begin() + skips.size() * BLOCK_SIZE::value);
+}
+
+void PostingList::encode(const std::vector<uint32_t> &doc_ids) {
+    doc_cnt = 0;
+    skips.clear();
+    packed.clear();
+    tail.clear();
+    for (auto doc_id : doc_ids) {
+        tail.push_back(doc_id);
+        ++doc_cnt;
+        if (tail.size() >= BLOCK_SIZE::value) {
+            _flush_tail();
+        }
+    }
+}
+
+std::size_t PostingList::memory_usage() const {
+    return sizeof(*this) \
+        + skips.capacity() * sizeof(SkipEntry) \
+        + packed.capacity() * sizeof(uint32_t) \
+        + tail.capacity() * sizeof(uint32_t);
+}
+
+/*
+ * u32 doc_cnt | u32 skip_cnt | skip_cnt * (u32 max_doc_id | u32 offset | u32 bits) |
+ * u32 packed_cnt | packed_cnt * u32 | u32 tail_cnt | tail_cnt * u32
+ */
+void PostingList::dump(BinaryWriter &writer) const {
+    writer.write_pod(doc_cnt);
+    writer.write_vec(skips);
+    writer.write_vec(packed);
+    writer.write_vec(tail);
+}
+
+bool PostingList::load(BinaryReader &reader) {
+    reader.read_pod(doc_cnt);
+    reader.read_vec(skips);
+    reader.read_vec(packed);
+    reader.read_vec(tail);
+    EXPECT_TRUE_OR_RETURN(reader.ok(), false);
+    // 校验跳表, 防止损坏的文件导致越界访问
+    EXPECT_EQ_OR_RETURN(doc_cnt, skips.size() * BLOCK_SIZE::value + tail.size(), false);
+    uint32_t offset = 0;
+    for (const auto &skip : skips) {
+        EXPECT_TRUE_OR_RETURN(skip.bits <= 32 && skip.offset == offset, false);
+        offset += skip.bits * LANE_NUM::value;
+    }
+    EXPECT_EQ_OR_RETURN(offset, packed.size(), false);
+    return true;
+}
+
+void PostingList::_flush_tail() {
+    uint32_t deltas[BLOCK_SIZE::value];
+    uint32_t prev = skips.empty() ? 0 : skips.back().max_doc_id;
+    uint32_t max_delta = 0;
+    for (uint32_t i = 0; i < BLOCK_SIZE::value; ++i) {
+        deltas[i] = tail[i] - prev;
+        prev = tail[i];
+        max_delta |= deltas[i];
+    }
+    SkipEntry skip;
+    skip.max_doc_id = tail[BLOCK_SIZE::value - 1];
+    skip.offset = static_cast<uint32_t>(packed.size());
+    skip.bits = _bit_width(max_delta);
+    packed.resize(packed.size() + skip.bits * LANE_NUM::value, 0);
+    pack_block(deltas, skip.bits, packed.data() + skip.offset);
+    skips.push_back(skip);
+    tail.erase(tail.begin(), tail.begin() + BLOCK_SIZE::value);
+}
+
+uint32_t PostingList::_bit_width(uint32_t value) {
+    return 0 == value ? 0 : 32 - __builtin_clz(value);
+}
+
+void PostingList::pack_block(const uint32_t* in, uint32_t bits, uint32_t* packed) {
+    const auto lanes = LANE_NUM::value;
+    const auto rows = BLOCK_SIZE::value / lanes;
+    memset(packed, 0, sizeof(uint32_t) * bits * lanes);
+    for (uint32_t lane = 0; lane < lanes; ++lane) {
+        uint32_t bit_pos = 0;
+        for (uint32_t row = 0; row < rows; ++row, bit_pos += bits) {
+            auto value = in[row * lanes + lane];
+            auto word = bit_pos >> 5;
+            auto shift = bit_pos & 31;
+            packed[word * lanes + lane] |= value << shift;
+            if (shift + bits > 32) {
+                packed[(word + 1) * lanes + lane] |= value >> (32 - shift);
+            }
+        }
+    }
+}
+
+void PostingList::unpack_block(const uint32_t* packed, uint32_t bits,
+        uint32_t base, uint32_t* out) {
+#if defined(__SSE2__)
+    const auto rows = BLOCK_SIZE::value / LANE_NUM::value;
+    const __m128i* in = reinterpret_cast<const __m128i*>(packed);
+    const __m128i mask = _mm_set1_epi32(bits >= 32 ? -1 : static_cast<int>((1u << bits) - 1));
+    __m128i carry = _mm_set1_epi32(static_cast<int>(base));
+    uint32_t bit_pos = 0;
+    for (uint32_t row = 0; row < rows; ++row, bit_pos += bits) {
+        auto word = bit_pos >> 5;
+        auto shift = bit_pos & 31;
+        __m128i value = _mm_setzero_si128();
+        if (bits > 0) {
+            value = _mm_srl_epi32(_mm_loadu_si128(in + word), _mm_cvtsi32_si128(shift));
+            if (shift + bits > 32) {
+                value = _mm_or_si128(value, _mm_sll_epi32(
+                        _mm_loadu_si128(in + word + 1), _mm_cvtsi32_si128(32 - shift)));
+            }
+            value = _mm_and_si128(value, mask);
+        }
+        // 4 个差值做前缀和, 再加上一行的最后一个值
+        value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+        value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+        value = _mm_add_epi32(value, carry);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + row * LANE_NUM::value), value);
+        carry = _mm_shuffle_epi32(value, 0xFF);
+    }
+#else
+    _unpack_block_scalar(packed, bits, base, out);
+#endif
+}
+
+void PostingList::_unpack_block_scalar(const uint32_t* packed, uint32_t bits,
+        uint32_t base, uint32_t* out) {
+    const auto lanes = LANE_NUM::value;
+    const auto rows = BLOCK_SIZE::value / lanes;
+    const uint32_t mask = bits >= 32 ? 0xffffffff : (1u << bits) - 1;
+    for (uint32_t lane = 0; lane < lanes; ++lane) {
+        uint32_t bit_pos = 0;
+        for (uint32_t row = 0; row < rows; ++row, bit_pos += bits) {
+            if (0 == bits) {
+                out[row * lanes + lane] = 0;
+                continue;
+            }
+            auto word = bit_pos >> 5;
+            auto shift = bit_pos & 31;
+            auto value = packed[word * lanes + lane] >> shift;
+            if (shift + bits > 32) {
+                value |= packed[(word + 1) * lanes + lane] << (32 - shift);
+            }
+            out[row * lanes + lane] = value & mask;
+        }
+    }
+    // 差值还原
+    for (uint32_t i = 0; i < BLOCK_SIZE::value; ++i) {
+        base += out[i];
+        out[i] = base;
+    }
+}
+
+// -----------------------------------------------------------
+
+PositionList::PositionList() {}
+
+void PositionList::insert(std::size_t rank, const std::vector<uint16_t> &pos) {
+    if (offsets.empty()) {
+        offsets.push_back(0);
+    }
+    auto start = offsets[rank];
+    auto cnt = static_cast<uint32_t>(pos.size());
+    positions.insert(positions.begin() + start, pos.begin(), pos.end());
+    offsets.insert(offsets.begin() + rank + 1, start + cnt);
+    // 插在中间时, 后面 doc 的区间整体后移
+    for (auto i = rank + 2; i < offsets.size(); ++i) {
+        offsets[i] += cnt;
+    }
+}
+
+void PositionList::remove(std::size_t rank) {
+    EXPECT_LT_OR_RETURN(rank, size(), RETURN_ON_VOID);
+    auto start = offsets[rank];
+    auto cnt = offsets[rank + 1] - start;
+    positions.erase(positions.begin() + start, positions.begin() + start + cnt);
+    offsets.erase(offsets.begin() + rank + 1);
+    for (auto i = rank + 1; i < offsets.size(); ++i) {
+        offsets[i] -= cnt;
+    }
+}
+
+void PositionList::append(const PositionList &other) {
+    if (other.empty()) {
+        return;
+    }
+    if (offsets.empty()) {
+        offsets.push_back(0);
+    }
+    auto base = offsets.back();
+    for (std::size_t i = 1; i < other.offsets.size(); ++i) {
+        offsets.push_back(base + other.offsets[i]);
+    }
+    positions.insert(positions.end(), other.positions.begin(), other.positions.end());
+}
+
+const uint16_t* PositionList::begin(std::size_t rank) const {
+    return positions.data() + offsets[rank];
+}
+
+const uint16_t* PositionList::end(std::size_t rank) const {
+    return positions.data() + offsets[rank + 1];
+}
+
+std::size_t PositionList::size() const {
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+bool PositionList::empty() const {
+    return offsets.empty();
+}
+
+std::size_t PositionList::memory_usage() const {
+    return sizeof(*this) \
+        + offsets.capacity() * sizeof(uint32_t) \
+        + positions.capacity() * sizeof(uint16_t);
+}
+
+/*
+ * u32 offset_cnt | offset_cnt * u32 | u32 pos_cnt | pos_cnt * u16
+ */
+void PositionList::dump(BinaryWriter &writer) const {
+    writer.write_vec(offsets);
+    writer.write_vec(positions);
+}
+
+bool PositionList::load(BinaryReader &reader) {
+    reader.read_vec(offsets);
+    reader.read_vec(positions);
+    EXPECT_TRUE_OR_RETURN(reader.ok(), false);
+    if (offsets.empty()) {
+        return positions.empty();
+    }
+    EXPECT_EQ_OR_RETURN(0, offsets.front(), false);
+    EXPECT_EQ_OR_RETURN(offsets.back(), positions.size(), false);
+    EXPECT_TRUE_OR_RETURN(std::is_sorted(offsets.begin(), offsets.end()), false);
+    return true;
+}
+
+}; // end of namespace tiny_engine
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,226 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    query_server.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 18:26:51
+*   @brief:
+*
+*****************************************************************/
+
+
+#include "../include/query_server.h"
+#include "../third_party/jsonxx/json.hpp"
+#include <poll.h>
+#include <limits>
+
+namespace tiny_engine {
+
+volatile sig_atomic_t QueryServer::is_stopped = 0;
+
+QueryServer::QueryServer(const TinyEngine* engine, const std::string &config) :
+    engine(engine),
+    configs(std::make_shared<ConfigUtil>(config)),
+    worker_num(WORKER_NUM::value),
+    queue_size(QUEUE_SIZE::value),
+    served_cnt(0),
+    total_cost_us(0) {}
+
+void QueryServer::stop() {
+    is_stopped = 1;
+}
+
+bool QueryServer::init() {
+    EXPECT_TRUE_OR_RETURN_LOGGED(configs->init(), false, "load config file failed");
+    if (!configs->get_value("SERVER_ADDRESS", server_address) || server_address.empty()) {
+        server_address = "./data/tiny_engine.sock";
+        LOG_WARNING("key[SERVER_ADDRESS] not found, set to[%s]", server_address.c_str());
+    }
+    if (!configs->get_value("MAX_PARALLEL_TASKS", worker_num) || worker_num < 1) {
+        worker_num = WORKER_NUM::value;
+        LOG_WARNING("key[MAX_PARALLEL_TASKS] not found or invalid, set to[%d]", worker_num);
+    }
+    if (!configs->get_value("SERVER_QUEUE_SIZE", queue_size) || queue_size < 1) {
+        queue_size = QUEUE_SIZE::value;
+        LOG_WARNING("key[SERVER_QUEUE_SIZE] not found or invalid, set to[%d]", queue_size);
+    }
+    queue.reset(new limonp::BoundedBlockingQueue<std::shared_ptr<Request>>(queue_size));
+    return true;
+}
+
+int QueryServer::_listen(const std::string &address) const {
+    const std::string tcp_prefix = "tcp:";
+    if (0 != address.compare(0, tcp_prefix.size(), tcp_prefix)) {
+        return SocketUtil::listen_unix(address);
+    }
+    int port = 0;
+    try {
+        port = std::stoi(address.substr(tcp_prefix.size()));
+    } catch (std::exception &e) {
+        LOG_WARNING("invalid server address[%s]", address.c_str());
+        return -1;
+    }
+    return SocketUtil::listen_tcp(port);
+}
+
+bool QueryServer::run(const std::string &address) {
+    EXPECT_NE_OR_RETURN(nullptr, engine, false);
+    EXPECT_NE_OR_RETURN_LOGGED(nullptr, queue, false, "query server not inited");
+    auto listen_address = address.empty() ? server_address : address;
+    int listen_fd = _listen(listen_address);
+    EXPECT_GE_OR_RETURN(listen_fd, 0, false);
+    LOG_INFO("query server listening on[%s], workers[%d] queue_size[%d]",
+            listen_address.c_str(), worker_num, queue_size);
+
+    auto time_begin = TimeUtil::get_curr_timeval();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < worker_num; ++i) {
+        workers.emplace_back(&QueryServer::_work_loop, this);
+    }
+    ConnThreadGroup readers;
+    while (!is_stopped) {
+        readers.reap();
+        // 带超时的 poll, 以便及时响应 stop()
+        struct pollfd pfd = {listen_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        SocketUtil::set_recv_timeout(fd, IDLE_TIMEOUT_MS::value);
+        {
+            std::lock_guard<std::mutex> lock(conn_mutex);
+            conn_fds.insert(fd);
+        }
+        readers.start(std::bind(&QueryServer::_read_loop, this, std::make_shared<Connection>(fd)));
+    }
+
+    SocketUtil::close_fd(listen_fd);
+    if (0 != listen_address.compare(0, 4, "tcp:")) {
+        unlink(listen_address.c_str());
+    }
+    {
+        // 只关闭读方向, 已入队请求的响应仍可写回
+        std::lock_guard<std::mutex> lock(conn_mutex);
+        for (auto fd : conn_fds) {
+            shutdown(fd, SHUT_RD);
+        }
+    }
+    readers.join_all();
+    // 退出信号排在已入队的请求之后
+    for (int i = 0; i < worker_num; ++i) {
+        queue->Push(nullptr);
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    auto time_end = TimeUtil::get_curr_timeval();
+    auto elapsed_ms = TimeUtil::timeval_diff_ms(&time_begin, &time_end);
+    uint64_t served = served_cnt;
+    LOG_INFO("query server on[%s] stopped, served[%lu] in %lu ms, qps[%.1f] avg_cost[%lu us]",
+            listen_address.c_str(), served, elapsed_ms,
+            elapsed_ms > 0 ? served * 1000.0 / elapsed_ms : 0.0,
+            served > 0 ? total_cost_us / served : 0);
+    return true;
+}
+
+void QueryServer::_read_loop(std::shared_ptr<Connection> conn) {
+    std::string buf;
+    std::string line;
+    while (!is_stopped && SocketUtil::read_line(conn->fd, buf, line)) {
+        if (StrUtil::is_space_str(line)) {
+            continue;
+        }
+        auto request = std::make_shared<Request>();
+        request->conn = conn;
+        request->line.swap(line);
+        request->enqueue_time = TimeUtil::get_curr_timeval();
+        queue->Push(request); // 队列满时阻塞
+    }
+    std::lock_guard<std::mutex> lock(conn_mutex);
+    conn_fds.erase(conn->fd);
+}
+
+void QueryServer::_work_loop() {
+    while (true) {
+        auto request = queue->Pop();
+        if (nullptr == request) {
+            break;
+        }
+        auto response = handle_request(request->line);
+        auto time_end = TimeUtil::get_curr_timeval();
+        auto cost_us = TimeUtil::timeval_diff_us(&request->enqueue_time, &time_end);
+        // cost_us 含排队时间, 在 worker 中补到响应末尾
+        response.insert(response.size() - 1, StrUtil::format(",\"cost_us\":{}", cost_us));
+        response.push_back('\n');
+        {
+            std::lock_guard<std::mutex> lock(request->conn->write_mutex);
+            if (!SocketUtil::write_all(request->conn->fd, response)) {
+                LOG_WARNING("write response to fd[%d] failed", request->conn->fd);
+            }
+        }
+        ++served_cnt;
+        total_cost_us += cost_us;
+    }
+}
+
+std::string QueryServer::handle_request(const std::string &line) const {
+    jsonxx::json response;
+    response["id"] = nullptr;
+    response["status"] = STATUS_OK::value;
+    response["msg"] = "ok";
+    response["degrade"] = jsonxx::json::array({});
+    response["results"] = jsonxx::json::array({});
+    std::string query;
+    int timeout_ms = -1;
+    try {
+        auto request = jsonxx::json::parse(line);
+        if (!request.is_object()) {
+            throw std::invalid_argument("request is not a json object");
+        }
+        if (request.count("id") > 0) {
+            response["id"] = request["id"];
+        }
+        if (request.count("query") == 0 || !request["query"].is_string()) {
+            throw std::invalid_argument("missing string field[query]");
+        }
+        query = request["query"].as_string();
+        if (request.count("timeout_ms") > 0) {
+            auto &timeout = request["timeout_ms"];
+            if (!timeout.is_integer() || timeout.as_int() < 0
+                    || timeout.as_int() > std::numeric_limits<int>::max()) {
+                throw std::invalid_argument("field[timeout_ms] must be a non-negative integer");
+            }
+            timeout_ms = static_cast<int>(timeout.as_int());
+        }
+    } catch (std::exception &e) {
+        LOG_WARNING("invalid request[%s]: %s", line.c_str(), e.what());
+        response["status"] = STATUS_BAD_REQUEST::value;
+        response["msg"] = std::string("invalid request: ") + e.what();
+        return response.dump();
+    }
+    std::vector<TinyEngine::StrStrPair> result;
+    std::vector<float> scores;
+    uint32_t degrade_flags = DEGRADE_NONE;
+    if (query.empty() || !engine->search(query, result, &scores, timeout_ms, &degrade_flags)) {
+        result.clear();
+    }
+    std::vector<std::string> degrade_names;
+    TinyEngine::get_degrade_names(degrade_flags, degrade_names);
+    for (const auto &name : degrade_names) {
+        response["degrade"].push_back(name);
+    }
+    for (std::size_t i = 0; i < result.size(); ++i) {
+        jsonxx::json doc;
+        doc["title"] = result[i].first;
+        doc["url"] = result[i].second;
+        doc["score"] = scores[i];
+        response["results"].push_back(std::move(doc));
+    }
+    return response.dump();
+}
+
+}; // end of namespace tiny_engine
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,191 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    search_pipeline.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 19:20:13
+*   @brief:
+*
+*****************************************************************/
+
+
+#include "../include/search_pipeline.h"
+
+namespace tiny_engine {
+
+SearchPipeline::SearchPipeline(const TinyEngine* engine, const std::string &config) :
+    engine(engine),
+    configs(std::make_shared<ConfigUtil>(config)),
+    queue_size(QUEUE_SIZE::value),
+    next_seq(0),
+    next_output_seq(0),
+    is_running(false) {
+    for (int i = 0; i < STAGE_NUM; ++i) {
+        worker_num[i] = STAGE_WORKER_NUM::value;
+    }
+    worker_num[STAGE_OUTPUT] = 1;
+}
+
+SearchPipeline::~SearchPipeline() {
+    stop();
+}
+
+const char* SearchPipeline::stage_name(int stage) {
+    static const char* names[STAGE_NUM] = {"segment", "recall", "rank", "output"};
+    return stage >= 0 && stage < STAGE_NUM ? names[stage] : "unknown";
+}
+
+bool SearchPipeline::init() {
+    EXPECT_TRUE_OR_RETURN_LOGGED(configs->init(), false, "load config file failed");
+    if (!configs->get_value("PIPELINE_QUEUE_SIZE", queue_size) || queue_size < 1) {
+        queue_size = QUEUE_SIZE::value;
+        LOG_WARNING("key[PIPELINE_QUEUE_SIZE] not found or invalid, set to[%d]", queue_size);
+    }
+    // 输出阶段固定一个线程, 保证回调顺序
+    const std::string keys[] = {
+        "PIPELINE_SEGMENT_WORKERS", "PIPELINE_RECALL_WORKERS", "PIPELINE_RANK_WORKERS"};
+    for (int i = STAGE_SEGMENT; i < STAGE_OUTPUT; ++i) {
+        if (!configs->get_value(keys[i], worker_num[i]) || worker_num[i] < 1) {
+            worker_num[i] = STAGE_WORKER_NUM::value;
+            LOG_WARNING("key[%s] not found or invalid, set to[%d]",
+                    keys[i].c_str(), worker_num[i]);
+        }
+    }
+    return true;
+}
+
+bool SearchPipeline::start() {
+    EXPECT_NE_OR_RETURN(nullptr, engine, false);
+    EXPECT_FALSE_OR_RETURN_LOGGED(is_running, false, "search pipeline already started");
+    for (int i = 0; i < STAGE_NUM; ++i) {
+        queues[i].reset(new TaskQueue(queue_size));
+    }
+    for (int i = 0; i < STAGE_NUM; ++i) {
+        for (int k = 0; k < worker_num[i]; ++k) {
+            workers[i].emplace_back(&SearchPipeline::_work_loop, this, i);
+        }
+    }
+    is_running = true;
+    LOG_INFO("search pipeline started, workers[%d/%d/%d/%d] queue_size[%d]",
+            worker_num[STAGE_SEGMENT], worker_num[STAGE_RECALL],
+            worker_num[STAGE_RANK], worker_num[STAGE_OUTPUT], queue_size);
+    return true;
+}
+
+bool SearchPipeline::submit(const std::string &query, Callback done) {
+    EXPECT_TRUE_OR_RETURN_LOGGED(is_running, false, "search pipeline not started");
+    auto task = std::make_shared<SearchTask>(query);
+    task->seq = next_seq++;
+    task->done = done;
+    task->submit_time = TimeUtil::get_curr_timeval();
+    _push(STAGE_SEGMENT, task);
+    return true;
+}
+
+void SearchPipeline::stop() {
+    if (!is_running) {
+        return;
+    }
+    // 逐个阶段发送退出信号: 前一阶段的线程都退出后, 其输出已全部进入下一阶段的队列
+    for (int i = 0; i < STAGE_NUM; ++i) {
+        for (int k = 0; k < worker_num[i]; ++k) {
+            queues[i]->Push(nullptr);
+        }
+        for (auto &worker : workers[i]) {
+            worker.join();
+        }
+        workers[i].clear();
+    }
+    is_running = false;
+    LOG_INFO("search pipeline stopped, submitted[%lu]", next_seq);
+    for (int i = 0; i < STAGE_NUM; ++i) {
+        LOG_INFO("%s", stats(i).c_str());
+    }
+}
+
+std::string SearchPipeline::stats(int stage) const {
+    EXPECT_TRUE_OR_RETURN(stage >= 0 && stage < STAGE_NUM, std::string());
+    const auto &stat = stage_stats[stage];
+    uint64_t cnt = stat.task_cnt;
+    uint64_t div = cnt > 0 ? cnt : 1;
+    return StrUtil::format(
+            "stage[{}] workers[{}] tasks[{}] avg_depth[{}] max_depth[{}] "
+            "avg_wait[{} us] avg_busy[{} us]",
+            stage_name(stage), worker_num[stage], cnt,
+            static_cast<float>(stat.depth_sum) / div, uint64_t(stat.max_depth),
+            stat.wait_us / div, stat.busy_us / div);
+}
+
+void SearchPipeline::_push(int stage, std::shared_ptr<SearchTask> task) {
+    task->enqueue_time = TimeUtil::get_curr_timeval();
+    auto &stat = stage_stats[stage];
+    uint64_t depth = ++stat.depth;
+    queues[stage]->Push(task); // 队列满时阻塞, 上游阶段随之放慢
+    stat.depth_sum += depth;
+    // 并发更新时可能少记, 只用于观察
+    if (depth > stat.max_depth) {
+        stat.max_depth = depth;
+    }
+}
+
+void SearchPipeline::_work_loop(int stage) {
+    auto &stat = stage_stats[stage];
+    while (true) {
+        auto task = queues[stage]->Pop();
+        if (nullptr == task) {
+            break;
+        }
+        --stat.depth;
+        auto time_begin = TimeUtil::get_curr_timeval();
+        stat.wait_us += TimeUtil::timeval_diff_us(&task->enqueue_time, &time_begin);
+        if (STAGE_OUTPUT == stage) {
+            _output(task);
+        } else {
+            _run_stage(stage, *task);
+        }
+        auto time_end = TimeUtil::get_curr_timeval();
+        ++stat.task_cnt;
+        stat.busy_us += TimeUtil::timeval_diff_us(&time_begin, &time_end);
+        // 下游队列满时的阻塞不计入本阶段的处理耗时
+        if (STAGE_OUTPUT != stage) {
+            _push(stage + 1, task);
+        }
+    }
+}
+
+void SearchPipeline::_run_stage(int stage, SearchTask &task) const {
+    if (STAGE_SEGMENT != stage && !task.is_ok) {
+        return;
+    }
+    switch (stage) {
+        case STAGE_SEGMENT:
+            task.is_ok = !task.ctx.query.empty() && engine->prepare_query(task.ctx);
+            break;
+        case STAGE_RECALL:
+            engine->recall(task.ctx);
+            break;
+        case STAGE_RANK:
+            engine->rank(task.ctx);
+            break;
+        default:
+            break;
+    }
+}
+
+void SearchPipeline::_output(std::shared_ptr<SearchTask> task) {
+    pending_output[task->seq] = task;
+    for (auto it = pending_output.begin();
+            it != pending_output.end() && it->first == next_output_seq;
+            it = pending_output.erase(it), ++next_output_seq) {
+        auto &ready = *it->second;
+        if (ready.is_ok) {
+            engine->fill_result(ready.ctx, ready.result, &ready.scores);
+        }
+        if (ready.done) {
+            ready.done(ready);
+        }
+    }
+}
+
+}; // end of namespace tiny_engine
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
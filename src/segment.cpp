@@ -59,17 +59,26 @@ bool Segment::init(std::shared_ptr<ConfigUtil> configs) {
 
 bool Segment::get_token(const std::string &str,
         std::vector<TermNode> &tokens,
-        TOKEN_TYPE type) {
+        TOKEN_TYPE type) const {
     EXPECT_FALSE_OR_RETURN(str.empty(), false);
     EXPECT_TRUE_OR_DO(tokens.empty(), tokens.clear());
     std::vector<cppjieba::Word> seg_results;
     EXPECT_TRUE_OR_RETURN(_get_token(str, seg_results, type), false);
+    // 签名与 StrUtil::str_to_sign 一致, 一次算完所有切词
+    std::vector<std::string> words;
+    words.reserve(seg_results.size());
     for (const auto &term : seg_results) {
-        auto sign = StrUtil::str_to_sign(StrUtil::to_lower_case(term.word));
-        TermNode node(sign,
-                term.word,
+        words.push_back(StrUtil::to_lower_case(term.word));
+    }
+    std::vector<uint64_t> signs;
+    HashUtil::hash64(words, signs);
+    tokens.reserve(seg_results.size());
+    for (std::size_t i = 0; i < seg_results.size(); ++i) {
+        const auto &term = seg_results[i];
+        TermNode node(signs[i],
                 term.unicode_offset,
-                term.unicode_length);
+                term.unicode_length,
+                StrUtil::is_space_str(term.word));
         tokens.push_back(std::move(node));
     }
     return true;
@@ -77,32 +86,21 @@ bool Segment::get_token(const std::string &str,
 
 bool Segment::update_global_info(
             std::vector<TermNode> &tokens,
-            std::unordered_map<std::size_t, GlobalTermInfo> &out) const {
-    EXPECT_FALSE_OR_RETURN(tokens.empty(), false);
-    EXPECT_TRUE_OR_DO(out.empty(), out.clear());
-
-    std::size_t pre_term_sign = 0;
-    for (auto i = 0; i < tokens.size(); ++i) {
-        auto &token = tokens[i];
-        auto tf = out.count(token.token_sign);
-        token.dup = tf + 1;
-
-        if (tf > 0) {
-            out[token.token_sign].term_freq += 1;
-            out[token.token_sign].offsets.push_back(token.offset);
-        } else {
-            GlobalTermInfo gti(pre_term_sign, 1, i);
-            gti.offsets.push_back(token.offset);
-            out[token.token_sign] = std::move(gti);
-        }
-        pre_term_sign = token.token_sign;
-    }
-    return true;
+            TermInfoMap<std::size_t> &out) {
+    return _update_global_info(tokens,
+            [](const TermNode &token) { return token.token_sign; }, out);
+}
+
+bool Segment::update_global_info(
+            std::vector<TermNode> &tokens,
+            TermInfoMap<uint32_t> &out) {
+    return _update_global_info(tokens,
+            [](const TermNode &token) { return token.term_id; }, out);
 }
 
 bool Segment::_get_token(const std::string &str,
         std::vector<cppjieba::Word> &seg_results,
-        TOKEN_TYPE type) {
+        TOKEN_TYPE type) const {
     switch (type) {
         case MP_MODE:
             jieba->Cut(str, seg_results, false);
@@ -0,0 +1,179 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    socket_util.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 16:21:05
+*   @brief:
+*
+*****************************************************************/
+
+
+#include "../include/socket_util.h"
+#include <poll.h>
+#include <sys/time.h>
+
+namespace tiny_engine {
+
+bool SocketUtil::_fill_unix_addr(const std::string &path, struct sockaddr_un &addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        LOG_WARNING("invalid unix socket path[%s]", path.c_str());
+        return false;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return true;
+}
+
+int SocketUtil::listen_unix(const std::string &path, int backlog) {
+    struct sockaddr_un addr;
+    EXPECT_TRUE_OR_RETURN(_fill_unix_addr(path, addr), -1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    EXPECT_GE_OR_RETURN(fd, 0, -1);
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0
+            || listen(fd, backlog) < 0) {
+        LOG_WARNING("listen on [%s] failed, errno=%d", path.c_str(), errno);
+        close_fd(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int SocketUtil::listen_tcp(int port, int backlog) {
+    EXPECT_TRUE_OR_RETURN(port > 0 && port < 65536, -1);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    EXPECT_GE_OR_RETURN(fd, 0, -1);
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0
+            || listen(fd, backlog) < 0) {
+        LOG_WARNING("listen on [127.0.0.1:%d] failed, errno=%d", port, errno);
+        close_fd(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int SocketUtil::connect_unix(const std::string &path) {
+    struct sockaddr_un addr;
+    EXPECT_TRUE_OR_RETURN(_fill_unix_addr(path, addr), -1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    EXPECT_GE_OR_RETURN(fd, 0, -1);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0
+            || !set_nonblocking(fd)) {
+        LOG_WARNING("connect to [%s] failed, errno=%d", path.c_str(), errno);
+        close_fd(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool SocketUtil::set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    EXPECT_GE_OR_RETURN(flags, 0, false);
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) >= 0;
+}
+
+bool SocketUtil::set_recv_timeout(int fd, int timeout_ms) {
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    return setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0;
+}
+
+bool SocketUtil::write_all(int fd, const std::string &data) {
+    std::size_t offset = 0;
+    while (offset < data.size()) {
+        auto n = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+        if (n > 0) {
+            offset += n;
+            continue;
+        }
+        if (n < 0 && EINTR == errno) {
+            continue;
+        }
+        if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+            struct pollfd pfd = {fd, POLLOUT, 0};
+            poll(&pfd, 1, -1);
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool SocketUtil::read_line(int fd, std::string &buf, std::string &line) {
+    char chunk[4096];
+    while (true) {
+        auto pos = buf.find('\n');
+        if (pos != std::string::npos) {
+            line.assign(buf, 0, pos);
+            buf.erase(0, pos + 1);
+            return true;
+        }
+        auto n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            buf.append(chunk, n);
+        } else if (n < 0 && EINTR == errno) {
+            continue;
+        } else {
+            return false; // 对端关闭, 超时或出错
+        }
+    }
+}
+
+void SocketUtil::close_fd(int &fd) {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+ConnThreadGroup::~ConnThreadGroup() {
+    join_all();
+}
+
+void ConnThreadGroup::start(std::function<void()> func) {
+    std::unique_ptr<ConnThread> conn_thread(new ConnThread());
+    auto* is_done = &conn_thread->is_done;
+    conn_thread->thread = std::thread([func, is_done]() {
+        func();
+        is_done->store(true);
+    });
+    threads.push_back(std::move(conn_thread));
+}
+
+std::size_t ConnThreadGroup::reap() {
+    std::size_t reaped_cnt = 0;
+    for (auto iter = threads.begin(); iter != threads.end(); ) {
+        if (!(*iter)->is_done.load()) {
+            ++iter;
+            continue;
+        }
+        (*iter)->thread.join();
+        iter = threads.erase(iter);
+        ++reaped_cnt;
+    }
+    return reaped_cnt;
+}
+
+void ConnThreadGroup::join_all() {
+    for (auto &conn_thread : threads) {
+        conn_thread->thread.join();
+    }
+    threads.clear();
+}
+
+std::size_t ConnThreadGroup::size() const {
+    return threads.size();
+}
+
+}; // end of namespace tiny_engine
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -10,6 +10,7 @@
 
 
 #include "../include/str_util.h"
+#include "../include/hash_util.h"
 
 namespace tiny_engine {
 
@@ -83,6 +84,24 @@ std::string StrUtil::trim_with(const std::string &str, char ch) {
         str.substr(head, tail - head + 1);
 }
 
+std::string StrUtil::squeeze_space(const std::string &str) {
+    std::string res;
+    res.reserve(str.size());
+    bool is_space = false;
+    for (const auto &ch : str) {
+        if (std::isspace(ch & 0xff)) {
+            is_space = true;
+            continue;
+        }
+        if (is_space && !res.empty()) {
+            res.push_back(' ');
+        }
+        is_space = false;
+        res.push_back(ch);
+    }
+    return res;
+}
+
 std::string StrUtil::wstr_to_str(const std::wstring &wstr) {
     /*
     using F = std::codecvt_byname<wchar_t, char, std::mbstate_t>;
@@ -114,8 +133,7 @@ std::string StrUtil::gbk_to_utf8(const std::string &str) {
 }
 
 std::size_t StrUtil::str_to_sign(const std::string &str) {
-    std::hash<std::string> h;
-    return h(str);
+    return HashUtil::hash64(str);
 }
 
 std::size_t StrUtil::get_char_len(const std::string &str) {
@@ -134,6 +152,59 @@ std::size_t StrUtil::get_char_len(const char* str) {
     return len;
 }
 
+void StrUtil::utf8_to_unicode(const std::string &str, std::vector<uint32_t> &code_points) {
+    code_points.clear();
+    code_points.reserve(get_char_len(str));
+    std::size_t i = 0;
+    while (i < str.size()) {
+        auto lead = static_cast<unsigned char>(str[i]);
+        std::size_t len = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xe ? 3
+            : (lead >> 3) == 0x1e ? 4 : 0;
+        uint32_t code_point = len > 1 ? lead & (0x7f >> len) : lead;
+        std::size_t j = 1;
+        for (; j < len && i + j < str.size(); ++j) {
+            auto ch = static_cast<unsigned char>(str[i + j]);
+            if ((ch & 0xc0) != 0x80) {
+                break;
+            }
+            code_point = (code_point << 6) | (ch & 0x3f);
+        }
+        if (len > 1 && j == len) {
+            code_points.push_back(code_point);
+            i += len;
+        } else {
+            code_points.push_back(lead);
+            ++i;
+        }
+    }
+}
+
+std::string StrUtil::unicode_to_utf8(const std::vector<uint32_t> &code_points,
+        std::size_t offset,
+        std::size_t len) {
+    std::string str;
+    auto end = std::min(offset + len, code_points.size());
+    for (auto i = offset; i < end; ++i) {
+        auto code_point = code_points[i];
+        if (code_point < 0x80) {
+            str.push_back(static_cast<char>(code_point));
+        } else if (code_point < 0x800) {
+            str.push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+            str.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+        } else if (code_point < 0x10000) {
+            str.push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+            str.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+            str.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+        } else {
+            str.push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+            str.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+            str.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+            str.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+        }
+    }
+    return str;
+}
+
 std::string StrUtil::to_lower_case(const std::string &str) {
     std::string result(str.size(), '\0');
     std::transform(str.begin(), str.end(), result.begin(), ::tolower);
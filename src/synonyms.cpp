@@ -18,6 +18,13 @@ bool Synonyms::init(std::shared_ptr<ConfigUtil> configs) {
     if (!configs->get_value("SYN_DICT", fpath)) {
         fpath = "./dict/cilin_ex.txt";
     }
+    int cache_size_mb = 0;
+    if (!configs->get_value("SYN_CACHE_SIZE_MB", cache_size_mb) || cache_size_mb < 0) {
+        cache_size_mb = SYN_CACHE_SIZE_MB::value;
+    }
+    if (cache_size_mb > 0) {
+        syn_cache.reset(new SynCache(static_cast<std::size_t>(cache_size_mb) << 20));
+    }
     return _load_data(fpath);
 }
 
@@ -74,15 +81,31 @@ bool Synonyms::get_syns(const string &term, vector<string> &out) const {
 bool Synonyms::get_syns(const string &term, vector<SynTermNode> &out) const {
     EXPECT_FALSE_OR_RETURN(term.empty(), false);
     EXPECT_TRUE_OR_DO(out.empty(), out.clear());
+    // 多数 term 没有同义词, 直接查词典比查缓存快
+    EXPECT_TRUE_OR_RETURN(term_idx_dict.count(term) > 0, false);
+    std::shared_ptr<const vector<SynTermNode>> cached = nullptr;
+    if (nullptr != syn_cache && syn_cache->get(term, 0, cached)) {
+        out = *cached;
+        return true;
+    }
 
     vector<string> all_syns;
     EXPECT_TRUE_OR_RETURN(get_syns(term, all_syns), false);
+    std::size_t charge = 0;
     for (const auto &term : all_syns) {
         out.push_back(SynTermNode(term));
+        charge += sizeof(SynTermNode) + term.size();
+    }
+    if (nullptr != syn_cache) {
+        syn_cache->put(term, 0, std::make_shared<const vector<SynTermNode>>(out), charge);
     }
     return true;
 }
 
+std::string Synonyms::get_cache_stats() const {
+    return nullptr == syn_cache ? std::string() : syn_cache->stats();
+}
+
 
 };
 
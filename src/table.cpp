@@ -13,13 +13,126 @@
 
 namespace tiny_engine {
 
-Table::Table() {
+IndexSegment::IndexSegment(uint32_t base) : base_doc(base) {}
+
+uint32_t IndexSegment::end_doc() const {
+    return base_doc + static_cast<uint32_t>(doc_list.size());
+}
+
+std::shared_ptr<DocInfo> IndexSegment::get_doc_info(const std::size_t &doc_sign) const {
+    auto iter = forward_table.find(doc_sign);
+    return iter != forward_table.end() ? iter->second : nullptr;
+}
+
+std::shared_ptr<DocInfo> IndexSegment::get_doc_info_by_id(uint32_t doc_id) const {
+    return doc_id >= base_doc && doc_id < end_doc() ? doc_list[doc_id - base_doc] : nullptr;
+}
+
+std::shared_ptr<InvTermInfo> IndexSegment::get_term_info(const std::size_t &term_sign) const {
+    auto iter = invert_table.find(term_sign);
+    return iter != invert_table.end() ? iter->second : nullptr;
+}
+
+IndexData::IndexData() :
+        segments(1, std::make_shared<IndexSegment>()),
+        deleted_docs(std::make_shared<std::unordered_set<uint32_t>>()),
+        doc_cnt(0),
+        sum_doc_len(0),
+        avg_doc_len(0.0),
+        generation(0) {}
+
+std::shared_ptr<DocInfo> IndexData::get_doc_info(const std::size_t &doc_sign) const {
+    // 同一 url 至多一个有效 doc, 旧 doc 已从 memtable 删除或记入 deleted_docs
+    for (auto it = segments.crbegin(); it != segments.crend(); ++it) {
+        auto doc_info = (*it)->get_doc_info(doc_sign);
+        if (nullptr != doc_info && !is_deleted(doc_info->doc_id)) {
+            return doc_info;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<DocInfo> IndexData::get_doc_info_by_id(uint32_t doc_id) const {
+    auto iter = std::upper_bound(segments.begin(), segments.end(), doc_id,
+            [](uint32_t id, const std::shared_ptr<IndexSegment> &segment) {
+                return id < segment->base_doc;
+            });
+    if (iter == segments.begin() || is_deleted(doc_id)) {
+        return nullptr;
+    }
+    return (*(iter - 1))->get_doc_info_by_id(doc_id);
+}
+
+std::shared_ptr<InvTermInfo> IndexData::get_term_info(const std::size_t &term_sign) const {
+    for (const auto &segment : segments) {
+        auto term_info = segment->get_term_info(term_sign);
+        if (nullptr != term_info) {
+            return term_info;
+        }
+    }
+    return nullptr;
+}
+
+void IndexData::get_term_infos(const std::size_t &term_sign,
+        uint32_t begin_doc,
+        uint32_t end_doc,
+        std::vector<std::shared_ptr<InvTermInfo>> &term_infos) const {
+    EXPECT_TRUE_OR_DO(term_infos.empty(), term_infos.clear());
+    for (const auto &segment : segments) {
+        if (segment->base_doc >= end_doc || segment->end_doc() <= begin_doc) {
+            continue;
+        }
+        auto term_info = segment->get_term_info(term_sign);
+        if (nullptr != term_info) {
+            term_infos.push_back(term_info);
+        }
+    }
+}
+
+float IndexData::get_term_idf(const std::size_t &term_sign) const {
+    std::size_t term_freq = 0;
+    bool is_found = false;
+    for (const auto &segment : segments) {
+        auto term_info = segment->get_term_info(term_sign);
+        if (nullptr != term_info) {
+            term_freq += term_info->term_freq;
+            is_found = true;
+        }
+    }
+    return is_found ? MathUtil::calculate_idf(term_freq, doc_cnt) : 0.0;
+}
+
+bool IndexData::is_deleted(uint32_t doc_id) const {
+    return !deleted_docs->empty() && deleted_docs->count(doc_id) > 0;
+}
+
+uint32_t IndexData::end_doc() const {
+    return segments.back()->end_doc();
+}
+
+Table::Table() :
+        max_syn_term_recall(0),
+        is_index_dirty(false),
+        build_position_index(false),
+        is_wand_recall(false),
+        max_parallel_tasks(1),
+        index_shard_num(1),
+        partition_id(0),
+        partition_num(1),
+        max_recall_num(0),
+        memtable_size(MEMTABLE_SIZE::value),
+        max_segment_num(MAX_SEGMENT_NUM::value),
+        index_data(std::make_shared<IndexData>()),
+        is_merge_stopped(false),
+        pair_cache(new PairCache()),
+        recall_pool(new TaskPool(0)) {
     forward_file_path = new char[MAX_FILE_PATH_LEN::value];
     invert_file_path = new char[MAX_FILE_PATH_LEN::value];
     index_file_path = new char[MAX_FILE_PATH_LEN::value];
 }
 
 Table::~Table() {
+    _stop_merge_thread();
     SAFE_DELETE_ARR_PTR(forward_file_path);
     SAFE_DELETE_ARR_PTR(invert_file_path);
     SAFE_DELETE_ARR_PTR(index_file_path);
@@ -28,18 +141,29 @@ Table::~Table() {
 bool Table::init(std::shared_ptr<ConfigUtil> configs,
         std::shared_ptr<Segment> wordseg) {
     EXPECT_NE_OR_RETURN(nullptr, configs, false);
+    if (!configs->get_value("INDEX_PARTITION_NUM", partition_num) || partition_num < 1) {
+        partition_num = 1;
+    }
+    if (!configs->get_value("INDEX_PARTITION_ID", partition_id)) {
+        partition_id = 0;
+    }
+    EXPECT_TRUE_OR_RETURN_LOGGED(partition_id >= 0 && partition_id < partition_num,
+            false, "invalid INDEX_PARTITION_ID");
+    // 多个分片进程共用一份配置时, 二进制索引文件按分片号区分
+    std::string suffix = partition_num > 1 ? "." + std::to_string(partition_id) : "";
+
     std::string value;
     if (!configs->get_value("FORWARD_TABLE", value)) {
         value = "./index/fwd.list";
         LOG_WARNING("key[FORWARD_TABLE] not found, set to[%s]", value.c_str());
     }
-    set_fwd_path(value);
+    set_fwd_path(value + suffix);
 
     if (!configs->get_value("INVERTED_TABLE", value)) {
         value = "./index/inv.list";
         LOG_WARNING("key[INVERTED_TABLE] not found, set to[%s]", value.c_str());
     }
-    set_inv_path(value);
+    set_inv_path(value + suffix);
 
     if (!configs->get_value("INDEX_FILE", value)) {
         value = "./index/url.list.utf8";
@@ -55,14 +179,38 @@ bool Table::init(std::shared_ptr<ConfigUtil> configs,
         LOG_WARNING("load stopword[%s] failed", value.c_str());
     }
 
+    int position_option = 0;
+    if (!configs->get_value("BUILD_POSITION_INDEX", position_option)) {
+        LOG_WARNING("key[BUILD_POSITION_INDEX] not found, set to[%d]", position_option);
+    }
+    build_position_index = (1 == position_option);
+
+    if (!configs->get_value("MAX_PARALLEL_TASKS", max_parallel_tasks) || max_parallel_tasks < 1) {
+        max_parallel_tasks = 1;
+        LOG_WARNING("key[MAX_PARALLEL_TASKS] not found, set to[%d]", max_parallel_tasks);
+    }
+
+    if (!configs->get_value("INDEX_SHARD_NUM", index_shard_num) || index_shard_num < 1) {
+        index_shard_num = 1;
+        LOG_WARNING("key[INDEX_SHARD_NUM] not found, set to[%d]", index_shard_num);
+    }
+    // 调用线程执行一个分片, 其余分片由常驻线程执行
+    recall_pool.reset(new TaskPool(index_shard_num - 1));
+
     int index_load_option = 0;
-    if (!configs->get_value("LOAD_FROM_JSON", index_load_option)) {
+    if (!configs->get_value("LOAD_FROM_BIN", index_load_option)) {
         index_load_option = 0;
-        LOG_WARNING("key[LOAD_FROM_JSON] not found, set to[%d]", index_load_option);
+        LOG_WARNING("key[LOAD_FROM_BIN] not found, set to[%d]", index_load_option);
     }
+    bool is_loaded = false;
     if (1 == index_load_option) {
-        EXPECT_TRUE_OR_RETURN_LOGGED(load_index_from_json(), false, "load index error");
-    } else if (nullptr != wordseg) {
+        is_loaded = load_index_from_bin();
+        if (!is_loaded) {
+            LOG_WARNING("load binary index failed, rebuild from[%s]", index_file_path);
+            _clear_index();
+        }
+    }
+    if (!is_loaded && nullptr != wordseg) {
         EXPECT_TRUE_OR_RETURN_LOGGED(load_index_from_file(wordseg), false, "load index error");
 #ifdef DEBUG
         auto time_begin = TimeUtil::get_curr_timeval();
@@ -74,8 +222,44 @@ bool Table::init(std::shared_ptr<ConfigUtil> configs,
         auto delta_time = TimeUtil::timeval_diff_ms(&time_end, &time_begin);
         LOG_DEBUG("index update ok, cost %lu ms", delta_time);
 #endif
+        is_index_dirty = true;
+    }
+    // 加载的索引作为第一个只读段
+    _freeze_memtable(*index_data);
+    TermDict::get_instance().publish();
+    if (!configs->get_value("INDEX_MEMTABLE_SIZE", memtable_size) || memtable_size < 1) {
+        memtable_size = MEMTABLE_SIZE::value;
+        LOG_WARNING("key[INDEX_MEMTABLE_SIZE] not found, set to[%d]", memtable_size);
+    }
+    if (!configs->get_value("INDEX_MAX_SEGMENT_NUM", max_segment_num) || max_segment_num < 1) {
+        max_segment_num = MAX_SEGMENT_NUM::value;
+        LOG_WARNING("key[INDEX_MAX_SEGMENT_NUM] not found, set to[%d]", max_segment_num);
+    }
+    if (!merge_thread.joinable()) {
+        merge_thread = std::thread(&Table::_merge_loop, this);
     }
     configs->get_value("MAX_SYN_TERM_RECALL", max_syn_term_recall);
+    int wand_option = 0;
+    configs->get_value("WAND_RECALL", wand_option);
+    is_wand_recall = (1 == wand_option);
+    // 挖掘 PAIR_QUERY_LOG 时按召回时的口径取 term: 去掉停用词及空白
+    PairCache::Tokenizer tokenizer = nullptr;
+    if (nullptr != wordseg) {
+        tokenizer = [this, wordseg](const std::string &query, std::vector<std::size_t> &signs) {
+            std::vector<TermNode> tokens;
+            if (!wordseg->get_token(query, tokens)) {
+                return;
+            }
+            TermDict::get_instance().resolve_terms(tokens);
+            for (const auto &term : tokens) {
+                if (!hit_stopword(term.term_id) && !term.is_space) {
+                    signs.push_back(term.token_sign);
+                }
+            }
+        };
+    }
+    EXPECT_TRUE_OR_RETURN_LOGGED(pair_cache->init(configs, tokenizer), false,
+            "init pair cache failed");
     return true;
 }
 
@@ -91,27 +275,49 @@ inline void Table::set_index_path(const std::string &str) {
     strncpy(index_file_path, str.c_str(), MAX_FILE_PATH_LEN::value);
 }
 
+void Table::set_max_recall_num(int num) {
+    max_recall_num = num;
+}
+
+bool Table::is_own_doc(const std::size_t &doc_sign) const {
+    return static_cast<int>(doc_sign % partition_num) == partition_id;
+}
+
+inline std::shared_ptr<const IndexData> Table::_get_index() const {
+    return std::atomic_load(&index_data);
+}
+
+std::shared_ptr<const IndexData> Table::get_index() const {
+    return _get_index();
+}
+
 inline std::size_t Table::get_fwd_size() const {
-    return forward_table.size();
+    return _get_index()->doc_cnt;
 }
 
 inline std::size_t Table::get_inv_size() const {
-    return invert_table.size();
+    // 各段倒排的 term 数之和, 同一 term 在多个段中时重复计数
+    std::size_t term_cnt = 0;
+    for (const auto &segment : _get_index()->segments) {
+        term_cnt += segment->invert_table.size();
+    }
+    return term_cnt;
 }
 
 inline std::shared_ptr<DocInfo> Table::get_doc_info(const std::size_t &doc_sign) const {
-    auto iter = forward_table.find(doc_sign);
-    return iter != forward_table.end() ? iter->second : nullptr;
+    return _get_index()->get_doc_info(doc_sign);
+}
+
+inline std::shared_ptr<DocInfo> Table::get_doc_info_by_id(uint32_t doc_id) const {
+    return _get_index()->get_doc_info_by_id(doc_id);
 }
 
 inline std::shared_ptr<InvTermInfo> Table::get_term_info(const std::size_t &term_sign) const {
-    auto iter = invert_table.find(term_sign);
-    return iter != invert_table.end() ? iter->second : nullptr;
+    return _get_index()->get_term_info(term_sign);
 }
 
 inline float Table::get_term_idf(const std::size_t &term_sign) const {
-    auto term_info = get_term_info(term_sign);
-    return nullptr != term_info ? term_info->idf : 0.0;
+    return _get_index()->get_term_idf(term_sign);
 }
 
 inline std::string Table::get_term_txt(const std::size_t &term_sign) const {
@@ -131,17 +337,23 @@ bool Table::_load_stopword(const std::string &file) {
         return false;
     }
     std::string line;
+    std::size_t item_cnt = 0;
     while (!ifs.eof()) {
         std::getline(ifs, line);
         line = StrUtil::right_trim_with(line, '\n');
-        stopword.insert(StrUtil::str_to_sign(line));
+        auto term_id = TermDict::get_instance().add_term(StrUtil::str_to_sign(line));
+        if (term_id >= stopword.size()) {
+            stopword.resize(term_id + 1, false);
+        }
+        item_cnt += stopword[term_id] ? 0 : 1;
+        stopword[term_id] = true;
     }
-    LOG_INFO("load %lu items from %s", stopword.size(), file.c_str());
+    LOG_INFO("load %lu items from %s", item_cnt, file.c_str());
     return true;
 }
 
-inline bool Table::hit_stopword(const std::size_t &term_sign) const {
-    return stopword.find(term_sign) != stopword.end();
+inline bool Table::hit_stopword(uint32_t term_id) const {
+    return term_id < stopword.size() && stopword[term_id];
 }
 
 bool Table::load_index_from_file(std::shared_ptr<Segment> wordseg) {
@@ -152,332 +364,1478 @@ bool Table::load_index_from_file(std::shared_ptr<Segment> wordseg) {
     std::ifstream ifs(index_file_path, std::ios::in);
     EXPECT_TRUE_OR_RETURN_LOGGED(ifs.is_open(), false, "open file error");
 
+    // 1. 读入全部数据
+    std::vector<std::string> lines;
     std::string line;
-    std::vector<std::string> vec;
-    while (!ifs.eof()) {
-        std::getline(ifs, line);
-        StrUtil::split(line, '\t', vec);
-        if (vec.size() < 3) {
-            continue;
+    while (std::getline(ifs, line)) {
+        lines.push_back(std::move(line));
+    }
+    ifs.close();
+    if (lines.empty()) {
+        LOG_WARNING("index file[%s] is empty", index_file_path);
+        return true;
+    }
+
+    // 2. 按行分段并行切词, 每段的结果单独保存, 以保持原始顺序
+    std::size_t task_num = std::min<std::size_t>(max_parallel_tasks, lines.size());
+    std::vector<std::vector<std::shared_ptr<DocInfo>>> chunk_docs(task_num);
+    _run_parallel(task_num, [&](std::size_t task_idx) {
+        auto begin = lines.size() * task_idx / task_num;
+        auto end = lines.size() * (task_idx + 1) / task_num;
+        std::vector<std::string> vec;
+        for (auto i = begin; i < end; ++i) {
+            StrUtil::split(lines[i], '\t', vec);
+            if (vec.size() < 3) {
+                continue;
+            }
+            // query \t title \t url \t label
+            if (!is_own_doc(StrUtil::str_to_sign(vec[2]))) {
+                continue; // 属于其他分片进程
+            }
+            auto doc_info = make_doc_info(wordseg, vec[1], vec[2]);
+            if (nullptr != doc_info) {
+                chunk_docs[task_idx].push_back(doc_info);
+            }
         }
-        // query \t title \t url \t label
-        auto &title = vec[1];
-        auto &url = vec[2];
-        std::vector<TermNode> tokens;
-        if (!(wordseg->get_token(title, tokens))) {
-            LOG_WARNING("segment title[%s] failed", title.c_str());
-            continue;
+    });
+
+    // 3. 按原始顺序分配 doc_id 并写入正排; 重复的 url 与 add_index 一样以最后一次出现的为准,
+    //    占用第一次出现的 doc_id, 旧 title 不进入倒排
+    //    建库时索引尚未发布, 直接写入当前快照的 memtable, 建完后冻结
+    std::unordered_map<std::size_t, std::shared_ptr<DocInfo>> last_docs;
+    for (const auto &docs : chunk_docs) {
+        for (const auto &doc_info : docs) {
+            last_docs[doc_info->doc_sign] = doc_info;
         }
-        auto doc_sign = StrUtil::str_to_sign(url); /////
-        std::shared_ptr<DocInfo> doc_info(
-                new DocInfo(doc_sign, title, url, tokens));
-        wordseg->update_global_info(tokens, doc_info->term_map);
-        if (!add_index(doc_info)) {
-            LOG_WARNING("index build error, query[%s] title[%s]",
-                    vec[0].c_str(), title.c_str());
+    }
+    auto &segment = *index_data->segments.back();
+    for (auto &docs : chunk_docs) {
+        std::vector<std::shared_ptr<DocInfo>> new_docs;
+        for (const auto &doc_info : docs) {
+            auto &last_doc = last_docs[doc_info->doc_sign];
+            if (nullptr == last_doc) {
+                continue; // 已在第一次出现的位置写入
+            }
+            last_doc->doc_id = segment.end_doc();
+            segment.doc_list.push_back(nullptr);
+            _add_to_fwd_table(segment, last_doc);
+            new_docs.push_back(last_doc);
+            last_doc = nullptr;
         }
+        docs.swap(new_docs);
     }
-    ifs.close();
+
+    // 4. 每个线程为自己那段 doc 建局部倒排, 再按段的顺序合并, 保证拉链中 doc_id 升序
+    std::vector<InvTable> partial_tables(task_num);
+    _run_parallel(task_num, [&](std::size_t task_idx) {
+        for (const auto &doc_info : chunk_docs[task_idx]) {
+            _add_to_inv_table(doc_info, partial_tables[task_idx]);
+        }
+    });
+    for (auto &partial_table : partial_tables) {
+        _merge_inv_table(segment, partial_table);
+    }
+    is_index_dirty = true;
+
     calc_avg_doc_len();
     auto time_end = TimeUtil::get_curr_timeval();
     auto delta_time = TimeUtil::timeval_diff_ms(&time_end, &time_begin);
-    LOG_INFO("initialize index from %s ok, fwd=%lu inv=%lu cost=%lu ms",
-            index_file_path, get_fwd_size(), get_inv_size(), delta_time);
+    LOG_INFO("initialize index from %s ok, fwd=%lu inv=%lu posting=%lu bytes "
+            "threads=%lu cost=%lu ms",
+            index_file_path, get_fwd_size(), get_inv_size(), get_posting_memory(),
+            task_num, delta_time);
     return true;
 }
 
-inline bool Table::load_index_from_json() {
-    return _load_fwd_table() && _load_inv_table();
+bool Table::load_index_from_bin() {
+    auto time_begin = TimeUtil::get_curr_timeval();
+    IndexFileHeader fwd_header;
+    IndexFileHeader inv_header;
+    EXPECT_TRUE_OR_RETURN(_load_fwd_table(fwd_header), false);
+    EXPECT_TRUE_OR_RETURN(_load_inv_table(inv_header), false);
+    if (fwd_header.doc_cnt != inv_header.doc_cnt) {
+        LOG_WARNING("fwd/inv index not match, fwd_doc=%lu inv_doc=%lu",
+                fwd_header.doc_cnt, inv_header.doc_cnt);
+        return false;
+    }
+    // 原始数据文件有更新时, 需要重新建库
+    uint64_t src_size = 0;
+    uint64_t src_mtime = 0;
+    if (IndexIO::get_src_stat(index_file_path, src_size, src_mtime)
+            && (src_size != fwd_header.src_size || src_mtime != fwd_header.src_mtime)) {
+        LOG_WARNING("binary index is older than %s", index_file_path);
+        return false;
+    }
+    calc_avg_doc_len();
+    auto time_end = TimeUtil::get_curr_timeval();
+    auto delta_time = TimeUtil::timeval_diff_ms(&time_end, &time_begin);
+    LOG_INFO("load binary index from %s,%s ok, fwd=%lu inv=%lu posting=%lu bytes cost=%lu ms",
+            forward_file_path, invert_file_path,
+            get_fwd_size(), get_inv_size(), get_posting_memory(), delta_time);
+    return true;
 }
 
-inline bool Table::dump_index() const {
-    return _dump_fwd_table() && _dump_inv_table();
+bool Table::dump_index() const {
+    if (!is_index_dirty) {
+        LOG_INFO("index not changed since loaded, skip dump");
+        return true;
+    }
+    auto index = _get_index();
+    // 落盘格式只有一个段: 只有一个非空段且没有已删除的 doc 时直接 dump, 否则先合并所有段
+    std::shared_ptr<IndexSegment> segment = nullptr;
+    std::size_t non_empty_cnt = 0;
+    for (const auto &item : index->segments) {
+        if (!item->doc_list.empty()) {
+            segment = item;
+            ++non_empty_cnt;
+        }
+    }
+    if (non_empty_cnt > 1 || !index->deleted_docs->empty()) {
+        segment = _merge_segments(*index, 0, index->segments.size() - 1);
+    } else if (nullptr == segment) {
+        segment = index->segments.front();
+    }
+    return _dump_fwd_table(*segment) && _dump_inv_table(*segment);
 }
 
-inline bool Table::add_index(std::shared_ptr<DocInfo> doc_info) {
-    EXPECT_NE_OR_RETURN(nullptr, doc_info, false);
-    return _add_to_inv_table(doc_info) && _add_to_fwd_table(doc_info);
+std::shared_ptr<DocInfo> Table::make_doc_info(
+        std::shared_ptr<Segment> wordseg,
+        const std::string &title,
+        const std::string &url) {
+    EXPECT_NE_OR_RETURN(nullptr, wordseg, nullptr);
+    std::vector<TermNode> tokens;
+    if (!(wordseg->get_token(title, tokens)) || tokens.empty()) {
+        LOG_WARNING("segment title[%s] failed", title.c_str());
+        return nullptr;
+    }
+    TermDict::get_instance().add_terms(tokens);
+    auto doc_sign = StrUtil::str_to_sign(url); /////
+    std::shared_ptr<DocInfo> doc_info(
+            new DocInfo(doc_sign, title, url, tokens));
+    Segment::update_global_info(tokens, doc_info->term_map);
+    return doc_info;
 }
 
-bool Table::_load_fwd_table() {
-    // TODO: load forward table from json str
+bool Table::add_index(std::shared_ptr<DocInfo> doc_info) {
+    return add_index(std::vector<std::shared_ptr<DocInfo>>(1, doc_info));
+}
+
+bool Table::add_index(const std::vector<std::shared_ptr<DocInfo>> &docs) {
+    EXPECT_FALSE_OR_RETURN(docs.empty(), true);
+    auto time_begin = TimeUtil::get_curr_timeval();
+    std::lock_guard<std::mutex> lock(update_mutex);
+    // 复制当前快照, 只读段只复制指针; memtable 复制一份, 涉及的 InvTermInfo 修改前再单独复制
+    auto index = std::make_shared<IndexData>(*_get_index());
+    index->segments.back() = std::make_shared<IndexSegment>(*index->segments.back());
+    auto &memtable = *index->segments.back();
+    std::unordered_set<std::size_t> detached;
+    std::shared_ptr<std::unordered_set<uint32_t>> deleted = nullptr;
+    std::vector<std::shared_ptr<DocInfo>> own_docs;
+    for (const auto &doc_info : docs) {
+        EXPECT_NE_OR_RETURN(nullptr, doc_info, false);
+        EXPECT_FALSE_OR_RETURN(doc_info->terms.empty(), false);
+        if (!is_own_doc(doc_info->doc_sign)) {
+            continue; // 属于其他分片进程
+        }
+        own_docs.push_back(doc_info);
+        // 同一 url 重复加入时先删除旧 doc; 新 doc 总是追加到 memtable 末尾, 拉链保持有序
+        auto old_doc = index->get_doc_info(doc_info->doc_sign);
+        if (nullptr != old_doc) {
+            _remove_doc(*index, old_doc, detached, deleted);
+        }
+        doc_info->doc_id = memtable.end_doc();
+        memtable.doc_list.push_back(nullptr);
+        _detach_term_info(memtable, doc_info, detached);
+        EXPECT_TRUE_OR_RETURN(_add_to_inv_table(doc_info, memtable.invert_table), false);
+        EXPECT_TRUE_OR_RETURN(_add_to_fwd_table(memtable, doc_info), false);
+        index->doc_cnt += 1;
+        index->sum_doc_len += doc_info->title_len;
+    }
+    EXPECT_FALSE_OR_RETURN(own_docs.empty(), true);
+    index->generation += 1;
+    // idf 查询时由各段的统计量计算, 这里只计算新 doc 的 term wei
+    for (const auto &doc_info : own_docs) {
+        _calc_doc_wei(*index, doc_info);
+    }
+    index->avg_doc_len = static_cast<float>(index->sum_doc_len) / index->doc_cnt;
+    if (memtable.doc_list.size() >= static_cast<std::size_t>(memtable_size)) {
+        _freeze_memtable(*index);
+    }
+    // 新 doc 的 term 先进入字典快照, 查询取到新索引时不必加锁查找 term_id
+    TermDict::get_instance().publish();
+    std::atomic_store(&index_data, index);
+    is_index_dirty = true;
+    {
+        std::lock_guard<std::mutex> merge_lock(merge_mutex);
+        merge_cond.notify_one();
+    }
+    auto time_end = TimeUtil::get_curr_timeval();
+    auto delta_time = TimeUtil::timeval_diff_ms(&time_end, &time_begin);
+    LOG_INFO("add %lu docs into index, fwd=%lu segments=%lu cost=%lu ms",
+            own_docs.size(), index->doc_cnt, index->segments.size(), delta_time);
     return true;
 }
 
-bool Table::_load_inv_table() {
-    // TODO: load inverted table from json str
+bool Table::delete_index(const std::size_t &doc_sign) {
+    std::lock_guard<std::mutex> lock(update_mutex);
+    auto old_doc = _get_index()->get_doc_info(doc_sign);
+    if (CHECK_NULL(old_doc)) {
+        LOG_WARNING("doc[%lu] not in index", doc_sign);
+        return false;
+    }
+    auto index = std::make_shared<IndexData>(*_get_index());
+    if (old_doc->doc_id >= index->segments.back()->base_doc) {
+        index->segments.back() = std::make_shared<IndexSegment>(*index->segments.back());
+    }
+    std::unordered_set<std::size_t> detached;
+    std::shared_ptr<std::unordered_set<uint32_t>> deleted = nullptr;
+    EXPECT_TRUE_OR_RETURN(_remove_doc(*index, old_doc, detached, deleted), false);
+    index->avg_doc_len = index->doc_cnt > 0 ? \
+                         static_cast<float>(index->sum_doc_len) / index->doc_cnt : 0.0;
+    index->generation += 1;
+    std::atomic_store(&index_data, index);
+    is_index_dirty = true;
+    {
+        std::lock_guard<std::mutex> merge_lock(merge_mutex);
+        merge_cond.notify_one();
+    }
+    LOG_INFO("delete doc[%s] from index, fwd=%lu deleted=%lu",
+            old_doc->url.c_str(), index->doc_cnt, index->deleted_docs->size());
     return true;
 }
 
-bool Table::_dump_fwd_table() const {
-    // TODO: dump forward table into json str
-#ifdef DEBUG
-    std::ofstream ofs(forward_file_path, std::ofstream::out);
-    EXPECT_TRUE_OR_RETURN(ofs.is_open(), false);
-    for (auto it = forward_table.begin(); it != forward_table.end(); ++it) {
-        auto doc_info = it->second;
-        ofs << doc_info->doc_sign \
-            << '\t' << doc_info->title \
-            << '\n';
-    }
-    ofs.close();
-    EXPECT_TRUE_OR_RETURN_LOGGED(
-            FileUtil::generate_md5_file(forward_file_path),
-            false, "generate md5 file failed");
-#endif
+bool Table::_remove_doc(IndexData &index,
+        std::shared_ptr<DocInfo> doc_info,
+        std::unordered_set<std::size_t> &detached,
+        std::shared_ptr<std::unordered_set<uint32_t>> &deleted) {
+    auto &memtable = *index.segments.back();
+    if (doc_info->doc_id >= memtable.base_doc) {
+        EXPECT_TRUE_OR_RETURN(_remove_from_index(memtable, doc_info, detached), false);
+    } else {
+        // 只读段不修改, 拉链中残留的 doc_id 在召回时跳过, 合并时清除
+        if (nullptr == deleted) {
+            deleted = std::make_shared<std::unordered_set<uint32_t>>(*index.deleted_docs);
+        }
+        deleted->insert(doc_info->doc_id);
+        index.deleted_docs = deleted;
+    }
+    index.doc_cnt -= std::min<std::size_t>(index.doc_cnt, 1);
+    index.sum_doc_len -= std::min<uint64_t>(index.sum_doc_len, doc_info->title_len);
     return true;
 }
 
-bool Table::_dump_inv_table() const {
-    // TODO: dump inverted table into json str
-#ifdef DEBUG
-    std::ofstream ofs(invert_file_path, std::ofstream::out);
-    EXPECT_TRUE_OR_RETURN(ofs.is_open(), false);
-    for (auto it = invert_table.begin(); it != invert_table.end(); ++it) {
-        auto term_info = it->second;
-        ofs << term_info->term_txt \
-            << '\t' << term_info->idf \
-            << '\t' << term_info->docs.size() \
-            << '\n';
-    }
-    ofs.close();
-    EXPECT_TRUE_OR_RETURN_LOGGED(
-            FileUtil::generate_md5_file(invert_file_path),
-            false, "generate md5 file failed");
+void Table::_detach_term_info(IndexSegment &segment,
+        std::shared_ptr<DocInfo> doc_info,
+        std::unordered_set<std::size_t> &detached) {
+    for (const auto &term : doc_info->terms) {
+        if (hit_stopword(term.term_id) || !detached.insert(term.token_sign).second) {
+            continue;
+        }
+        auto iter = segment.invert_table.find(term.token_sign);
+        if (iter != segment.invert_table.end()) {
+            iter->second = std::make_shared<InvTermInfo>(*iter->second);
+        }
+    }
+}
 
-#endif
+bool Table::_remove_from_index(IndexSegment &segment,
+        std::shared_ptr<DocInfo> doc_info,
+        std::unordered_set<std::size_t> &detached) {
+    _detach_term_info(segment, doc_info, detached);
+    auto doc_id = doc_info->doc_id;
+    // 与 _add_to_inv_table 对应: 从后往前, 每个 term 只处理一次
+    std::unordered_set<std::size_t> visited;
+    for (auto it = doc_info->terms.crbegin(); it != doc_info->terms.crend(); ++it) {
+        if (hit_stopword(it->term_id) || !visited.insert(it->token_sign).second) {
+            continue;
+        }
+        auto iter = segment.invert_table.find(it->token_sign);
+        if (iter == segment.invert_table.end()) {
+            continue;
+        }
+        auto &term_info = iter->second;
+        auto rank = term_info->docs.rank(doc_id);
+        if (!term_info->docs.remove(doc_id)) {
+            continue;
+        }
+        if (rank < term_info->positions.size()) {
+            term_info->positions.remove(rank);
+        }
+        // max_tf 不回退, 仍是有效的得分上界
+        term_info->term_freq -= std::min(term_info->term_freq, it->dup);
+        if (term_info->docs.empty()) {
+            segment.invert_table.erase(iter);
+        }
+    }
+    segment.forward_table.erase(doc_info->doc_sign);
+    if (doc_id >= segment.base_doc && doc_id < segment.end_doc()) {
+        segment.doc_list[doc_id - segment.base_doc] = nullptr;
+    }
     return true;
 }
 
-bool Table::_add_to_fwd_table(std::shared_ptr<DocInfo> doc_info, bool update_wei) {
-    EXPECT_NE_OR_RETURN(nullptr, doc_info, false);
-    if (update_wei) {
-        for (auto &term : doc_info->terms) {
-            if (hit_stopword(term.token_sign)) {
-                continue;
-            }
-            auto idf = get_term_idf(term.token_sign);
-            auto tf = term.dup;
-            term.wei = idf * sqrt(tf) / sqrt(doc_info->terms.size());
+void Table::_freeze_memtable(IndexData &index) {
+    index.segments.push_back(std::make_shared<IndexSegment>(index.end_doc()));
+}
+
+void Table::_clear_index() {
+    std::atomic_store(&index_data, std::make_shared<IndexData>());
+}
+
+/*
+ * 正排 body: 按 doc_id 升序排列, 已删除的 doc_id 不落盘, header.doc_cnt 为 doc_id 的范围
+ *  u32 doc_id | u64 doc_sign | str title | str url | u32 title_len | f32 vec_module | f32 wei_sum |
+ *  u32 term_cnt | term_cnt * (u64 sign | str token | u16 offset | u16 length | u16 dup | f32 wei)
+ * 其中 str 为 u32 长度 + 明文; term_map 由 terms 重新计算, title_chars 由 title 解码, 均不落盘
+ */
+bool Table::_load_fwd_table(IndexFileHeader &header) {
+    MmapFile file;
+    EXPECT_TRUE_OR_RETURN(file.open(forward_file_path), false);
+    BinaryReader reader(file.data(), file.size());
+    EXPECT_TRUE_OR_RETURN(reader.read_pod(header), false);
+    EXPECT_TRUE_OR_RETURN(
+            IndexIO::check_header(header, FWD_INDEX_FILE, file.size()), false);
+
+    auto &segment = *index_data->segments.back();
+    segment.forward_table.reserve(header.item_cnt);
+    segment.doc_list.resize(header.doc_cnt);
+    auto &term_dict = TermDict::get_instance();
+    std::string token; // term 明文只用于判断空白, 不保存
+    for (uint64_t i = 0; i < header.item_cnt; ++i) {
+        auto doc_info = std::make_shared<DocInfo>();
+        uint32_t term_cnt = 0;
+        reader.read_pod(doc_info->doc_id);
+        reader.read_pod(doc_info->doc_sign);
+        reader.read_str(doc_info->title);
+        reader.read_str(doc_info->url);
+        reader.read_pod(doc_info->title_len);
+        reader.read_pod(doc_info->vec_module);
+        reader.read_pod(doc_info->wei_sum);
+        reader.read_pod(term_cnt);
+        EXPECT_TRUE_OR_RETURN_LOGGED(reader.ok(), false, "forward index corrupted");
+        StrUtil::utf8_to_unicode(doc_info->title, doc_info->title_chars);
+        doc_info->terms.reserve(term_cnt);
+        for (uint32_t j = 0; j < term_cnt; ++j) {
+            TermNode term(0);
+            reader.read_pod(term.token_sign);
+            reader.read_str(token);
+            reader.read_pod(term.offset);
+            reader.read_pod(term.length);
+            reader.read_pod(term.dup);
+            reader.read_pod(term.wei);
+            term.is_space = StrUtil::is_space_str(token);
+            term.term_id = term_dict.add_term(term.token_sign);
+            doc_info->terms.push_back(term);
+        }
+        EXPECT_TRUE_OR_RETURN_LOGGED(reader.ok(), false, "forward index corrupted");
+        if (!doc_info->terms.empty()) {
+            // 与 load_index_from_file 保持一致: term_map 由切词结果的副本计算
+            auto tokens = doc_info->terms;
+            Segment::update_global_info(tokens, doc_info->term_map);
+        }
+        if (doc_info->doc_id >= segment.doc_list.size()
+                || nullptr != segment.doc_list[doc_info->doc_id]) {
+            LOG_WARNING("doc_id[%u] out of range or duplicated", doc_info->doc_id);
+            return false;
+        }
+        segment.forward_table[doc_info->doc_sign] = doc_info;
+        segment.doc_list[doc_info->doc_id] = doc_info;
+    }
+    return true;
+}
+
+/*
+ * 倒排 body: 按 term 排列
+ *  u64 term_sign | str term_txt | u16 term_len | u16 term_freq | u16 max_tf | f32 idf |
+ *  PostingList | PositionList
+ *  格式见 PostingList::dump 及 PositionList::dump, 未建位置索引时 PositionList 为空
+ */
+bool Table::_load_inv_table(IndexFileHeader &header) {
+    MmapFile file;
+    EXPECT_TRUE_OR_RETURN(file.open(invert_file_path), false);
+    BinaryReader reader(file.data(), file.size());
+    EXPECT_TRUE_OR_RETURN(reader.read_pod(header), false);
+    EXPECT_TRUE_OR_RETURN(
+            IndexIO::check_header(header, INV_INDEX_FILE, file.size()), false);
+
+    auto &invert_table = index_data->segments.back()->invert_table;
+    invert_table.reserve(header.item_cnt);
+    for (uint64_t i = 0; i < header.item_cnt; ++i) {
+        auto term_info = std::make_shared<InvTermInfo>();
+        reader.read_pod(term_info->term_sign);
+        reader.read_str(term_info->term_txt);
+        reader.read_pod(term_info->term_len);
+        reader.read_pod(term_info->term_freq);
+        reader.read_pod(term_info->max_tf);
+        reader.read_pod(term_info->idf);
+        term_info->term_id = TermDict::get_instance().add_term(term_info->term_sign);
+        EXPECT_TRUE_OR_RETURN_LOGGED(term_info->docs.load(reader) && reader.ok(),
+                false, "inverted index corrupted");
+        EXPECT_TRUE_OR_RETURN_LOGGED(term_info->positions.load(reader),
+                false, "inverted index corrupted");
+        if (!build_position_index) {
+            term_info->positions = PositionList();
+        } else if (term_info->positions.size() != term_info->docs.size()) {
+            LOG_WARNING("term[%s] has no position index", term_info->term_txt.c_str());
+            return false;
+        }
+        if (!term_info->docs.empty() && term_info->docs.back() >= header.doc_cnt) {
+            LOG_WARNING("term[%s] doc_id out of range", term_info->term_txt.c_str());
+            return false;
+        }
+        invert_table[term_info->term_sign] = term_info;
+    }
+    return true;
+}
+
+bool Table::_dump_fwd_table(const IndexSegment &segment) const {
+    BinaryWriter writer(forward_file_path);
+    EXPECT_TRUE_OR_RETURN_LOGGED(writer.is_open(), false, "open forward index file failed");
+    for (const auto &doc_info : segment.doc_list) {
+        if (nullptr == doc_info) {
+            continue;
+        }
+        writer.write_pod(doc_info->doc_id);
+        writer.write_pod(doc_info->doc_sign);
+        writer.write_str(doc_info->title);
+        writer.write_str(doc_info->url);
+        writer.write_pod(doc_info->title_len);
+        writer.write_pod(doc_info->vec_module);
+        writer.write_pod(doc_info->wei_sum);
+        writer.write_pod(static_cast<uint32_t>(doc_info->terms.size()));
+        for (const auto &term : doc_info->terms) {
+            writer.write_pod(term.token_sign);
+            writer.write_str(StrUtil::unicode_to_utf8(doc_info->title_chars,
+                    term.offset, term.length));
+            writer.write_pod(term.offset);
+            writer.write_pod(term.length);
+            writer.write_pod(term.dup);
+            writer.write_pod(term.wei);
         }
     }
-    forward_table[doc_info->doc_sign] = doc_info;
+    IndexFileHeader header;
+    IndexIO::init_header(FWD_INDEX_FILE, header);
+    header.item_cnt = segment.forward_table.size();
+    header.doc_cnt = segment.end_doc();
+    header.body_size = writer.get_body_size();
+    IndexIO::get_src_stat(index_file_path, header.src_size, header.src_mtime);
+    EXPECT_TRUE_OR_RETURN(writer.write_header(header), false);
+    EXPECT_TRUE_OR_RETURN(writer.commit(), false);
+    LOG_INFO("dump %lu docs into %s", segment.forward_table.size(), forward_file_path);
     return true;
 }
 
-bool Table::_add_to_inv_table(std::shared_ptr<DocInfo> doc_info, bool update_idf) {
+bool Table::_dump_inv_table(const IndexSegment &segment) const {
+    BinaryWriter writer(invert_file_path);
+    EXPECT_TRUE_OR_RETURN_LOGGED(writer.is_open(), false, "open inverted index file failed");
+    for (const auto &item : segment.invert_table) {
+        const auto &term_info = item.second;
+        writer.write_pod(term_info->term_sign);
+        writer.write_str(term_info->term_txt);
+        writer.write_pod(term_info->term_len);
+        writer.write_pod(term_info->term_freq);
+        writer.write_pod(term_info->max_tf);
+        writer.write_pod(term_info->idf);
+        term_info->docs.dump(writer);
+        term_info->positions.dump(writer);
+    }
+    IndexFileHeader header;
+    IndexIO::init_header(INV_INDEX_FILE, header);
+    header.item_cnt = segment.invert_table.size();
+    header.doc_cnt = segment.end_doc();
+    header.body_size = writer.get_body_size();
+    IndexIO::get_src_stat(index_file_path, header.src_size, header.src_mtime);
+    EXPECT_TRUE_OR_RETURN(writer.write_header(header), false);
+    EXPECT_TRUE_OR_RETURN(writer.commit(), false);
+    LOG_INFO("dump %lu terms into %s", segment.invert_table.size(), invert_file_path);
+    return true;
+}
+
+bool Table::_add_to_fwd_table(IndexSegment &segment, std::shared_ptr<DocInfo> doc_info) const {
+    EXPECT_NE_OR_RETURN(nullptr, doc_info, false);
+    segment.forward_table[doc_info->doc_sign] = doc_info;
+    segment.doc_list[doc_info->doc_id - segment.base_doc] = doc_info;
+    return true;
+}
+
+bool Table::_add_to_inv_table(std::shared_ptr<DocInfo> doc_info, InvTable &inv_table) const {
     EXPECT_NE_OR_RETURN(nullptr, doc_info, false);
     EXPECT_FALSE_OR_RETURN(doc_info->terms.empty(), false);
+    std::unordered_map<std::size_t, std::vector<uint16_t>> term_positions;
+    if (build_position_index) {
+        calc_term_positions(doc_info->terms, term_positions);
+    }
     for (auto it = doc_info->terms.crbegin(); it != doc_info->terms.crend(); ++it) {
         auto &term_sign = it->token_sign;
-        if (hit_stopword(term_sign)) {
+        if (hit_stopword(it->term_id)) {
             continue;
         }
         bool need_update = false;
         std::shared_ptr<InvTermInfo> term_info = nullptr;
-        if (invert_table.find(term_sign) != invert_table.end()) {
-            term_info = invert_table[term_sign];
+        if (inv_table.find(term_sign) != inv_table.end()) {
+            term_info = inv_table[term_sign];
         } else {
-            term_info = std::make_shared<InvTermInfo>(it->token_sign, it->token, it->length);
+            term_info = std::make_shared<InvTermInfo>(it->token_sign, it->term_id,
+                    StrUtil::unicode_to_utf8(doc_info->title_chars, it->offset, it->length),
+                    it->length);
             need_update = true;
         }
-        DocNode node(doc_info->doc_sign);
         // 从后往前, 同一个doc只插入一次, 保证doc中term频次为最大值
-        if (term_info->docs.find(node) == term_info->docs.end()) {
-            term_info->docs.insert(std::move(node));
+        // 新 doc 的 doc_id 最大, 直接追加在拉链末尾; 仅重复 url 需要有序插入
+        auto doc_id = doc_info->doc_id;
+        auto gti = doc_info->term_map.find(it->term_id);
+        if (nullptr != gti && gti->term_freq > term_info->max_tf) {
+            term_info->max_tf = gti->term_freq;
+        }
+        if (term_info->docs.add(doc_id)) {
+            if (build_position_index) {
+                auto rank = doc_id == term_info->docs.back() ? \
+                            term_info->docs.size() - 1 : term_info->docs.rank(doc_id);
+                term_info->positions.insert(rank, term_positions[term_sign]);
+            }
             term_info->term_freq += it->dup;
             need_update = true;
         }
         if (need_update) {
-            invert_table[term_sign] = term_info;
+            inv_table[term_sign] = term_info;
         }
-        if (update_idf) {
-            term_info->idf = MathUtil::calculate_idf(term_info->term_freq, get_fwd_size());
+    }
+    return true;
+}
+
+bool Table::_merge_inv_table(IndexSegment &segment, InvTable &partial_table) {
+    auto &invert_table = segment.invert_table;
+    for (auto &item : partial_table) {
+        auto iter = invert_table.find(item.first);
+        if (iter == invert_table.end()) {
+            invert_table.insert(std::make_pair(item.first, std::move(item.second)));
+            continue;
         }
+        auto &term_info = iter->second;
+        const auto &partial_info = item.second;
+        term_info->docs.append(partial_info->docs);
+        term_info->positions.append(partial_info->positions);
+        term_info->term_freq += partial_info->term_freq;
+        term_info->max_tf = std::max(term_info->max_tf, partial_info->max_tf);
     }
+    partial_table.clear();
     return true;
 }
 
+void Table::_run_parallel(std::size_t task_num,
+        const std::function<void(std::size_t)> &task) {
+    if (task_num <= 1) {
+        task(0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < task_num; ++i) {
+        workers.push_back(std::thread(task, i));
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
 bool Table::_update_inv_table() {
-    for (auto inv_iter = invert_table.begin(); inv_iter != invert_table.end(); ++inv_iter) {
-        auto &term_info = inv_iter->second;
-        term_info->idf = MathUtil::calculate_idf(term_info->term_freq, get_fwd_size());
+    auto doc_num = index_data->doc_cnt;
+    for (auto &item : index_data->segments.back()->invert_table) {
+        auto &term_info = item.second;
+        term_info->idf = MathUtil::calculate_idf(term_info->term_freq, doc_num);
     }
     return true;
 }
 
 bool Table::_update_fwd_table() {
-    for (auto &item : forward_table) {
-        auto module_ = 0.0;
-        auto wei_sum = 0.0;
-        for (auto &term : item.second->terms) {
-            if (hit_stopword(term.token_sign)) {
-                continue;
-            }
-            auto idf = get_term_idf(term.token_sign);
-            auto tf = term.dup;
-            term.wei = idf; // * tf;
-            module_ += pow(term.wei, 2.0);
-            wei_sum += term.wei;
-        }
-        item.second->vec_module = sqrt(module_);
-        item.second->wei_sum = wei_sum;
+    for (auto &item : index_data->segments.back()->forward_table) {
+        _calc_doc_wei(*index_data, item.second);
     }
     return true;
 }
 
+void Table::_calc_doc_wei(const IndexData &index, std::shared_ptr<DocInfo> doc_info) const {
+    auto module_ = 0.0;
+    auto wei_sum = 0.0;
+    for (auto &term : doc_info->terms) {
+        if (hit_stopword(term.term_id)) {
+            continue;
+        }
+        auto idf = index.get_term_idf(term.token_sign);
+        term.wei = idf; // * term.dup
+        module_ += pow(term.wei, 2.0);
+        wei_sum += term.wei;
+    }
+    doc_info->vec_module = sqrt(module_);
+    doc_info->wei_sum = wei_sum;
+}
+
 void Table::calc_avg_doc_len() {
-    auto doc_num = get_fwd_size();
-    EXPECT_GT_OR_RETURN(doc_num, 0, RETURN_ON_VOID);
-    uint64_t sum_doc_len = 0;
-    for (const auto &item : forward_table) {
-        sum_doc_len += item.second->title_len;
+    auto &index = *index_data;
+    index.doc_cnt = 0;
+    index.sum_doc_len = 0;
+    for (const auto &segment : index.segments) {
+        for (const auto &item : segment->forward_table) {
+            if (!index.is_deleted(item.second->doc_id)) {
+                ++index.doc_cnt;
+                index.sum_doc_len += item.second->title_len;
+            }
+        }
     }
-    avg_doc_len = static_cast<float>(sum_doc_len) / doc_num;
+    EXPECT_GT_OR_RETURN(index.doc_cnt, 0, RETURN_ON_VOID);
+    index.avg_doc_len = static_cast<float>(index.sum_doc_len) / index.doc_cnt;
 }
 
 inline float Table::get_avg_doc_len() const {
-    return avg_doc_len;
+    return _get_index()->avg_doc_len;
+}
+
+std::size_t Table::get_posting_memory() const {
+    std::size_t mem = 0;
+    for (const auto &segment : _get_index()->segments) {
+        for (const auto &item : segment->invert_table) {
+            mem += item.second->docs.memory_usage() + item.second->positions.memory_usage();
+        }
+    }
+    return mem;
+}
+
+std::string Table::get_pair_cache_stats() const {
+    return pair_cache->stats();
+}
+
+std::shared_ptr<IndexSegment> Table::_merge_segments(const IndexData &index,
+        std::size_t first,
+        std::size_t last) const {
+    auto merged = std::make_shared<IndexSegment>(index.segments[first]->base_doc);
+    merged->doc_list.resize(index.segments[last]->end_doc() - merged->base_doc);
+    // 按 doc_id 升序重建, 拉链直接追加; 已删除 doc 及重复 url 残留的拉链一并清除
+    for (auto i = first; i <= last; ++i) {
+        for (const auto &doc_info : index.segments[i]->doc_list) {
+            if (nullptr == doc_info || index.is_deleted(doc_info->doc_id)) {
+                continue;
+            }
+            _add_to_fwd_table(*merged, doc_info);
+            _add_to_inv_table(doc_info, merged->invert_table);
+        }
+    }
+    for (auto &item : merged->invert_table) {
+        item.second->idf = index.get_term_idf(item.first);
+    }
+    return merged;
+}
+
+bool Table::_pick_merge_segments(const IndexData &index,
+        std::size_t &first,
+        std::size_t &last) const {
+    auto &segments = index.segments;
+    auto frozen_num = segments.size() - 1;
+    if (frozen_num > static_cast<std::size_t>(max_segment_num)) {
+        std::size_t min_doc_cnt = SIZE_MAX;
+        for (std::size_t i = 0; i + 1 < frozen_num; ++i) {
+            auto doc_cnt = segments[i]->forward_table.size() + segments[i + 1]->forward_table.size();
+            if (doc_cnt < min_doc_cnt) {
+                min_doc_cnt = doc_cnt;
+                first = i;
+            }
+        }
+        last = first + 1;
+        return true;
+    }
+    if (index.deleted_docs->empty()) {
+        return false;
+    }
+    std::vector<std::size_t> deleted_cnt(frozen_num, 0);
+    for (auto doc_id : *index.deleted_docs) {
+        auto iter = std::upper_bound(segments.begin(), segments.end(), doc_id,
+                [](uint32_t id, const std::shared_ptr<IndexSegment> &segment) {
+                    return id < segment->base_doc;
+                });
+        auto idx = iter - segments.begin() - 1;
+        if (idx >= 0 && static_cast<std::size_t>(idx) < frozen_num) {
+            ++deleted_cnt[idx];
+        }
+    }
+    for (std::size_t i = 0; i < frozen_num; ++i) {
+        if (deleted_cnt[i] * 100 > segments[i]->forward_table.size() * MAX_DELETED_PERCENT::value) {
+            first = last = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Table::_merge_loop() {
+    std::unique_lock<std::mutex> lock(merge_mutex);
+    while (!is_merge_stopped) {
+        auto index = _get_index();
+        std::size_t first = 0;
+        std::size_t last = 0;
+        if (!_pick_merge_segments(*index, first, last)) {
+            merge_cond.wait(lock);
+            continue;
+        }
+        lock.unlock();
+        auto time_begin = TimeUtil::get_curr_timeval();
+        // 合并不持有写锁, 期间的写操作只修改 memtable 及 deleted_docs
+        auto merged = _merge_segments(*index, first, last);
+        {
+            std::lock_guard<std::mutex> update_lock(update_mutex);
+            // 只读段只会被合并线程替换, 下标不变
+            auto curr = _get_index();
+            auto next = std::make_shared<IndexData>(*curr);
+            next->segments.erase(next->segments.begin() + first + 1,
+                    next->segments.begin() + last + 1);
+            next->segments[first] = merged;
+            // 合并时已清除的 doc 不再记录, 合并期间新删除的 doc 保留
+            if (!index->deleted_docs->empty()) {
+                auto deleted = std::make_shared<std::unordered_set<uint32_t>>();
+                for (auto doc_id : *curr->deleted_docs) {
+                    if (doc_id < merged->base_doc || doc_id >= merged->end_doc()
+                            || 0 == index->deleted_docs->count(doc_id)) {
+                        deleted->insert(doc_id);
+                    }
+                }
+                next->deleted_docs = deleted;
+            }
+            std::atomic_store(&index_data, next);
+        }
+        auto time_end = TimeUtil::get_curr_timeval();
+        auto delta_time = TimeUtil::timeval_diff_ms(&time_end, &time_begin);
+        LOG_INFO("merge segments[%lu, %lu] into %lu docs, segments=%lu cost=%lu ms",
+                first, last, merged->forward_table.size(), _get_index()->segments.size(),
+                delta_time);
+        lock.lock();
+    }
+}
+
+void Table::_stop_merge_thread() {
+    {
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        is_merge_stopped = true;
+    }
+    merge_cond.notify_all();
+    if (merge_thread.joinable()) {
+        merge_thread.join();
+    }
 }
 
 bool Table::recall(std::shared_ptr<QueryInfo> query_info,
         std::vector<std::shared_ptr<ResInfo>> &result) const {
+    // 整个请求使用同一份快照, 期间的在线更新不影响本次召回
+    auto index = _get_index();
+    return recall(*index, query_info, result);
+}
+
+bool Table::recall(const IndexData &index,
+        std::shared_ptr<QueryInfo> query_info,
+        std::vector<std::shared_ptr<ResInfo>> &result,
+        const SearchDeadline* deadline,
+        uint32_t* degrade_flags) const {
     EXPECT_TRUE_OR_DO(result.empty(), result.clear());
-    std::unordered_map<std::size_t, std::shared_ptr<ResInfo>> res_map;
-    for (auto i = 0; i < query_info->terms.size(); ++i) { // each term
-        auto &term = query_info->terms[i]; // TermNode
-        if (term.dup > 1) { // 重复 term 不必召回
+    // 短语/邻近约束先在倒排上求交, 不满足的 doc 不进入后续的特征计算
+    bool has_phrase = !query_info->phrases.empty();
+    std::vector<uint32_t> phrase_docs;
+    for (std::size_t i = 0; i < query_info->phrases.size(); ++i) {
+        std::vector<uint32_t> doc_ids;
+        match_phrase(index, query_info->phrases[i], doc_ids);
+        if (0 == i) {
+            phrase_docs.swap(doc_ids);
             continue;
         }
-        auto term_info = get_term_info(term.token_sign); // InvTermInfo
-        if (CHECK_NULL(term_info)) {
+        std::vector<uint32_t> merged;
+        std::set_intersection(phrase_docs.begin(), phrase_docs.end(),
+                doc_ids.begin(), doc_ids.end(), std::back_inserter(merged));
+        phrase_docs.swap(merged);
+    }
+    LOG_DEBUG("query has %lu phrases, %lu docs matched",
+            query_info->phrases.size(), phrase_docs.size());
+    auto phrase_filter = has_phrase ? &phrase_docs : nullptr;
+    auto pair_docs = pair_cache->is_enabled() ? _get_pair_docs(index, query_info) : nullptr;
+    if (nullptr != pair_docs) {
+        pair_cache->add_seed_stats(pair_docs->size());
+    }
+    // 按 doc_id 区间分片, 各分片共享同一份倒排拉链, 用 advance_to 跳到分片起点
+    auto doc_num = index.end_doc();
+    std::size_t shard_cnt = std::max<std::size_t>(1,
+            std::min<std::size_t>(index_shard_num, doc_num));
+    std::vector<std::vector<std::shared_ptr<ResInfo>>> shard_results(shard_cnt);
+    std::vector<char> shard_syn_skipped(shard_cnt, false); // vector<bool> 不能并发写
+    recall_pool->run(shard_cnt, [&](std::size_t shard_idx) {
+        auto begin_doc = static_cast<uint32_t>(doc_num * shard_idx / shard_cnt);
+        auto end_doc = static_cast<uint32_t>(doc_num * (shard_idx + 1) / shard_cnt);
+        bool is_syn_skipped = false;
+        _recall_shard(index, query_info, phrase_filter, pair_docs.get(), begin_doc, end_doc,
+                deadline, shard_results[shard_idx], is_syn_skipped);
+        shard_syn_skipped[shard_idx] = is_syn_skipped;
+    });
+    for (auto is_syn_skipped : shard_syn_skipped) {
+        if (is_syn_skipped && nullptr != degrade_flags) {
+            *degrade_flags |= DEGRADE_SKIP_SYN_RECALL;
+        }
+    }
+    // 各分片结果已有序, 逐个归并
+    for (auto &shard_result : shard_results) {
+        auto mid = result.size();
+        result.insert(result.end(), shard_result.begin(), shard_result.end());
+        std::inplace_merge(result.begin(), result.begin() + mid, result.end(), _is_res_ahead);
+    }
+    if (max_recall_num > 0 && result.size() > static_cast<std::size_t>(max_recall_num)) {
+        if (is_wand_recall) {
+            // 各分片/各段分别取 top-k, 与不分片时一致: 先取 WAND 得分的全局 top-k, 再按第一轮排序
+            std::sort(result.begin(), result.end(),
+                    [](const std::shared_ptr<ResInfo> &lhs, const std::shared_ptr<ResInfo> &rhs) {
+                        if (lhs->recall_score != rhs->recall_score) {
+                            return lhs->recall_score > rhs->recall_score;
+                        }
+                        return lhs->doc_info->doc_id < rhs->doc_info->doc_id;
+                    });
+            result.resize(max_recall_num);
+            std::stable_sort(result.begin(), result.end(), _is_res_ahead);
+        } else {
+            result.resize(max_recall_num);
+        }
+    }
+    return true;
+}
+
+bool Table::_recall_shard(
+        const IndexData &index,
+        std::shared_ptr<QueryInfo> query_info,
+        const std::vector<uint32_t>* phrase_docs,
+        const std::vector<uint32_t>* seed_docs,
+        uint32_t begin_doc,
+        uint32_t end_doc,
+        const SearchDeadline* deadline,
+        std::vector<std::shared_ptr<ResInfo>> &result,
+        bool &is_syn_skipped) const {
+    std::unordered_map<uint32_t, std::shared_ptr<ResInfo>> res_map;
+    if (is_wand_recall) {
+        _wand_recall(index, query_info, phrase_docs, seed_docs, begin_doc, end_doc, deadline,
+                res_map, is_syn_skipped);
+    }
+    // 同一 term 在各段中各有一条拉链, 段之间 doc_id 不重叠, 依次遍历
+    std::vector<std::shared_ptr<InvTermInfo>> term_infos;
+    for (std::size_t i = 0; i < query_info->terms.size() && !is_wand_recall; ++i) { // each term
+        auto &term = query_info->terms[i]; // TermNode
+        if (term.dup > 1) { // 重复 term 不必召回
             continue;
         }
+        index.get_term_infos(term.token_sign, begin_doc, end_doc, term_infos); // InvTermInfo
         // 处理原词召回情况
-        auto doc_list = term_info->docs;
-        LOG_DEBUG("term[%s] recall %lu docs", term_info->term_txt.c_str(), doc_list.size());
-        for (auto doc : doc_list) {
-            auto iter = res_map.find(doc.doc_sign);
-            if (iter != res_map.end()) { // 当前 doc 在 res_map 中
-                if (iter->second->match_term_map.count(term.token_sign) > 0) {
-                    continue; // 召回结果中已存在该term的信息，不更新
+        for (const auto &term_info : term_infos) {
+            LOG_DEBUG("term[%s] recall %lu docs",
+                    term_info->term_txt.c_str(), term_info->docs.size());
+            auto cursor = term_info->cursor(begin_doc, end_doc);
+            for (; !cursor.is_end(); cursor.next()) {
+                if (!_is_phrase_miss(phrase_docs, cursor.doc_id())) {
+                    _merge_recall_doc(index, query_info, term_info, i, false, cursor.doc_id(),
+                            res_map);
                 }
-                // 否则,更新result里的match_term_info信息
-                auto doc_info = iter->second->doc_info;
-                auto mti = std::make_shared<MatchTermInfo>();
-                fill_match_term_info(term_info, query_info, doc_info, mti);
-                iter->second->match_term_map.insert(std::make_pair(term.token_sign, mti));
-            } else { // 否则，当前结果插入 res_map
-                process_new_doc(query_info, term_info, doc.doc_sign, false, i, res_map);
             }
         }
         //LOG_DEBUG("doc process ok, start process syn recall");
         // 处理同义词召回情况
         auto &syn_term_list = query_info->syns[i];
-        for (auto j = 0; j < syn_term_list.size() && j < max_syn_term_recall; ++j) {
+        auto syn_num = max_syn_term_recall > 0
+                ? std::min<std::size_t>(syn_term_list.size(), max_syn_term_recall) : 0;
+        for (std::size_t j = 0; j < syn_num; ++j) {
             auto &syn_term = syn_term_list[j];
             if (syn_term.token_sign == term.token_sign) {
                 continue; // 同义词与原词完全一致
             }
-            auto syn_term_info = get_term_info(syn_term.token_sign);
-            if (CHECK_NULL(syn_term_info)) {
-                continue;
+            if (_is_syn_recall_at_risk(deadline)) {
+                is_syn_skipped = true;
+                break;
             }
-            auto &syn_doc_list = syn_term_info->docs;
-            LOG_DEBUG("syn_term[%s] recall %lu docs", syn_term.token.c_str(), syn_doc_list.size());
-            for (auto doc : syn_doc_list) {
-                auto iter = res_map.find(doc.doc_sign);
-                if (iter != res_map.end()) {
-                    // 原词命中的同时，同义词也命中了，直接忽略
-                    continue;
+            index.get_term_infos(syn_term.token_sign, begin_doc, end_doc, term_infos);
+            for (const auto &syn_term_info : term_infos) {
+                LOG_DEBUG("syn_term[%s] recall %lu docs",
+                        syn_term.token.c_str(), syn_term_info->docs.size());
+                auto syn_cursor = syn_term_info->cursor(begin_doc, end_doc);
+                for (; !syn_cursor.is_end(); syn_cursor.next()) {
+                    if (!_is_phrase_miss(phrase_docs, syn_cursor.doc_id())) {
+                        _merge_recall_doc(index, query_info, syn_term_info, i, true,
+                                syn_cursor.doc_id(), res_map);
+                    }
                 }
-                // 处理未命中的情况
-                process_new_doc(query_info, syn_term_info, doc.doc_sign, true, i, res_map);
             }
         } // end of syn term recall
     } // end of query term traversal
     for (auto it = res_map.begin(); it != res_map.end(); ++it) {
         it->second->update_res_info();
-        it->second->feature_mgr->add_feature("F_QU_HIT_TERM_CNT", it->second->term_hits);
+        it->second->feature_mgr->add_feature(F_QU_HIT_TERM_CNT, it->second->term_hits);
         result.push_back(it->second);
     }
-    // 1st_sort: sort by term_hits
-    std::sort(result.begin(), result.end(),
-            [&](const std::shared_ptr<ResInfo> &lhs, const std::shared_ptr<ResInfo> &rhs) {
-        if (lhs->term_hits != rhs->term_hits) {
-            return lhs->term_hits > rhs->term_hits;
-        } else if (lhs->recall_by_syn != rhs->recall_by_syn) {
-            return lhs->recall_by_syn < rhs->recall_by_syn;
-        } else {
-            return lhs->doc_info->title_len < rhs->doc_info->title_len;
+    // 1st_sort: sort by term_hits; WAND 召回的各分片 top-k 要按 WAND 得分归并, 这里不截断
+    std::sort(result.begin(), result.end(), _is_res_ahead);
+    if (!is_wand_recall && max_recall_num > 0
+            && result.size() > static_cast<std::size_t>(max_recall_num)) {
+        result.resize(max_recall_num);
+    }
+    return true;
+}
+
+bool Table::_is_syn_recall_at_risk(const SearchDeadline* deadline) {
+    return nullptr != deadline && deadline->is_at_risk(SearchDeadline::SYN_RECALL_RATIO);
+}
+
+bool Table::_is_res_ahead(
+        const std::shared_ptr<ResInfo> &lhs,
+        const std::shared_ptr<ResInfo> &rhs) {
+    if (lhs->term_hits != rhs->term_hits) {
+        return lhs->term_hits > rhs->term_hits;
+    } else if (lhs->recall_by_syn != rhs->recall_by_syn) {
+        return lhs->recall_by_syn < rhs->recall_by_syn;
+    } else {
+        return lhs->doc_info->title_len < rhs->doc_info->title_len;
+    }
+}
+
+bool Table::_merge_recall_doc(
+        const IndexData &index,
+        std::shared_ptr<QueryInfo> query_info,
+        std::shared_ptr<InvTermInfo> term_info,
+        uint16_t term_idx,
+        bool is_syn_recall,
+        uint32_t doc_id,
+        std::unordered_map<uint32_t, std::shared_ptr<ResInfo>> &res_map) const {
+    auto iter = res_map.find(doc_id);
+    if (iter == res_map.end()) { // 当前结果插入 res_map
+        return process_new_doc(index, query_info, term_info, doc_id, term_idx, is_syn_recall,
+                res_map);
+    }
+    if (is_syn_recall) {
+        return true; // 原词命中的同时，同义词也命中了，直接忽略
+    }
+    if (iter->second->match_term_map.count(term_info->term_sign) > 0) {
+        return true; // 召回结果中已存在该term的信息，不更新
+    }
+    // 否则,更新result里的match_term_info信息
+    auto mti = std::make_shared<MatchTermInfo>();
+    fill_match_term_info(term_info, index.get_term_idf(term_info->term_sign), query_info,
+            iter->second->doc_info, mti);
+    iter->second->match_term_map.insert(std::make_pair(term_info->term_sign, mti));
+    return true;
+}
+
+bool Table::_is_phrase_miss(const std::vector<uint32_t>* phrase_docs, uint32_t doc_id) {
+    return nullptr != phrase_docs \
+        && !std::binary_search(phrase_docs->begin(), phrase_docs->end(), doc_id);
+}
+
+Table::WandCursor::WandCursor(
+        std::shared_ptr<InvTermInfo> info,
+        uint16_t idx,
+        bool syn,
+        float wei,
+        uint16_t tf,
+        uint32_t begin_doc,
+        uint32_t end_doc) :
+    term_info(info),
+    cursor(info->cursor(begin_doc, end_doc)),
+    doc_id(cursor.doc_id()),
+    term_idx(idx),
+    is_syn(syn),
+    weight(wei),
+    query_tf(tf),
+    max_score(wei * std::min(tf, info->max_tf)) {}
+
+void Table::WandCursor::next() {
+    doc_id = cursor.next();
+}
+
+void Table::WandCursor::advance_to(uint32_t target) {
+    doc_id = cursor.advance_to(target);
+}
+
+bool Table::_wand_recall(
+        const IndexData &index,
+        std::shared_ptr<QueryInfo> query_info,
+        const std::vector<uint32_t>* phrase_docs,
+        const std::vector<uint32_t>* seed_docs,
+        uint32_t begin_doc,
+        uint32_t end_doc,
+        const SearchDeadline* deadline,
+        std::unordered_map<uint32_t, std::shared_ptr<ResInfo>> &res_map,
+        bool &is_syn_skipped) const {
+    // 每个原词及其同义词在每个段中各一个游标, 顺序与全量召回一致
+    std::vector<WandCursor> cursors;
+    std::vector<std::shared_ptr<InvTermInfo>> term_infos;
+    for (std::size_t i = 0; i < query_info->terms.size(); ++i) {
+        auto &term = query_info->terms[i];
+        if (term.dup > 1) { // 重复 term 不必召回
+            continue;
         }
-    });
+        index.get_term_infos(term.token_sign, begin_doc, end_doc, term_infos);
+        if (term_infos.empty()) {
+            continue;
+        }
+        auto query_tf = query_info->term_map.get(term.token_sign).term_freq;
+        auto idf = index.get_term_idf(term.token_sign);
+        for (const auto &term_info : term_infos) {
+            cursors.push_back(WandCursor(term_info, i, false, idf, query_tf, begin_doc, end_doc));
+        }
+        auto &syn_term_list = query_info->syns[i];
+        auto syn_num = max_syn_term_recall > 0
+                ? std::min<std::size_t>(syn_term_list.size(), max_syn_term_recall) : 0;
+        for (std::size_t j = 0; j < syn_num; ++j) {
+            auto &syn_term = syn_term_list[j];
+            if (syn_term.token_sign == term.token_sign) {
+                continue; // 同义词与原词完全一致
+            }
+            if (_is_syn_recall_at_risk(deadline)) {
+                is_syn_skipped = true;
+                break;
+            }
+            index.get_term_infos(syn_term.token_sign, begin_doc, end_doc, term_infos);
+            auto syn_wei = index.get_term_idf(syn_term.token_sign) * syn_term.belief;
+            for (const auto &syn_term_info : term_infos) {
+                cursors.push_back(WandCursor(syn_term_info, i, true, syn_wei, query_tf,
+                        begin_doc, end_doc));
+            }
+        }
+    }
+    // 小顶堆保存当前 top-k, 堆顶即进入 top-k 的得分阈值;
+    // 得分相同时 doc_id 小的优先, 保证分片召回归并后与不分片时结果一致
+    using ScoreDocPair = std::pair<float, uint32_t>;
+    auto is_better = [](const ScoreDocPair &lhs, const ScoreDocPair &rhs) {
+        return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+    };
+    std::priority_queue<ScoreDocPair, std::vector<ScoreDocPair>,
+            decltype(is_better)> top_docs(is_better);
+    std::size_t top_k = max_recall_num > 0 ? max_recall_num : UINT32_MAX;
+    // 用热门 term 对的交集预填充 top-k: 同时命中两个 term 的 doc 得分通常较高, 阈值尽早抬高;
+    // 预填充的 doc 按真实得分入堆, 遍历到时不再入堆, 召回结果与不预填充时一致
+    std::vector<uint32_t> seeded;
+    if (nullptr != seed_docs && max_recall_num > 0) {
+        auto it = std::lower_bound(seed_docs->begin(), seed_docs->end(), begin_doc);
+        for (; it != seed_docs->end() && *it < end_doc && seeded.size() < top_k; ++it) {
+            auto doc_info = index.get_doc_info_by_id(*it);
+            if (nullptr == doc_info || _is_phrase_miss(phrase_docs, *it)) {
+                continue;
+            }
+            float score = 0.0;
+            for (const auto &cursor : cursors) {
+                if (!cursor.term_info->docs.contains(*it)) {
+                    continue;
+                }
+                auto gti = doc_info->term_map.find(cursor.term_info->term_id);
+                if (nullptr != gti) {
+                    score += cursor.weight * std::min(cursor.query_tf, gti->term_freq);
+                }
+            }
+            top_docs.push(std::make_pair(score, *it));
+            seeded.push_back(*it);
+        }
+    }
+    std::vector<WandCursor*> sorted_cursors;
+    for (auto &cursor : cursors) {
+        sorted_cursors.push_back(&cursor);
+    }
+    std::size_t eval_cnt = 0;
+    while (true) {
+        std::sort(sorted_cursors.begin(), sorted_cursors.end(),
+                [](const WandCursor* lhs, const WandCursor* rhs) {
+                    return lhs->doc_id < rhs->doc_id;
+                });
+        bool is_full = top_docs.size() >= top_k;
+        float threshold = is_full ? top_docs.top().first : -1.0;
+        uint32_t threshold_doc = is_full ? top_docs.top().second : UINT32_MAX;
+        // pivot: 按 doc_id 顺序累加得分上界, 第一个超过阈值的游标;
+        // 得分等于阈值但 doc_id 更小的 doc 也能进入 top-k(只在预填充了 doc_id 较大的 doc 时出现)
+        float upper_bound = 0.0;
+        std::size_t pivot = sorted_cursors.size();
+        for (std::size_t k = 0; k < sorted_cursors.size(); ++k) {
+            if (UINT32_MAX == sorted_cursors[k]->doc_id) {
+                break;
+            }
+            upper_bound += sorted_cursors[k]->max_score;
+            if (upper_bound > threshold
+                    || (upper_bound == threshold && sorted_cursors[k]->doc_id < threshold_doc)) {
+                pivot = k;
+                break;
+            }
+        }
+        if (pivot == sorted_cursors.size()) {
+            break; // 剩下的 doc 都不可能进入 top-k
+        }
+        auto pivot_doc = sorted_cursors[pivot]->doc_id;
+        if (sorted_cursors[0]->doc_id != pivot_doc) {
+            // pivot 之前的 doc 得分上界不超过阈值, 直接跳到 pivot_doc
+            for (std::size_t k = 0; k < pivot; ++k) {
+                sorted_cursors[k]->advance_to(pivot_doc);
+            }
+            continue;
+        }
+        // 所有停在 pivot_doc 的游标计算真实得分: ∑ weight * min(tf_in_query, tf_in_doc)
+        ++eval_cnt;
+        auto doc_info = index.get_doc_info_by_id(pivot_doc);
+        float score = 0.0;
+        for (auto cursor : sorted_cursors) {
+            if (cursor->doc_id != pivot_doc) {
+                break;
+            }
+            if (nullptr != doc_info) {
+                auto gti = doc_info->term_map.find(cursor->term_info->term_id);
+                if (nullptr != gti) {
+                    score += cursor->weight * std::min(cursor->query_tf, gti->term_freq);
+                }
+            }
+            cursor->next();
+        }
+        auto candidate = std::make_pair(score, pivot_doc);
+        if (nullptr != doc_info && (!is_full || is_better(candidate, top_docs.top()))
+                && !_is_phrase_miss(phrase_docs, pivot_doc)
+                && !std::binary_search(seeded.begin(), seeded.end(), pivot_doc)) {
+            top_docs.push(candidate);
+            if (top_docs.size() > top_k) {
+                top_docs.pop();
+            }
+        }
+    }
+    LOG_DEBUG("wand recall: %lu cursors, %lu docs seeded, %lu docs evaluated, %lu docs kept",
+            cursors.size(), seeded.size(), eval_cnt, top_docs.size());
+    // 只为 top-k 构造 ResInfo
+    for (; !top_docs.empty(); top_docs.pop()) {
+        auto doc_id = top_docs.top().second;
+        auto doc_info = index.get_doc_info_by_id(doc_id);
+        for (const auto &cursor : cursors) {
+            if (doc_info->term_map.contains(cursor.term_info->term_id)) {
+                _merge_recall_doc(index, query_info, cursor.term_info, cursor.term_idx,
+                        cursor.is_syn, doc_id, res_map);
+            }
+        }
+        auto iter = res_map.find(doc_id);
+        if (iter != res_map.end()) {
+            iter->second->recall_score = top_docs.top().first;
+        }
+    }
     return true;
 }
 
+std::shared_ptr<const PairCache::DocList> Table::_get_pair_docs(
+        const IndexData &index,
+        std::shared_ptr<QueryInfo> query_info) const {
+    std::vector<std::size_t> term_signs;
+    for (const auto &term : query_info->terms) {
+        if (term.dup > 1 || hit_stopword(term.term_id) || term.is_space) {
+            continue;
+        }
+        term_signs.push_back(term.token_sign);
+    }
+    pair_cache->record(term_signs);
+    // 只有 WAND 召回 top-k 时能利用交集剪枝, 全量召回求并集用不上
+    if (!is_wand_recall || max_recall_num <= 0) {
+        return nullptr;
+    }
+    std::vector<float> idfs;
+    for (auto sign : term_signs) {
+        idfs.push_back(index.get_term_idf(sign));
+    }
+    // idf 之和最大的热门 term 对, 其交集中的 doc 得分通常较高
+    PairCache::TermPair best_pair(0, 0);
+    float best_idf = 0.0;
+    for (std::size_t i = 0; i < term_signs.size(); ++i) {
+        for (std::size_t j = i + 1; j < term_signs.size(); ++j) {
+            auto pair = PairCache::make_pair(term_signs[i], term_signs[j]);
+            if (pair.first != pair.second && idfs[i] + idfs[j] > best_idf
+                    && pair_cache->is_hot(pair)) {
+                best_pair = pair;
+                best_idf = idfs[i] + idfs[j];
+            }
+        }
+    }
+    if (best_idf <= 0.0) {
+        return nullptr;
+    }
+    std::shared_ptr<const PairCache::DocList> docs = nullptr;
+    if (pair_cache->get(best_pair, index.generation, docs)) {
+        return docs;
+    }
+    // 交集不超过较短的拉链, 较短的拉链超过缓存单条上限时不求交
+    std::size_t first_df = 0;
+    std::size_t second_df = 0;
+    for (const auto &segment : index.segments) {
+        auto first = segment->get_term_info(best_pair.first);
+        auto second = segment->get_term_info(best_pair.second);
+        first_df += nullptr != first ? first->docs.size() : 0;
+        second_df += nullptr != second ? second->docs.size() : 0;
+    }
+    if (!pair_cache->is_admissible(std::min(first_df, second_df))) {
+        return nullptr;
+    }
+    auto pair_docs = std::make_shared<PairCache::DocList>();
+    _intersect_pair(index, best_pair, *pair_docs);
+    pair_cache->put(best_pair, index.generation, pair_docs);
+    return pair_docs;
+}
+
+void Table::_intersect_pair(
+        const IndexData &index,
+        const PairCache::TermPair &pair,
+        PairCache::DocList &docs) {
+    EXPECT_TRUE_OR_DO(docs.empty(), docs.clear());
+    // 各段 doc_id 不重叠且递增, 逐段求交后依次拼接即为升序
+    for (const auto &segment : index.segments) {
+        auto first = segment->get_term_info(pair.first);
+        auto second = segment->get_term_info(pair.second);
+        if (nullptr == first || nullptr == second) {
+            continue;
+        }
+        // 较短的拉链驱动, 较长的拉链用 advance_to 跳表跳过
+        bool is_first_shorter = first->docs.size() <= second->docs.size();
+        auto lead = is_first_shorter ? first->cursor() : second->cursor();
+        auto other = is_first_shorter ? second->cursor() : first->cursor();
+        for (; !lead.is_end() && !other.is_end(); lead.next()) {
+            auto doc_id = lead.doc_id();
+            if (other.advance_to(doc_id) == doc_id && !index.is_deleted(doc_id)) {
+                docs.push_back(doc_id);
+            }
+        }
+    }
+}
+
 bool Table::process_new_doc(
+        const IndexData &index,
         std::shared_ptr<QueryInfo> query_info,
         std::shared_ptr<InvTermInfo> term_info,
-        std::size_t doc_sign,
+        uint32_t doc_id,
         uint16_t term_idx_in_q,
         bool is_syn_recall,
-        std::unordered_map<std::size_t, std::shared_ptr<ResInfo>> &res_map) const {
-    //LOG_DEBUG("process_new_doc start, doc_sign=%lu", doc_sign);
+        std::unordered_map<uint32_t, std::shared_ptr<ResInfo>> &res_map) const {
+    //LOG_DEBUG("process_new_doc start, doc_id=%u", doc_id);
+    auto doc_info = index.get_doc_info_by_id(doc_id);
+    // 已删除的 doc(只读段拉链中残留的 doc_id, 合并前仍会遍历到)
+    EXPECT_NE_OR_RETURN(nullptr, doc_info, false);
     auto res_node = std::make_shared<ResInfo>();
-    res_node->doc_sign = doc_sign;
-    res_node->doc_info = get_doc_info(doc_sign);
+    res_node->doc_info = doc_info;
+    res_node->doc_sign = res_node->doc_info->doc_sign;
     res_node->recall_by_syn = is_syn_recall;
     auto mti = std::make_shared<MatchTermInfo>();
     if (is_syn_recall) {
         mti->is_syn_match = true;
         mti->in_query.term_idx = term_idx_in_q;
     }
-    fill_match_term_info(term_info, query_info, res_node->doc_info, mti);
+    fill_match_term_info(term_info, index.get_term_idf(term_info->term_sign), query_info,
+            res_node->doc_info, mti);
     // 以doc侧的term_sign为 key
     res_node->match_term_map.insert(std::make_pair(term_info->term_sign, mti));
-    res_map.insert(std::make_pair(doc_sign, res_node));
+    res_map.insert(std::make_pair(doc_id, res_node));
     //LOG_DEBUG("process_new_doc done");
     return true;
 }
 
-bool Table::fill_match_term_info(
-        std::shared_ptr<InvTermInfo> term_info,
-        std::shared_ptr<QueryInfo> query_info,
-        std::shared_ptr<DocInfo> doc_info,
-        std::shared_ptr<MatchTermInfo> mti) const {
-    //LOG_DEBUG("fill_match_term_info start, term=%s", term_info->term_txt.c_str());
-    // 从倒排中取信息
-    mti->term_sign = term_info->term_sign;
-    mti->term_txt = term_info->term_txt;
-    mti->term_len = term_info->term_len;
-    mti->idf = term_info->idf;
-    mti->is_stopword = hit_stopword(mti->term_sign);
+bool Table::fill_match_term_info(
+        std::shared_ptr<InvTermInfo> term_info,
+        float idf,
+        std::shared_ptr<QueryInfo> query_info,
+        std::shared_ptr<DocInfo> doc_info,
+        std::shared_ptr<MatchTermInfo> mti) const {
+    //LOG_DEBUG("fill_match_term_info start, term=%s", term_info->term_txt.c_str());
+    // 从倒排中取信息
+    mti->term_sign = term_info->term_sign;
+    mti->term_txt = term_info->term_txt;
+    mti->term_len = term_info->term_len;
+    mti->idf = idf;
+    mti->is_stopword = hit_stopword(term_info->term_id);
+
+    // 从 query 中取信息
+    if (mti->is_syn_match) {
+        auto ori_term_sign = query_info->terms[mti->in_query.term_idx].token_sign;
+        // 同义词召回继承原词的特征（位置、频次等）
+        mti->in_query = query_info->term_map.get(ori_term_sign);
+    } else { // 原词命中
+        mti->in_query = query_info->term_map.get(mti->term_sign);
+    }
+
+    // 从 doc 中取信息
+    mti->in_doc = doc_info->term_map.get(term_info->term_id);
+
+    // 其他信息
+    mti->hit_freq = std::min(mti->in_query.term_freq, mti->in_doc.term_freq);
+    //LOG_DEBUG("fill_match_term_info done");
+    return true;
+}
+
+bool Table::match_phrase(
+        const IndexData &index,
+        const PhraseNode &phrase,
+        std::vector<uint32_t> &doc_ids) const {
+    EXPECT_TRUE_OR_DO(doc_ids.empty(), doc_ids.clear());
+    EXPECT_FALSE_OR_RETURN(phrase.term_signs.empty(), false);
+    // 段按 doc_id 升序排列, 各段的结果直接拼接
+    for (const auto &segment : index.segments) {
+        _match_segment_phrase(index, *segment, phrase, doc_ids);
+    }
+    LOG_DEBUG("phrase[%s] window[%u] hit %lu docs",
+            phrase.text.c_str(), phrase.window, doc_ids.size());
+    return true;
+}
+
+bool Table::_match_segment_phrase(
+        const IndexData &index,
+        const IndexSegment &segment,
+        const PhraseNode &phrase,
+        std::vector<uint32_t> &doc_ids) const {
+    auto term_cnt = phrase.term_signs.size();
+    std::vector<std::shared_ptr<InvTermInfo>> term_infos;
+    std::vector<PostingCursor> cursors;
+    cursors.reserve(term_cnt);
+    std::size_t shortest = 0;
+    for (std::size_t i = 0; i < term_cnt; ++i) {
+        auto term_info = segment.get_term_info(phrase.term_signs[i]);
+        if (CHECK_NULL(term_info)) {
+            return true; // 有 term 不在倒排中, 没有 doc 满足
+        }
+        term_infos.push_back(term_info);
+        cursors.push_back(term_info->cursor());
+        if (cursors[i].cost() < cursors[shortest].cost()) {
+            shortest = i;
+        }
+    }
+    // 以最短拉链驱动求交, 其他游标用 advance_to 按跳表向后跳;
+    // 某个游标跳过了当前 doc 时, 驱动游标直接跳到它停下的位置
+    std::vector<std::vector<uint16_t>> positions(term_cnt);
+    auto &lead = cursors[shortest];
+    while (!lead.is_end()) {
+        auto doc_id = lead.doc_id();
+        auto next_doc = doc_id;
+        for (std::size_t i = 0; i < term_cnt && next_doc == doc_id; ++i) {
+            next_doc = cursors[i].advance_to(doc_id);
+        }
+        if (next_doc != doc_id) {
+            lead.advance_to(next_doc);
+            continue;
+        }
+        for (std::size_t i = 0; i < term_cnt; ++i) {
+            _get_term_positions(index, term_infos[i], cursors[i].rank(), doc_id, positions[i]);
+        }
+        if (_is_phrase_hit(phrase, positions)) {
+            doc_ids.push_back(doc_id);
+        }
+        lead.next();
+    }
+    return true;
+}
+
+void Table::calc_term_positions(
+        const std::vector<TermNode> &terms,
+        std::unordered_map<std::size_t, std::vector<uint16_t>> &out) {
+    EXPECT_TRUE_OR_DO(out.empty(), out.clear());
+    uint16_t pos = 0;
+    for (const auto &term : terms) {
+        if (term.is_space) {
+            continue;
+        }
+        out[term.token_sign].push_back(pos++);
+    }
+}
+
+bool Table::_get_term_positions(
+        const IndexData &index,
+        std::shared_ptr<InvTermInfo> term_info,
+        std::size_t rank,
+        uint32_t doc_id,
+        std::vector<uint16_t> &positions) const {
+    if (rank < term_info->positions.size()) {
+        positions.assign(term_info->positions.begin(rank), term_info->positions.end(rank));
+        return true;
+    }
+    // 未建位置索引, 从正排切词中计算
+    positions.clear();
+    auto doc_info = index.get_doc_info_by_id(doc_id);
+    EXPECT_NE_OR_RETURN(nullptr, doc_info, false);
+    std::unordered_map<std::size_t, std::vector<uint16_t>> term_positions;
+    calc_term_positions(doc_info->terms, term_positions);
+    positions.swap(term_positions[term_info->term_sign]);
+    return true;
+}
+
+bool Table::_is_phrase_hit(
+        const PhraseNode &phrase,
+        const std::vector<std::vector<uint16_t>> &positions) {
+    auto term_cnt = phrase.term_signs.size();
+    if (0 == phrase.window) {
+        // 精确短语: 以第一个 term 的每个位置为起点, 其余 term 须出现在对应的相对位置上
+        for (auto start : positions[0]) {
+            bool is_hit = true;
+            for (std::size_t i = 1; i < term_cnt && is_hit; ++i) {
+                is_hit = std::binary_search(positions[i].begin(), positions[i].end(),
+                        start + phrase.term_pos[i]);
+            }
+            if (is_hit) {
+                return true;
+            }
+        }
+        return false;
+    }
+    // 窗口约束: 所有位置按序归并后, 滑动窗口求覆盖全部 term 的最短跨度
+    std::vector<std::pair<uint16_t, std::size_t>> merged; // <pos, term 下标>
+    for (std::size_t i = 0; i < term_cnt; ++i) {
+        for (auto pos : positions[i]) {
+            merged.push_back(std::make_pair(pos, i));
+        }
+    }
+    std::sort(merged.begin(), merged.end());
+    std::vector<int> hit_cnt(term_cnt, 0);
+    std::size_t covered = 0;
+    std::size_t left = 0;
+    for (std::size_t right = 0; right < merged.size(); ++right) {
+        if (0 == hit_cnt[merged[right].second]++) {
+            ++covered;
+        }
+        while (covered == term_cnt) {
+            if (merged[right].first - merged[left].first + 1 <= phrase.window) {
+                return true;
+            }
+            if (0 == --hit_cnt[merged[left].second]) {
+                --covered;
+            }
+            ++left;
+        }
+    }
+    return false;
+}
+
+// -----------------------------------------------------------
 
-    // 从 query 中取信息
-    if (mti->is_syn_match) {
-        auto ori_term_sign = query_info->terms[mti->in_query.term_idx].token_sign;
-        mti->in_query = query_info->term_map[ori_term_sign]; // 同义词召回继承原词的特征（位置、频次等）
-    } else { // 原词命中
-        mti->in_query = query_info->term_map[mti->term_sign];
-    }
+SearchDeadline::SearchDeadline(uint64_t budget) {
+    reset(budget);
+}
 
-    // 从 doc 中取信息
-    mti->in_doc = doc_info->term_map[mti->term_sign];
+void SearchDeadline::reset(uint64_t budget) {
+    budget_us = budget;
+    begin_time = TimeUtil::get_curr_timeval();
+}
 
-    // 其他信息
-    mti->hit_freq = std::min(mti->in_query.term_freq, mti->in_doc.term_freq);
-    //LOG_DEBUG("fill_match_term_info done");
-    return true;
+uint64_t SearchDeadline::elapsed_us() const {
+    auto now = TimeUtil::get_curr_timeval();
+    return TimeUtil::timeval_diff_us(&begin_time, &now);
+}
+
+bool SearchDeadline::is_at_risk(float ratio) const {
+    return budget_us > 0 && elapsed_us() >= budget_us * ratio;
 }
 
 // -----------------------------------------------------------
 
+SearchContext::SearchContext(const std::string &q,
+        std::shared_ptr<const IndexData> idx,
+        int timeout) :
+    query(q),
+    timeout_ms(timeout),
+    degrade_flags(DEGRADE_NONE),
+    index(idx),
+    query_info(std::make_shared<QueryInfo>()) {}
+
+// -----------------------------------------------------------
+
 TinyEngine::TinyEngine(
         const std::string &config,
         std::shared_ptr<Segment> _wordseg) :
+    _feature_calc_mask(~0u),
     wordseg(_wordseg) {
     configs = std::make_shared<ConfigUtil>(config);
-    query_info = std::make_shared<QueryInfo>();
     if (CHECK_NULL(wordseg)) {
         wordseg = std::make_shared<Segment>();
     }
@@ -503,6 +1861,8 @@ bool TinyEngine::init() {
 #endif
     // load conf
     EXPECT_TRUE_OR_RETURN_LOGGED(_load_conf(), false, "load conf error");
+    table->set_max_recall_num(_max_index_recall_num);
+    _plan_features();
     // load dict
 
     LOG_INFO("init search engine finished!");
@@ -511,10 +1871,44 @@ bool TinyEngine::init() {
 
 bool TinyEngine::stop() {
     // TODO
+    if (nullptr != result_cache) {
+        LOG_INFO("result cache: %s", result_cache->stats().c_str());
+    }
+    if (nullptr != query_info_cache) {
+        LOG_INFO("query info cache: %s", query_info_cache->stats().c_str());
+    }
+    if (!wordsyn->get_cache_stats().empty()) {
+        LOG_INFO("synonym cache: %s", wordsyn->get_cache_stats().c_str());
+    }
+    if (!table->get_pair_cache_stats().empty()) {
+        LOG_INFO("pair cache: %s", table->get_pair_cache_stats().c_str());
+    }
     EXPECT_TRUE_OR_RETURN_LOGGED(table->dump_index(), false, "dump index failed");
     return true;
 }
 
+bool TinyEngine::add_docs(const std::vector<StrStrPair> &docs) {
+    EXPECT_NE_OR_RETURN(nullptr, table, false);
+    std::vector<std::shared_ptr<DocInfo>> doc_infos;
+    for (const auto &doc : docs) {
+        auto doc_info = Table::make_doc_info(wordseg, doc.first, doc.second);
+        if (nullptr != doc_info) {
+            doc_infos.push_back(doc_info);
+        }
+    }
+    EXPECT_FALSE_OR_RETURN_LOGGED(doc_infos.empty(), false, "no valid doc to add");
+    return table->add_index(doc_infos);
+}
+
+void TinyEngine::set_config(const std::string &key, const std::string &value) {
+    configs->set_value(key, value);
+}
+
+bool TinyEngine::delete_doc(const std::string &url) {
+    EXPECT_NE_OR_RETURN(nullptr, table, false);
+    return table->delete_index(StrUtil::str_to_sign(url));
+}
+
 bool TinyEngine::_load_conf() {
     if (!configs->get_value("MAX_INDEX_RECALL_NUM", _max_index_recall_num)) {
         _max_index_recall_num = MAX_INDEX_RECALL_NUM::value;
@@ -531,155 +1925,470 @@ bool TinyEngine::_load_conf() {
     int syn_highlight_flag;
     configs->get_value("HIGHLIGHT_SYN_MATCH_TERM", syn_highlight_flag);
     _is_highlight_syn_term = static_cast<bool>(syn_highlight_flag);
+    if (!configs->get_value("SEARCH_TIMEOUT_MS", _search_timeout_ms) || _search_timeout_ms < 0) {
+        _search_timeout_ms = SEARCH_TIMEOUT_MS::value;
+        LOG_WARNING("key[SEARCH_TIMEOUT_MS] not found or invalid, set to [%d]",
+                _search_timeout_ms);
+    }
+    // 缺失时 Table 已告警
+    if (!configs->get_value("MAX_PARALLEL_TASKS", _batch_thread_num) || _batch_thread_num < 1) {
+        _batch_thread_num = BATCH_THREAD_NUM::value;
+    }
+    int cache_size_mb = 0;
+    if (!configs->get_value("RESULT_CACHE_SIZE_MB", cache_size_mb) || cache_size_mb < 0) {
+        cache_size_mb = RESULT_CACHE_SIZE_MB::value;
+        LOG_WARNING("key[RESULT_CACHE_SIZE_MB] not found or invalid, set to [%d]", cache_size_mb);
+    }
+    if (cache_size_mb > 0) {
+        result_cache.reset(new ResultCache(static_cast<std::size_t>(cache_size_mb) << 20));
+        _result_cache_prefix = StrUtil::format("{}/{}/{}\t",
+                _max_index_recall_num, _max_2nd_sort_num, _max_result_num);
+    }
+    cache_size_mb = 0;
+    if (!configs->get_value("QUERY_CACHE_SIZE_MB", cache_size_mb) || cache_size_mb < 0) {
+        cache_size_mb = QUERY_CACHE_SIZE_MB::value;
+        LOG_WARNING("key[QUERY_CACHE_SIZE_MB] not found or invalid, set to [%d]", cache_size_mb);
+    }
+    if (cache_size_mb > 0) {
+        query_info_cache.reset(new QueryInfoCache(static_cast<std::size_t>(cache_size_mb) << 20));
+    }
     return true;
 }
 
 bool TinyEngine::search(const std::string &query,
-        std::vector<StrStrPair> &result) {
+        std::vector<StrStrPair> &result,
+        std::vector<float>* scores,
+        int timeout_ms,
+        uint32_t* degrade_flags) const {
     EXPECT_FALSE_OR_RETURN(query.empty(), false);
-    EXPECT_NE_OR_RETURN(nullptr, table, false);
     if (!result.empty()) {
         result.clear();
     }
-    // 1. query segment
+    if (nullptr != scores) {
+        scores->clear();
+    }
+    SearchContext ctx(query, nullptr, timeout_ms);
 #ifdef DEBUG
-    auto time_1st = TimeUtil::get_curr_timeval();
+    SearchStat stat;
+    auto is_ok = _search_with_cache(ctx, result, scores, &stat);
+    LOG_INFO("query[%s] rn[%lu] tm{seg=%lu recall=%lu rank=%lu cut=%lu us; sum=%lu ms}",
+            query.c_str(), stat.recall_num, stat.segment_us, stat.recall_us,
+            stat.rank_us, stat.output_us, stat.total_us / 1000);
+#else
+    auto is_ok = _search_with_cache(ctx, result, scores, nullptr);
 #endif
-    EXPECT_TRUE_OR_RETURN(_fill_query_info(query), false);
+    if (nullptr != degrade_flags) {
+        *degrade_flags = ctx.degrade_flags;
+    }
+    return is_ok;
+}
 
+bool TinyEngine::_search(SearchContext &ctx,
+        std::vector<StrStrPair> &result,
+        std::vector<float>* scores,
+        SearchStat* stat) const {
+    // 不统计时不取时间
+    struct timeval time_points[5];
+    auto mark = [&](int idx) {
+        if (nullptr != stat) {
+            time_points[idx] = TimeUtil::get_curr_timeval();
+        }
+    };
+    // 1. query segment
+    mark(0);
+    if (!prepare_query(ctx)) {
+        mark(1);
+        if (nullptr != stat) {
+            stat->segment_us = TimeUtil::timeval_diff_us(&time_points[0], &time_points[1]);
+            stat->total_us = stat->segment_us;
+        }
+        return false;
+    }
     // 2. recall
-#ifdef DEBUG
-    auto time_2nd = TimeUtil::get_curr_timeval();
-#endif
-    if (!table->recall(query_info, results_info)) {
-        LOG_WARNING("query[%s] recall failed", query.c_str());
+    mark(1);
+    recall(ctx);
+    // 3. ranking
+    mark(2);
+    auto recall_num = ctx.results_info.size();
+    rank(ctx);
+    // 4. truncation after final sort
+    mark(3);
+    fill_result(ctx, result, scores);
+    mark(4);
+
+    if (nullptr != stat) {
+        stat->segment_us = TimeUtil::timeval_diff_us(&time_points[0], &time_points[1]);
+        stat->recall_us = TimeUtil::timeval_diff_us(&time_points[1], &time_points[2]);
+        stat->rank_us = TimeUtil::timeval_diff_us(&time_points[2], &time_points[3]);
+        stat->output_us = TimeUtil::timeval_diff_us(&time_points[3], &time_points[4]);
+        stat->total_us = TimeUtil::timeval_diff_us(&time_points[0], &time_points[4]);
+        stat->recall_num = recall_num;
+        stat->degrade_flags = ctx.degrade_flags;
+        stat->is_ok = true;
     }
+    return true;
+}
 
-    // 3. ranking
-#ifdef DEBUG
-    auto time_3rd = TimeUtil::get_curr_timeval();
-#endif
-    _rank_results();
+bool TinyEngine::_search_with_cache(SearchContext &ctx,
+        std::vector<StrStrPair> &result,
+        std::vector<float>* scores,
+        SearchStat* stat) const {
+    auto query = nullptr == result_cache ? std::string() : StrUtil::squeeze_space(ctx.query);
+    if (query.empty()) {
+        return _search(ctx, result, scores, stat);
+    }
+    auto time_begin = TimeUtil::get_curr_timeval();
+    ctx.query = query;
+    if (nullptr == ctx.index) {
+        ctx.index = table->get_index();
+    }
+    // 索引快照的 generation 与缓存的不一致时视为未命中
+    auto key = _result_cache_prefix + query;
+    std::shared_ptr<const CachedResult> cached = nullptr;
+    if (result_cache->get(key, ctx.index->generation, cached)) {
+        result = cached->result;
+        if (nullptr != scores) {
+            *scores = cached->scores;
+        }
+        if (nullptr != stat) {
+            auto time_end = TimeUtil::get_curr_timeval();
+            stat->total_us = TimeUtil::timeval_diff_us(&time_begin, &time_end);
+            stat->is_ok = true;
+            stat->is_cache_hit = true;
+        }
+        return true;
+    }
+    // 缓存的结果须带得分, 以便之后要求输出得分的请求命中
+    std::vector<float> local_scores;
+    auto &res_scores = nullptr == scores ? local_scores : *scores;
+    EXPECT_TRUE_OR_RETURN(_search(ctx, result, &res_scores, stat), false);
+    if (DEGRADE_NONE != ctx.degrade_flags) {
+        return true;
+    }
+    auto entry = std::make_shared<CachedResult>();
+    entry->result = result;
+    entry->scores = res_scores;
+    auto charge = sizeof(CachedResult) + result.size() * (sizeof(StrStrPair) + sizeof(float));
+    for (const auto &res : result) {
+        charge += res.first.size() + res.second.size();
+    }
+    result_cache->put(key, ctx.index->generation, entry, charge);
+    return true;
+}
 
-    // 4. truncation after final sort
-#ifdef DEBUG
-    auto time_4th = TimeUtil::get_curr_timeval();
-#endif
-    for (const auto &res : results_info) {
-        if (result.size() >= _max_result_num) {
+std::string TinyEngine::get_cache_stats() const {
+    std::vector<std::string> stats;
+    if (nullptr != result_cache) {
+        stats.push_back("result{" + result_cache->stats() + "}");
+    }
+    if (nullptr != query_info_cache) {
+        stats.push_back("query_info{" + query_info_cache->stats() + "}");
+    }
+    if (!wordsyn->get_cache_stats().empty()) {
+        stats.push_back("synonym{" + wordsyn->get_cache_stats() + "}");
+    }
+    if (!table->get_pair_cache_stats().empty()) {
+        stats.push_back("pair{" + table->get_pair_cache_stats() + "}");
+    }
+    return StrUtil::join(stats.begin(), stats.end(), ' ');
+}
+
+bool TinyEngine::search_batch(const std::vector<std::string> &queries,
+        std::vector<std::vector<StrStrPair>> &results,
+        std::vector<SearchStat>* stats,
+        int thread_num) const {
+    EXPECT_NE_OR_RETURN(nullptr, table, false);
+    results.assign(queries.size(), std::vector<StrStrPair>());
+    if (nullptr != stats) {
+        stats->assign(queries.size(), SearchStat());
+    }
+    if (thread_num < 1) {
+        thread_num = _batch_thread_num;
+    }
+    thread_num = std::min<std::size_t>(thread_num, queries.size());
+
+    // query 耗时差别大, 各线程逐个领取, 避免按块切分时慢 query 集中在一个线程
+    std::atomic<std::size_t> next_idx(0);
+    auto work_loop = [&]() {
+        for (auto i = next_idx++; i < queries.size(); i = next_idx++) {
+            if (queries[i].empty()) {
+                continue;
+            }
+            SearchContext ctx(queries[i]);
+            _search_with_cache(ctx, results[i], nullptr,
+                    nullptr == stats ? nullptr : &(*stats)[i]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 0; i < thread_num; ++i) {
+        workers.emplace_back(work_loop);
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return true;
+}
+
+void TinyEngine::get_degrade_names(uint32_t degrade_flags, std::vector<std::string> &names) {
+    static const std::pair<DEGRADE_FLAG, const char*> flag_names[] = {
+        {DEGRADE_SKIP_SYN_RECALL, "skip_syn_recall"},
+        {DEGRADE_SKIP_STR_FEATURE, "skip_str_feature"},
+        {DEGRADE_SHRINK_2ND_SORT, "shrink_2nd_sort"},
+        {DEGRADE_SKIP_MODEL, "skip_model"},
+    };
+    names.clear();
+    for (const auto &flag_name : flag_names) {
+        if (degrade_flags & flag_name.first) {
+            names.push_back(flag_name.second);
+        }
+    }
+}
+
+bool TinyEngine::prepare_query(SearchContext &ctx) const {
+    EXPECT_NE_OR_RETURN(nullptr, table, false);
+    auto timeout_ms = ctx.timeout_ms < 0 ? _search_timeout_ms : ctx.timeout_ms;
+    ctx.deadline.reset(static_cast<uint64_t>(timeout_ms) * 1000);
+    if (nullptr == ctx.index) {
+        ctx.index = table->get_index();
+    }
+    return _fill_query_info(ctx);
+}
+
+bool TinyEngine::recall(SearchContext &ctx) const {
+    EXPECT_NE_OR_RETURN(nullptr, table, false);
+    EXPECT_NE_OR_RETURN(nullptr, ctx.index, false);
+    if (!table->recall(*ctx.index, ctx.query_info, ctx.results_info,
+                &ctx.deadline, &ctx.degrade_flags)) {
+        LOG_WARNING("query[%s] recall failed", ctx.query.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TinyEngine::rank(SearchContext &ctx) const {
+    return _rank_results(ctx);
+}
+
+void TinyEngine::fill_result(const SearchContext &ctx,
+        std::vector<StrStrPair> &result,
+        std::vector<float>* scores) const {
+    for (const auto &res : ctx.results_info) {
+        if (result.size() >= static_cast<std::size_t>(_max_result_num)) {
             break;
         }
-        std::string title = _title_highlight(res);
-#ifndef DEBUG
-        std::cout << StrUtil::format("{}\t{}\t{}\n",
-                                    query, res->doc_info->title, res->doc_info->url);
-#endif
+        result.push_back(StrStrPair(res->doc_info->title, res->doc_info->url));
+        if (nullptr != scores) {
+            scores->push_back(res->final_score);
+        }
+    }
+}
 
-#ifdef DEBUG
+void TinyEngine::dump_result(const SearchContext &ctx, std::ostream &os) const {
+    const auto &query = ctx.query;
+    auto result_num = std::min(ctx.results_info.size(), static_cast<std::size_t>(_max_result_num));
+    for (std::size_t i = 0; i < result_num; ++i) {
+        const auto &res = ctx.results_info[i];
+        std::string title = _title_highlight(res);
         if (res->feature_mgr->is_empty()) {
             LOG_WARNING("query=%s title=%s feature is empty!",
                         query.c_str(), title.c_str());
         }
-        std::cout << StrUtil::format(
+        os << StrUtil::format(
                 "{}\t{}\t{}\t{}\n",
                 query,
                 title,
                 res->doc_info->url,
                 res->feature_mgr->to_str()
         );
-#endif
-        result.push_back(StrStrPair(res->doc_info->title, res->doc_info->url));
     }
-
-#ifdef DEBUG
-    auto time_5th = TimeUtil::get_curr_timeval();
-    auto time_segment = TimeUtil::timeval_diff_us(&time_2nd, &time_1st);
-    auto time_recall = TimeUtil::timeval_diff_us(&time_3rd, &time_2nd);
-    auto time_rank = TimeUtil::timeval_diff_us(&time_4th, &time_3rd);
-    auto time_truncation = TimeUtil::timeval_diff_us(&time_5th, &time_4th);
-    auto time_all = TimeUtil::timeval_diff_ms(&time_5th, &time_1st);
-    LOG_INFO("query[%s] rn[%lu] tm{seg=%lu recall=%lu rank=%lu cut=%lu us; sum=%lu ms}",
-            query.c_str(), results_info.size(),
-            time_segment, time_recall, time_rank, time_truncation, time_all);
-#endif
-    return true;
 }
 
-bool TinyEngine::_fill_query_info(const std::string &query) {
+bool TinyEngine::_fill_query_info(SearchContext &ctx) const {
+    auto &query = ctx.query;
     EXPECT_FALSE_OR_RETURN(query.empty(), false);
     EXPECT_NE_OR_RETURN(nullptr, wordseg, false);
-    EXPECT_NE_OR_RETURN(nullptr, table, false);
-
-    std::vector<TermNode> tokens;
-    // word segment
-    if (!(wordseg->get_token(query, tokens))) {
-        LOG_WARNING("query[%s] segment error", query.c_str());
-        return false;
+    EXPECT_NE_OR_RETURN(nullptr, ctx.index, false);
+
+    auto &query_info = ctx.query_info;
+    std::shared_ptr<const QueryInfo> cached = nullptr;
+    if (nullptr != query_info_cache && query_info_cache->get(query, 0, cached)) {
+        *query_info = *cached;
+    } else {
+        EXPECT_TRUE_OR_RETURN(_segment_query(ctx), false);
+        if (nullptr != query_info_cache) {
+            query_info_cache->put(query, 0, std::make_shared<const QueryInfo>(*query_info),
+                    query_info->mem_size());
+        }
     }
-    // calculate tf * idf
+    // term_id 与 idf 一样随索引变化(在线加入的 doc 会带来新 term), 每次请求重新查找, 不缓存
+    TermDict::get_instance().resolve_terms(query_info->terms);
+    // calculate tf * idf; idf 取自本次请求的索引快照, 不缓存
     auto module_ = 0.0;
     auto wei_sum = 0.0;
-    for (auto it = tokens.rbegin(); it != tokens.rend(); ++it) {
-        if (table->hit_stopword(it->token_sign)) {
+    for (auto it = query_info->terms.rbegin(); it != query_info->terms.rend(); ++it) {
+        if (table->hit_stopword(it->term_id)) {
             continue;
         }
-        auto idf = table->get_term_idf(it->token_sign);
-        auto tf = it->dup;
+        auto idf = ctx.index->get_term_idf(it->token_sign);
         it->wei = idf; // 遍历，无需乘以 tf
         module_ += pow(it->wei, 2.0);
         wei_sum += it->wei;
     }
+    query_info->vec_module = sqrt(module_);
+    query_info->wei_sum = wei_sum;
+#ifdef DEBUG
+    std::vector<std::string> vec;
+    for_each(query_info->terms.begin(), query_info->terms.end(),
+        [&vec](const TermNode &node) {
+            vec.push_back(node.to_str());
+        });
+    LOG_INFO("successfully filled query info, term_info[%s]",
+        StrUtil::join(vec.begin(), vec.end(), " | ").c_str());
+#endif
+    return true;
+}
+
+bool TinyEngine::_segment_query(SearchContext &ctx) const {
+    auto &query = ctx.query;
+    std::vector<std::pair<std::string, int>> phrases;
+    auto plain_query = _parse_phrase_operator(query, phrases);
+    std::vector<TermNode> tokens;
+    // word segment
+    if (!(wordseg->get_token(plain_query, tokens))) {
+        LOG_WARNING("query[%s] segment error", query.c_str());
+        return false;
+    }
     // fill query info
+    auto &query_info = ctx.query_info;
     query_info->init();
     query_info->query = query;
+    StrUtil::utf8_to_unicode(query, query_info->query_chars);
     query_info->terms = std::move(tokens);
-    query_info->vec_module = sqrt(module_);
-    query_info->wei_sum = wei_sum;
     if (query_info->terms.size() > 0) {
         auto p_last_term = std::prev(query_info->terms.end());
         query_info->query_len = p_last_term->offset + p_last_term->length; // 真实字符个数
         wordseg->update_global_info(query_info->terms, query_info->term_map);
     }
-    // get term syn info
+    // get term syn info; 切词的 offset 是相对于去掉短语引号后的 query
+    std::vector<uint32_t> plain_chars;
+    if (plain_query != query) {
+        StrUtil::utf8_to_unicode(plain_query, plain_chars);
+    }
+    const auto &chars = plain_query != query ? plain_chars : query_info->query_chars;
     std::vector<SynTermNode> syns;
     for (const auto &term : query_info->terms) {
-        wordsyn->get_syns(term.token, syns);
+        wordsyn->get_syns(StrUtil::unicode_to_utf8(chars, term.offset, term.length), syns);
         query_info->syns.push_back(syns);
         syns.clear();
     }
     
     assert(query_info->terms.size() == query_info->syns.size());
-#ifdef DEBUG
-    std::vector<std::string> vec;
-    for_each(query_info->terms.begin(), query_info->terms.end(),
-        [&vec](const TermNode &node) {
-            vec.push_back(node.to_str());
-        });
-    LOG_INFO("successfully filled query info, term_info[%s]",
-        StrUtil::join(vec.begin(), vec.end(), " | ").c_str());
-#endif
+    for (const auto &phrase : phrases) {
+        _fill_phrase_info(ctx, phrase.first, phrase.second);
+    }
     return true;
 }
 
-bool TinyEngine::_rank_results() {
-    #pragma omp parallel for num_threads(8)
-    for (auto i = 0; i < results_info.size() && i < _max_2nd_sort_num; ++i) {
-        _calc_features(results_info[i]);
+std::string TinyEngine::_parse_phrase_operator(
+        const std::string &query,
+        std::vector<std::pair<std::string, int>> &phrases) const {
+    EXPECT_TRUE_OR_DO(phrases.empty(), phrases.clear());
+    std::string plain_query;
+    std::size_t pos = 0;
+    while (pos < query.size()) {
+        auto begin = query.find('"', pos);
+        auto end = std::string::npos == begin ? begin : query.find('"', begin + 1);
+        if (std::string::npos == end) { // 没有成对的引号, 按普通字符处理
+            plain_query.append(query, pos, std::string::npos);
+            break;
+        }
+        plain_query.append(query, pos, begin - pos);
+        auto text = query.substr(begin + 1, end - begin - 1);
+        plain_query.append(text);
+        pos = end + 1;
+        // "..."~N
+        int window = 0;
+        if (pos + 1 < query.size() && '~' == query[pos] && isdigit(query[pos + 1])) {
+            for (++pos; pos < query.size() && isdigit(query[pos]); ++pos) {
+                window = window * 10 + (query[pos] - '0');
+            }
+        }
+        if (!StrUtil::is_space_str(text)) {
+            phrases.push_back(std::make_pair(text, window));
+        }
+    }
+    return plain_query;
+}
+
+bool TinyEngine::_fill_phrase_info(SearchContext &ctx, const std::string &text, int window) const {
+    std::vector<TermNode> tokens;
+    EXPECT_TRUE_OR_RETURN(wordseg->get_token(text, tokens), false);
+    // 这里只用到停用词的 term_id, 停用词加载时已分配, 可以随 QueryInfo 缓存
+    TermDict::get_instance().resolve_terms(tokens);
+    PhraseNode phrase;
+    phrase.text = text;
+    phrase.window = static_cast<uint16_t>(std::min(window, 0xffff));
+    // 停用词不进倒排, 不参与匹配, 但保留其占位; 空白不占位, 与建库时一致
+    uint16_t pos = 0;
+    for (const auto &token : tokens) {
+        if (token.is_space) {
+            continue;
+        }
+        if (!table->hit_stopword(token.term_id)) {
+            bool is_dup = phrase.window > 0 && std::find(phrase.term_signs.begin(),
+                    phrase.term_signs.end(), token.token_sign) != phrase.term_signs.end();
+            if (!is_dup) { // 窗口约束只看 term 是否出现, 重复 term 只保留一个
+                phrase.term_signs.push_back(token.token_sign);
+                phrase.term_pos.push_back(pos);
+            }
+        }
+        ++pos;
     }
-#ifdef XGBOOST
-    std::vector<std::unordered_map<std::string, float>> all_doc_features;
-    for (auto i = 0; i < results_info.size() && i < _max_2nd_sort_num; ++i) {
-        auto res = results_info[i];
-        all_doc_features.push_back(res->feature_mgr->get_features());
+    EXPECT_FALSE_OR_RETURN(phrase.term_signs.empty(), false);
+    auto first_pos = phrase.term_pos[0];
+    for (auto &term_pos : phrase.term_pos) {
+        term_pos -= first_pos;
+    }
+    ctx.query_info->phrases.push_back(std::move(phrase));
+    return true;
+}
+
+bool TinyEngine::_rank_results(SearchContext &ctx) const {
+    auto &results_info = ctx.results_info;
+    int sort_num = std::min<int>(results_info.size(), _max_2nd_sort_num);
+    // 每个 doc 计算特征前检查时间预算: 超过 STR_FEATURE_RATIO 后余下的 doc 不算字符串特征;
+    // 超过 SHRINK_SORT_RATIO 后至少算完前 shrink_num 个 doc 就停止, 余下的 doc 排在后面
+    auto shrink_num = std::max(_max_result_num,
+            _max_2nd_sort_num / SHRINK_2ND_SORT_DIVISOR::value);
+    for (auto i = 0; i < sort_num; ++i) {
+        if (i >= shrink_num && ctx.deadline.is_at_risk(SearchDeadline::SHRINK_SORT_RATIO)) {
+            sort_num = i;
+            ctx.degrade_flags |= DEGRADE_SHRINK_2ND_SORT;
+            break;
+        }
+        if (!(ctx.degrade_flags & DEGRADE_SKIP_STR_FEATURE)
+                && ctx.deadline.is_at_risk(SearchDeadline::STR_FEATURE_RATIO)) {
+            ctx.degrade_flags |= DEGRADE_SKIP_STR_FEATURE;
+        }
+        _calc_features(ctx, results_info[i]);
     }
-    std::vector<float> predicts;
-    auto ret = xgb_mgr->predict(all_doc_features, predicts);
-    if (ret) {
-        assert(predicts.size() == all_doc_features.size());
-        for (decltype(results_info.size()) i = 0;
-                i < results_info.size() && i < _max_2nd_sort_num; ++i) {
-            auto res = results_info[i];
-            res->final_score = predicts[i];
+#ifdef XGBOOST
+    // 来不及时不调用模型, 保留 _calc_features 中的 vsm 得分
+    if (ctx.deadline.is_at_risk(SearchDeadline::MODEL_RATIO)) {
+        ctx.degrade_flags |= DEGRADE_SKIP_MODEL;
+    } else {
+        std::vector<const FeatureMgr*> all_doc_features;
+        for (auto i = 0; i < sort_num; ++i) {
+            all_doc_features.push_back(results_info[i]->feature_mgr.get());
+        }
+        std::vector<float> predicts;
+        auto ret = xgb_mgr->predict(all_doc_features, predicts);
+        if (ret) {
+            assert(predicts.size() == all_doc_features.size());
+            for (auto i = 0; i < sort_num; ++i) {
+                auto res = results_info[i];
+                res->final_score = predicts[i];
+            }
         }
     }
 #endif
@@ -687,31 +2396,142 @@ bool TinyEngine::_rank_results() {
         [&](const std::shared_ptr<ResInfo> &lhs, const std::shared_ptr<ResInfo> &rhs) {
             return lhs->final_score > rhs->final_score;
         });
+    if (DEGRADE_NONE != ctx.degrade_flags) {
+        std::vector<std::string> names;
+        get_degrade_names(ctx.degrade_flags, names);
+        LOG_INFO("query[%s] over budget[%lu us], cost[%lu us] degrade[%s]",
+                ctx.query.c_str(), ctx.deadline.budget_us, ctx.deadline.elapsed_us(),
+                StrUtil::join(names.begin(), names.end(), ',').c_str());
+    }
     return true;
 }
 
-bool TinyEngine::_calc_features(std::shared_ptr<ResInfo> result) {
+const std::vector<TinyEngine::FeatureCalcNode>& TinyEngine::_get_feature_calc_graph() {
+    static const std::vector<FeatureCalcNode> graph = {
+        {"vsm", {}, {F_QU_VSM}},
+        {"bm25", {}, {F_QU_BM25}},
+        {"cqr_ctr", {},
+            {F_QU_TERM_WEI_CQR, F_QU_TERM_WEI_CTR, F_QU_TERM_WEI_COVERAGE, F_QU_MISS}},
+        {"scatter_overlap", {},
+            {F_QU_EXTRA, F_Q_LEN, F_U_LEN, F_QU_STR_LEN_CQR, F_QU_STR_LEN_CTR,
+                F_QU_STR_LEN_COVERAGE, F_Q_TERM_CNT, F_U_TERM_CNT, F_QU_TERM_CNT_CQR,
+                F_QU_TERM_CNT_CTR, F_QU_TERM_CNT_COVERAGE}},
+        {"term_seq", {}, {}},
+        {"term_lcseq", {CALC_TERM_SEQ},
+            {F_QU_TERM_LCSEQ, F_QU_TERM_LCSEQ_OVER_Q, F_QU_TERM_LCSEQ_OVER_U}},
+        {"term_lcstr", {CALC_TERM_SEQ},
+            {F_QU_TERM_LCSTR, F_QU_TERM_LCSTR_OVER_Q, F_QU_TERM_LCSTR_OVER_U}},
+        {"term_edist", {CALC_TERM_SEQ},
+            {F_QU_TERM_EDIST, F_QU_TERM_EDIST_OVER_Q, F_QU_TERM_EDIST_OVER_U}},
+        {"str_lcseq", {}, {F_QU_STR_LCSEQ, F_QU_STR_LCSEQ_OVER_Q, F_QU_STR_LCSEQ_OVER_U}},
+        {"str_lcstr", {}, {F_QU_STR_LCSTR, F_QU_STR_LCSTR_OVER_Q, F_QU_STR_LCSTR_OVER_U}},
+        {"str_edist", {}, {F_QU_STR_EDIST, F_QU_STR_EDIST_OVER_Q, F_QU_STR_EDIST_OVER_U}},
+        {"disorder", {}, {F_QU_DISORDER}},
+        {"diversity", {}, {F_QU_HIT_DIVERSITY}},
+        // proximity 由 miss, extra, disorder 计算
+        {"proximity", {CALC_CQR_CTR, CALC_SCATTER_OVERLAP, CALC_DISORDER}, {F_QU_PROXIMITY}},
+    };
+    assert(graph.size() == CALC_NUM);
+    return graph;
+}
+
+void TinyEngine::_plan_features() {
+    std::vector<bool> is_required(FEATURE_NUM, false);
+#ifdef DEBUG
+    is_required.assign(FEATURE_NUM, true);
+#else
+    is_required[F_QU_VSM] = true; // 不调用模型(含降级)时的排序得分
+#ifdef XGBOOST
+    for (auto fid : xgb_mgr->get_column_features()) {
+        if (FEATURE_NUM != fid) {
+            is_required[fid] = true;
+        }
+    }
+#endif
+#endif
+    auto &graph = _get_feature_calc_graph();
+    uint32_t calc_mask = 0;
+    for (int calc = 0; calc < CALC_NUM; ++calc) {
+        for (auto fid : graph[calc].features) {
+            if (is_required[fid]) {
+                calc_mask |= 1u << calc;
+            }
+        }
+    }
+    // 依赖的单元排在前面, 倒序遍历一次即可展开所有间接依赖
+    std::vector<std::string> names;
+    for (int calc = CALC_NUM - 1; calc >= 0; --calc) {
+        if (!(calc_mask & (1u << calc))) {
+            continue;
+        }
+        for (auto dep : graph[calc].deps) {
+            assert(dep < calc);
+            calc_mask |= 1u << dep;
+        }
+    }
+    for (int calc = 0; calc < CALC_NUM; ++calc) {
+        if (calc_mask & (1u << calc)) {
+            names.push_back(graph[calc].name);
+        }
+    }
+    _feature_calc_mask = calc_mask;
+    LOG_INFO("feature calcs[%s]", StrUtil::join(names.begin(), names.end(), ',').c_str());
+}
+
+bool TinyEngine::_calc_features(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const {
     EXPECT_NE_OR_RETURN(nullptr, result, false);
     EXPECT_FALSE_OR_RETURN_LOGGED(result->match_term_map.empty(), false,
                                   "match_term_map is empty!");
 
-    _calc_vsm(result);
-    _calc_bm25(result);
-    _calc_cqr_ctr(result);
-    _calc_scatter_overlap(result);
-    _calc_order_overlap(result);
-    _calc_distance(result);
-    _calc_disorder(result);
-    _calc_diversity(result);
- 
-    result->feature_mgr->add_feature("F_QU_PROXIMITY",
+    auto calc_mask = _feature_calc_mask;
+    // 最耗时的字符串特征(最长公共子序列/子串, 编辑距离), 超出时间预算时跳过
+    if (ctx.degrade_flags & DEGRADE_SKIP_STR_FEATURE) {
+        calc_mask &= ~STR_FEATURE_CALCS::value;
+    }
+    auto is_needed = [calc_mask](FEATURE_CALC calc) {
+        return 0 != (calc_mask & (1u << calc));
+    };
+    if (is_needed(CALC_VSM)) {
+        _calc_vsm(ctx, result);
+    }
+    if (is_needed(CALC_BM25)) {
+        _calc_bm25(ctx, result);
+    }
+    if (is_needed(CALC_CQR_CTR)) {
+        _calc_cqr_ctr(ctx, result);
+    }
+    if (is_needed(CALC_SCATTER_OVERLAP)) {
+        _calc_scatter_overlap(ctx, result);
+    }
+    // 不在字典中的 query term 都是 INVALID_ID, 但 doc 中的 term 都在字典中, 不影响比较结果
+    std::vector<uint32_t> query_seq;
+    std::vector<uint32_t> title_seq;
+    if (is_needed(CALC_TERM_SEQ)) {
+        for (const auto &term : ctx.query_info->terms) {
+            query_seq.push_back(term.term_id);
+        }
+        for (const auto &term : result->doc_info->terms) {
+            title_seq.push_back(term.term_id);
+        }
+    }
+    _calc_order_overlap(ctx, result, calc_mask, query_seq, title_seq);
+    _calc_distance(ctx, result, calc_mask, query_seq, title_seq);
+    if (is_needed(CALC_DISORDER)) {
+        _calc_disorder(ctx, result);
+    }
+    if (is_needed(CALC_DIVERSITY)) {
+        _calc_diversity(result);
+    }
+    if (is_needed(CALC_PROXIMITY)) {
+        result->feature_mgr->add_feature(F_QU_PROXIMITY,
                 pow(0.9, result->miss + result->extra + result->disorder));
+    }
     result->final_score = result->vsm; //result->cqr * result->ctr;
     return true;
 }
 
-bool TinyEngine::_calc_vsm(std::shared_ptr<ResInfo> result) {
-    auto &req_vec_module = query_info->vec_module;
+bool TinyEngine::_calc_vsm(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const {
+    auto &req_vec_module = ctx.query_info->vec_module;
     auto &res_vec_module = result->doc_info->vec_module;
     EXPECT_GT_OR_RETURN(abs(req_vec_module - 0.0), EPSILON, false);
     EXPECT_GT_OR_RETURN(abs(res_vec_module - 0.0), EPSILON, false);
@@ -719,9 +2539,9 @@ bool TinyEngine::_calc_vsm(std::shared_ptr<ResInfo> result) {
     // sign : <req, res>
     std::unordered_map<std::size_t, std::pair<float, float>> term_wei_map;
 
-    auto &req_terms = query_info->terms;
+    auto &req_terms = ctx.query_info->terms;
     for (const auto &term : req_terms) {
-        if (table->hit_stopword(term.token_sign)) {
+        if (table->hit_stopword(term.term_id)) {
             continue;
         }
         term_wei_map.insert(std::make_pair(term.token_sign,
@@ -729,7 +2549,7 @@ bool TinyEngine::_calc_vsm(std::shared_ptr<ResInfo> result) {
     }
     auto &res_terms = result->doc_info->terms;
     for (const auto &term : res_terms) {
-        if (table->hit_stopword(term.token_sign)) {
+        if (table->hit_stopword(term.term_id)) {
             continue;
         }
         if (term_wei_map.count(term.token_sign)) {
@@ -749,15 +2569,15 @@ bool TinyEngine::_calc_vsm(std::shared_ptr<ResInfo> result) {
     result->vsm = MathUtil::dot_product(req_term_vec, res_term_vec) / \
                   (req_vec_module * res_vec_module);
     
-    result->feature_mgr->add_feature("F_QU_VSM", result->vsm);
+    result->feature_mgr->add_feature(F_QU_VSM, result->vsm);
     return true;
 }
 
-bool TinyEngine::_calc_bm25(std::shared_ptr<ResInfo> result) {
-    auto avg_doc_len = table->get_avg_doc_len();
+bool TinyEngine::_calc_bm25(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const {
+    auto avg_doc_len = ctx.index->avg_doc_len;
     float bm25 = 0.0;
     for (const auto &item : result->match_term_map) { // <term_sign, MatchTermInfo>
-        auto wi = table->get_term_idf(item.first);
+        auto wi = ctx.index->get_term_idf(item.first);
 
         auto term_freq_in_query = item.second->in_query.term_freq;
         auto term_freq_in_doc = item.second->in_doc.term_freq;
@@ -773,7 +2593,7 @@ bool TinyEngine::_calc_bm25(std::shared_ptr<ResInfo> result) {
         bm25 += wi * rtd;
     }
     result->bm25 = bm25;
-    result->feature_mgr->add_feature("F_QU_BM25", result->bm25);
+    result->feature_mgr->add_feature(F_QU_BM25, result->bm25);
     return true;
 }
 
@@ -781,7 +2601,7 @@ float TinyEngine::_calc_bm25_r_factor(
         uint16_t term_freq_in_query,
         uint16_t term_freq_in_doc,
         uint32_t doc_len,
-        float avg_doc_len) {
+        float avg_doc_len) const {
     float k1 = 2.0f;
     float k2 = 1.0f;
     float b = 0.75f;
@@ -793,7 +2613,7 @@ float TinyEngine::_calc_bm25_r_factor(
     return Rtd;
 }
 
-bool TinyEngine::_calc_cqr_ctr(std::shared_ptr<ResInfo> result) {
+bool TinyEngine::_calc_cqr_ctr(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const {
     float divisor = 0.0;
     for (const auto &item : result->match_term_map) {
         if (item.second->is_stopword) {
@@ -802,27 +2622,27 @@ bool TinyEngine::_calc_cqr_ctr(std::shared_ptr<ResInfo> result) {
         divisor += item.second->hit_freq * item.second->idf;
     }
  
-    auto dividend_cqr = query_info->wei_sum;
+    auto dividend_cqr = ctx.query_info->wei_sum;
     auto dividend_ctr = result->doc_info->wei_sum;
     try {
         result->cqr = divisor / dividend_cqr;
         result->ctr = divisor / dividend_ctr;
     } catch (std::exception &e) {
         LOG_WARNING("query[%s] title[%s] dividend zero",
-            query_info->query.c_str(), result->doc_info->title.c_str());
+            ctx.query_info->query.c_str(), result->doc_info->title.c_str());
     }
     result->miss = 1 - result->cqr;
 
-    result->feature_mgr->add_feature("F_QU_TERM_WEI_CQR", result->cqr);
-    result->feature_mgr->add_feature("F_QU_TERM_WEI_CTR", result->ctr);
-    result->feature_mgr->add_feature("F_QU_TERM_WEI_COVERAGE", result->cqr * result->ctr);
-    result->feature_mgr->add_feature("F_QU_MISS", result->miss);
+    result->feature_mgr->add_feature(F_QU_TERM_WEI_CQR, result->cqr);
+    result->feature_mgr->add_feature(F_QU_TERM_WEI_CTR, result->ctr);
+    result->feature_mgr->add_feature(F_QU_TERM_WEI_COVERAGE, result->cqr * result->ctr);
+    result->feature_mgr->add_feature(F_QU_MISS, result->miss);
 #if 0
     if (!GE_LOWER_AND_LE_UPPER(result->cqr, 0.0, 1.0)
             || !GE_LOWER_AND_LE_UPPER(result->ctr, 0.0, 1.0)) {
 
         LOG_WARNING("query[%s] title[%s] terms=%u cqr=%.2f/%.2f=%.2f ctr=%.2f/%.2f=%.2f",
-             query_info->query.c_str(),
+             ctx.query_info->query.c_str(),
              result->doc_info->title.c_str(),
              result->term_hits,
              divisor,
@@ -836,56 +2656,62 @@ bool TinyEngine::_calc_cqr_ctr(std::shared_ptr<ResInfo> result) {
     return true;
 }
 
-void TinyEngine::_calc_order_overlap(std::shared_ptr<ResInfo> result) {
+void TinyEngine::_calc_order_overlap(
+        const SearchContext &ctx,
+        std::shared_ptr<ResInfo> result,
+        uint32_t calc_mask,
+        const std::vector<uint32_t> &query_seq,
+        const std::vector<uint32_t> &title_seq) const {
     // 所有特征均考虑先后序关系
-    auto &req_terms = query_info->terms;
-    auto &res_terms = result->doc_info->terms;
- 
-    // term粒度散乱有序命中
-    auto term_lcseq = MathUtil::longest_common_subsequence(req_terms, res_terms);
-    // term粒度连续命中
-    auto term_lcstr = MathUtil::longest_continuous_substring(req_terms, res_terms);
-
-    auto &query = query_info->query;
-    auto &title = result->doc_info->title;
-    // str粒度散乱有序命中
-    auto str_lcseq = MathUtil::longest_common_subsequence(query, title);
-    // str粒度连续命中
-    auto str_lcstr = MathUtil::longest_continuous_substring(query, title);
-
-    result->feature_mgr->add_feature("F_QU_TERM_LCSEQ", term_lcseq);
-    result->feature_mgr->add_feature("F_QU_TERM_LCSEQ_OVER_Q",
-                        static_cast<float>(term_lcseq) / req_terms.size());
-    result->feature_mgr->add_feature("F_QU_TERM_LCSEQ_OVER_U",
-                        static_cast<float>(term_lcseq) / res_terms.size());
-
-    result->feature_mgr->add_feature("F_QU_TERM_LCSTR", term_lcstr);
-    result->feature_mgr->add_feature("F_QU_TERM_LCSTR_OVER_Q",
-                        static_cast<float>(term_lcstr) / req_terms.size());
-    result->feature_mgr->add_feature("F_QU_TERM_LCSTR_OVER_U",
-                        static_cast<float>(term_lcstr) / res_terms.size());
-
-    result->feature_mgr->add_feature("F_QU_STR_LCSEQ", str_lcseq);
-    result->feature_mgr->add_feature("F_QU_STR_LCSEQ_OVER_Q",
-                        static_cast<float>(str_lcseq) / query.size());
-    result->feature_mgr->add_feature("F_QU_STR_LCSEQ_OVER_U",
-                        static_cast<float>(str_lcseq) / title.size());
-
-    result->feature_mgr->add_feature("F_QU_STR_LCSTR", str_lcstr);
-    result->feature_mgr->add_feature("F_QU_STR_LCSTR_OVER_Q",
-                        static_cast<float>(str_lcstr) / query.size());
-    result->feature_mgr->add_feature("F_QU_STR_LCSTR_OVER_U",
-                        static_cast<float>(str_lcstr) / title.size());
-}
-
-void TinyEngine::_calc_scatter_overlap(std::shared_ptr<ResInfo> result) {
+    // 字符粒度特征在 unicode 码点上计算
+    auto &query = ctx.query_info->query_chars;
+    auto &title = result->doc_info->title_chars;
+    if (calc_mask & (1u << CALC_TERM_LCSEQ)) {
+        // term粒度散乱有序命中
+        auto term_lcseq = MathUtil::longest_common_subsequence(query_seq, title_seq);
+        result->feature_mgr->add_feature(F_QU_TERM_LCSEQ, term_lcseq);
+        result->feature_mgr->add_feature(F_QU_TERM_LCSEQ_OVER_Q,
+                            static_cast<float>(term_lcseq) / query_seq.size());
+        result->feature_mgr->add_feature(F_QU_TERM_LCSEQ_OVER_U,
+                            static_cast<float>(term_lcseq) / title_seq.size());
+    }
+    if (calc_mask & (1u << CALC_TERM_LCSTR)) {
+        // term粒度连续命中
+        auto term_lcstr = MathUtil::longest_continuous_substring(query_seq, title_seq);
+        result->feature_mgr->add_feature(F_QU_TERM_LCSTR, term_lcstr);
+        result->feature_mgr->add_feature(F_QU_TERM_LCSTR_OVER_Q,
+                            static_cast<float>(term_lcstr) / query_seq.size());
+        result->feature_mgr->add_feature(F_QU_TERM_LCSTR_OVER_U,
+                            static_cast<float>(term_lcstr) / title_seq.size());
+    }
+    if (calc_mask & (1u << CALC_STR_LCSEQ)) {
+        // str粒度散乱有序命中
+        auto str_lcseq = MathUtil::longest_common_subsequence(query, title);
+        result->feature_mgr->add_feature(F_QU_STR_LCSEQ, str_lcseq);
+        result->feature_mgr->add_feature(F_QU_STR_LCSEQ_OVER_Q,
+                            static_cast<float>(str_lcseq) / query.size());
+        result->feature_mgr->add_feature(F_QU_STR_LCSEQ_OVER_U,
+                            static_cast<float>(str_lcseq) / title.size());
+    }
+    if (calc_mask & (1u << CALC_STR_LCSTR)) {
+        // str粒度连续命中
+        auto str_lcstr = MathUtil::longest_continuous_substring(query, title);
+        result->feature_mgr->add_feature(F_QU_STR_LCSTR, str_lcstr);
+        result->feature_mgr->add_feature(F_QU_STR_LCSTR_OVER_Q,
+                            static_cast<float>(str_lcstr) / query.size());
+        result->feature_mgr->add_feature(F_QU_STR_LCSTR_OVER_U,
+                            static_cast<float>(str_lcstr) / title.size());
+    }
+}
+
+void TinyEngine::_calc_scatter_overlap(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const {
     uint32_t overlap = 0;
     // 只算命中,不考虑先后序关系
     for (const auto &item : result->match_term_map) { // <sign, freq_in_doc>
-        auto pterm = table->get_term_info(item.first);
+        auto pterm = ctx.index->get_term_info(item.first);
         overlap += pterm->term_len * item.second->hit_freq;
     }
-    auto query_len = query_info->query_len;
+    auto query_len = ctx.query_info->query_len;
     auto title_len = result->doc_info->title_len;
     auto extra = static_cast<float>(query_len - overlap) / (query_len + 1);
     auto str_len_cqr = static_cast<float>(overlap) / query_len;
@@ -893,92 +2719,90 @@ void TinyEngine::_calc_scatter_overlap(std::shared_ptr<ResInfo> result) {
     auto str_len_coverage = str_len_cqr * str_len_ctr;
 
     result->extra = extra;
-    result->feature_mgr->add_feature("F_QU_EXTRA", result->extra);
+    result->feature_mgr->add_feature(F_QU_EXTRA, result->extra);
 
-    result->feature_mgr->add_feature("F_Q_LEN", query_len);
-    result->feature_mgr->add_feature("F_U_LEN", title_len);
+    result->feature_mgr->add_feature(F_Q_LEN, query_len);
+    result->feature_mgr->add_feature(F_U_LEN, title_len);
 
-    result->feature_mgr->add_feature("F_QU_STR_LEN_CQR", str_len_cqr);
-    result->feature_mgr->add_feature("F_QU_STR_LEN_CTR", str_len_ctr);
-    result->feature_mgr->add_feature("F_QU_STR_LEN_COVERAGE", str_len_coverage);
+    result->feature_mgr->add_feature(F_QU_STR_LEN_CQR, str_len_cqr);
+    result->feature_mgr->add_feature(F_QU_STR_LEN_CTR, str_len_ctr);
+    result->feature_mgr->add_feature(F_QU_STR_LEN_COVERAGE, str_len_coverage);
 
     auto hit_term_cnt = result->term_hits;
-    auto query_term_cnt = query_info->terms.size();
+    auto query_term_cnt = ctx.query_info->terms.size();
     auto title_term_cnt = result->doc_info->terms.size();
     auto term_cnt_cqr = static_cast<float>(hit_term_cnt) / query_term_cnt;
     auto term_cnt_ctr = static_cast<float>(hit_term_cnt) / title_term_cnt;
     auto term_cnt_coverage = term_cnt_cqr * term_cnt_ctr;
 
-    result->feature_mgr->add_feature("F_Q_TERM_CNT", query_term_cnt);
-    result->feature_mgr->add_feature("F_U_TERM_CNT", title_term_cnt);
-    //result->feature_mgr->add_feature("F_QU_HIT_TERM_CNT", hit_term_cnt);
-    result->feature_mgr->add_feature("F_QU_TERM_CNT_CQR", term_cnt_cqr);
-    result->feature_mgr->add_feature("F_QU_TERM_CNT_CTR", term_cnt_ctr);
-    result->feature_mgr->add_feature("F_QU_TERM_CNT_COVERAGE", term_cnt_coverage);
+    result->feature_mgr->add_feature(F_Q_TERM_CNT, query_term_cnt);
+    result->feature_mgr->add_feature(F_U_TERM_CNT, title_term_cnt);
+    //result->feature_mgr->add_feature(F_QU_HIT_TERM_CNT, hit_term_cnt);
+    result->feature_mgr->add_feature(F_QU_TERM_CNT_CQR, term_cnt_cqr);
+    result->feature_mgr->add_feature(F_QU_TERM_CNT_CTR, term_cnt_ctr);
+    result->feature_mgr->add_feature(F_QU_TERM_CNT_COVERAGE, term_cnt_coverage);
 }
 
-void TinyEngine::_calc_distance(std::shared_ptr<ResInfo> result) {
-    auto &req_terms = query_info->terms;
-    auto &res_terms = result->doc_info->terms;
-
-    auto term_edit_distance = MathUtil::edit_distance(req_terms, res_terms);
-    auto str_edit_distance = MathUtil::edit_distance(query_info->query, result->doc_info->title);
-
-    result->feature_mgr->add_feature("F_QU_TERM_EDIST", term_edit_distance);
-    result->feature_mgr->add_feature("F_QU_TERM_EDIST_OVER_Q",
-                        static_cast<float>(term_edit_distance) / req_terms.size());
-    result->feature_mgr->add_feature("F_QU_TERM_EDIST_OVER_U",
-                        static_cast<float>(term_edit_distance) / res_terms.size());
-    result->feature_mgr->add_feature("F_QU_STR_EDIST", str_edit_distance);
-    result->feature_mgr->add_feature("F_QU_STR_EDIST_OVER_Q",
-                        static_cast<float>(str_edit_distance) / query_info->query_len);
-    result->feature_mgr->add_feature("F_QU_STR_EDIST_OVER_U",
-                        static_cast<float>(str_edit_distance) / result->doc_info->title_len);
+void TinyEngine::_calc_distance(
+        const SearchContext &ctx,
+        std::shared_ptr<ResInfo> result,
+        uint32_t calc_mask,
+        const std::vector<uint32_t> &query_seq,
+        const std::vector<uint32_t> &title_seq) const {
+    if (calc_mask & (1u << CALC_TERM_EDIST)) {
+        auto term_edit_distance = MathUtil::edit_distance(query_seq, title_seq);
+        result->feature_mgr->add_feature(F_QU_TERM_EDIST, term_edit_distance);
+        result->feature_mgr->add_feature(F_QU_TERM_EDIST_OVER_Q,
+                            static_cast<float>(term_edit_distance) / query_seq.size());
+        result->feature_mgr->add_feature(F_QU_TERM_EDIST_OVER_U,
+                            static_cast<float>(term_edit_distance) / title_seq.size());
+    }
+    if (calc_mask & (1u << CALC_STR_EDIST)) {
+        auto &query = ctx.query_info->query_chars;
+        auto &title = result->doc_info->title_chars;
+        auto str_edit_distance = MathUtil::edit_distance(query, title);
+        result->feature_mgr->add_feature(F_QU_STR_EDIST, str_edit_distance);
+        result->feature_mgr->add_feature(F_QU_STR_EDIST_OVER_Q,
+                            static_cast<float>(str_edit_distance) / query.size());
+        result->feature_mgr->add_feature(F_QU_STR_EDIST_OVER_U,
+                            static_cast<float>(str_edit_distance) / title.size());
+    }
 }
 
-void TinyEngine::_calc_disorder(std::shared_ptr<ResInfo> result) {
+void TinyEngine::_calc_disorder(const SearchContext &ctx, std::shared_ptr<ResInfo> result) const {
     EXPECT_GT_OR_RETURN(result->match_term_map.size(), 1, RETURN_ON_VOID);
-    std::unordered_set<std::size_t> query_order_pair;
-    auto &req_terms = query_info->terms;
-    for (decltype(req_terms.size()) i = 0; i < req_terms.size(); ++i) {
-        auto term_sign_i = req_terms[i].token_sign;
-
-        if (result->match_term_map.count(term_sign_i) < 1) {
-            continue;
+    // 只保留命中的 term, 每个 term 只查一次 match_term_map
+    std::vector<uint32_t> req_hits;
+    for (const auto &term : ctx.query_info->terms) {
+        if (result->match_term_map.count(term.token_sign) > 0) {
+            req_hits.push_back(term.term_id);
         }
-        for (decltype(req_terms.size()) j = i + 1; j < req_terms.size(); ++j) {
-            auto term_sign_j = req_terms[j].token_sign;
-            if (result->match_term_map.count(term_sign_j) < 1) {
-                continue;
-            }
-            auto pair_sign_ij = _calc_pair_sign(term_sign_i, term_sign_j);
-            query_order_pair.insert(pair_sign_ij);
+    }
+    std::vector<uint32_t> res_hits;
+    for (const auto &term : result->doc_info->terms) {
+        if (result->match_term_map.count(term.token_sign) > 0) {
+            res_hits.push_back(term.term_id);
         }
     }
-
-    // LOG_DEBUG("hit_term_cnt=%llu, query_order_pair_cnt=%llu", 
-    //         result->match_term_map.size(),
-    //         query_order_pair.size());
+    // query 中的顺序 term 对, 排序后二分查找
+    std::vector<uint64_t> query_order_pair;
+    for (std::size_t i = 0; i < req_hits.size(); ++i) {
+        for (std::size_t j = i + 1; j < req_hits.size(); ++j) {
+            query_order_pair.push_back(_calc_pair_key(req_hits[i], req_hits[j]));
+        }
+    }
+    std::sort(query_order_pair.begin(), query_order_pair.end());
 
     auto order_pair_cnt = 0;
     auto disorder_pair_cnt = 0;
-    auto &res_terms = result->doc_info->terms;
-    for (decltype(res_terms.size()) i = 0; i < res_terms.size(); ++i) {
-        auto term_sign_i = res_terms[i].token_sign;
-        if (result->match_term_map.count(term_sign_i) < 1) {
-            continue;
-        }
-        for (decltype(res_terms.size()) j = i + 1; j < res_terms.size(); ++j) {
-            auto term_sign_j = res_terms[j].token_sign;
-            if (result->match_term_map.count(term_sign_j) < 1) {
-                continue;
-            }
-            auto pair_sign_ij = _calc_pair_sign(term_sign_i, term_sign_j);
-            if (query_order_pair.count(pair_sign_ij) > 0) {
+    for (std::size_t i = 0; i < res_hits.size(); ++i) {
+        for (std::size_t j = i + 1; j < res_hits.size(); ++j) {
+            if (std::binary_search(query_order_pair.begin(), query_order_pair.end(),
+                        _calc_pair_key(res_hits[i], res_hits[j]))) {
                 order_pair_cnt += 1;
             }
-            auto pair_sign_ji = _calc_pair_sign(term_sign_j, term_sign_i);
-            if (query_order_pair.count(pair_sign_ji) > 0) {
+            if (std::binary_search(query_order_pair.begin(), query_order_pair.end(),
+                        _calc_pair_key(res_hits[j], res_hits[i]))) {
                 disorder_pair_cnt += 1;
             }
         }
@@ -986,24 +2810,14 @@ void TinyEngine::_calc_disorder(std::shared_ptr<ResInfo> result) {
     result->disorder = static_cast<float>(disorder_pair_cnt) / \
                        (order_pair_cnt + disorder_pair_cnt + 1);
 
-    result->feature_mgr->add_feature("F_QU_DISORDER", result->disorder);
+    result->feature_mgr->add_feature(F_QU_DISORDER, result->disorder);
 }
 
-std::size_t TinyEngine::_calc_pair_sign(std::size_t term_sign_1, std::size_t term_sign_2) {
-    std::size_t cut_sign = 0xffffffff;
-    auto sign1 = term_sign_1 & cut_sign;
-    auto sign2 = term_sign_2 & cut_sign;
-    auto pair_sign = (sign1 << 32) | sign2;
-    /*
-    LOG_DEBUG("tsign1=%llu sign1=%llu tsign2=%llu sign2=%llu psign=%llu\n", 
-            term_sign_1, sign1,
-            term_sign_2, sign2,
-            pair_sign);
-    */
-    return pair_sign;
+uint64_t TinyEngine::_calc_pair_key(uint32_t term_id_1, uint32_t term_id_2) {
+    return (static_cast<uint64_t>(term_id_1) << 32) | term_id_2;
 }
 
-void TinyEngine::_calc_diversity(std::shared_ptr<ResInfo> result) {
+void TinyEngine::_calc_diversity(std::shared_ptr<ResInfo> result) const {
     std::vector<uint16_t> req_hit_offsets;
     std::vector<uint16_t> res_hit_offsets;
     for (const auto &item : result->match_term_map) {
@@ -1017,23 +2831,24 @@ void TinyEngine::_calc_diversity(std::shared_ptr<ResInfo> result) {
     auto req_diversity = MathUtil::standard_variance(req_hit_offsets);
     auto res_diversity = MathUtil::standard_variance(res_hit_offsets);
     auto diversity = res_diversity - req_diversity;
-    result->feature_mgr->add_feature("F_QU_HIT_DIVERSITY", diversity);
+    result->feature_mgr->add_feature(F_QU_HIT_DIVERSITY, diversity);
 }
 
-std::string TinyEngine::_title_highlight(std::shared_ptr<ResInfo> result) {
+std::string TinyEngine::_title_highlight(std::shared_ptr<ResInfo> result) const {
     std::string title;
     auto doc = result->doc_info;
     for (const auto &term : doc->terms) {
-        if (result->match_term_map.count(term.token_sign) > 0) {
-            if (result->match_term_map[term.token_sign]->is_syn_match
-                    && !_is_highlight_syn_term) {
-                title += term.token;
+        auto token = StrUtil::unicode_to_utf8(doc->title_chars, term.offset, term.length);
+        auto iter = result->match_term_map.find(term.token_sign);
+        if (iter != result->match_term_map.end()) {
+            if (iter->second->is_syn_match && !_is_highlight_syn_term) {
+                title += token;
             } else {
                 title += StrUtil::format("{}{}{}",
-                    COLOR_RED, term.token.c_str(), COLOR_NONE);
+                    COLOR_RED, token.c_str(), COLOR_NONE);
             }
         } else {
-            title += term.token;
+            title += token;
         }
     }
     return title;
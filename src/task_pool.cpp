@@ -0,0 +1,103 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    task_pool.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/19 00:04:12
+*   @brief:
+*
+*****************************************************************/
+
+
+#include "../include/task_pool.h"
+#include <algorithm>
+
+namespace tiny_engine {
+
+TaskPool::TaskPool(std::size_t thread_num) : is_stopped(false) {
+    for (std::size_t i = 0; i < thread_num; ++i) {
+        workers.push_back(std::thread(&TaskPool::_work_loop, this));
+    }
+}
+
+TaskPool::~TaskPool() {
+    stop();
+}
+
+void TaskPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        is_stopped = true;
+    }
+    queue_cond.notify_all();
+    for (auto &worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+std::size_t TaskPool::thread_num() const {
+    return workers.size();
+}
+
+void TaskPool::run(std::size_t task_num, const Task &task) {
+    if (task_num <= 1 || workers.empty()) {
+        for (std::size_t i = 0; i < task_num; ++i) {
+            task(i);
+        }
+        return;
+    }
+    auto batch = std::make_shared<Batch>(&task, task_num);
+    batch->next_idx = 1; // task(0) 留给调用线程
+    auto helper_num = std::min(task_num - 1, workers.size());
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        for (std::size_t i = 0; i < helper_num; ++i) {
+            queue.push_back(batch);
+        }
+    }
+    if (helper_num > 1) {
+        queue_cond.notify_all();
+    } else {
+        queue_cond.notify_one();
+    }
+    task(0);
+    _run_batch(*batch, 1);
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->done_cond.wait(lock, [&batch]() { return batch->done_cnt == batch->task_num; });
+}
+
+void TaskPool::_run_batch(Batch &batch, std::size_t done_cnt) {
+    for (auto idx = batch.next_idx++; idx < batch.task_num; idx = batch.next_idx++) {
+        (*batch.task)(idx);
+        ++done_cnt;
+    }
+    if (0 == done_cnt) {
+        return; // 排队期间 task 已被其他线程认领完
+    }
+    std::lock_guard<std::mutex> lock(batch.mutex);
+    batch.done_cnt += done_cnt;
+    if (batch.done_cnt == batch.task_num) {
+        batch.done_cond.notify_all();
+    }
+}
+
+void TaskPool::_work_loop() {
+    while (true) {
+        std::shared_ptr<Batch> batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cond.wait(lock, [this]() { return is_stopped || !queue.empty(); });
+            if (queue.empty()) {
+                break; // 已停止且没有待执行的 batch
+            }
+            batch = queue.front();
+            queue.pop_front();
+        }
+        _run_batch(*batch);
+    }
+}
+
+}; // end of namespace tiny_engine
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
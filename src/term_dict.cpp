@@ -0,0 +1,108 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    term_dict.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 23:12:04
+*   @brief:
+*
+*****************************************************************/
+
+
+#include "../include/term_dict.h"
+#include <algorithm>
+
+namespace tiny_engine {
+
+TermDict::TermDict() :
+    term_ids(std::make_shared<const TermIdMap>()),
+    pending_cnt(0),
+    next_id(0) {}
+
+TermDict& TermDict::get_instance() {
+    static TermDict dict;
+    return dict;
+}
+
+uint32_t TermDict::add_term(std::size_t term_sign) {
+    // 建库时大部分 term 已在快照中, 不必加锁
+    auto snapshot = std::atomic_load(&term_ids);
+    auto iter = snapshot->find(term_sign);
+    if (iter != snapshot->end()) {
+        return iter->second;
+    }
+    std::lock_guard<std::mutex> lock(write_mutex);
+    snapshot = std::atomic_load(&term_ids);
+    iter = snapshot->find(term_sign);
+    if (iter != snapshot->end()) {
+        return iter->second;
+    }
+    auto pending_iter = pending.find(term_sign);
+    if (pending_iter != pending.end()) {
+        return pending_iter->second;
+    }
+    auto term_id = next_id.fetch_add(1);
+    pending.insert(std::make_pair(term_sign, term_id));
+    pending_cnt = pending.size();
+    if (pending.size() >= std::max(MIN_PUBLISH_NUM::value,
+                snapshot->size() / PUBLISH_RATIO::value)) {
+        _publish_locked();
+    }
+    return term_id;
+}
+
+uint32_t TermDict::get_term_id(std::size_t term_sign) const {
+    // 先读 pending_cnt 再取快照, 见 pending_cnt 的注释
+    bool has_pending = pending_cnt.load() > 0;
+    auto snapshot = std::atomic_load(&term_ids);
+    auto iter = snapshot->find(term_sign);
+    if (iter != snapshot->end()) {
+        return iter->second;
+    }
+    if (!has_pending) {
+        return INVALID_ID::value;
+    }
+    std::lock_guard<std::mutex> lock(write_mutex);
+    auto pending_iter = pending.find(term_sign);
+    if (pending_iter != pending.end()) {
+        return pending_iter->second;
+    }
+    snapshot = std::atomic_load(&term_ids); // 期间可能已发布
+    iter = snapshot->find(term_sign);
+    return iter != snapshot->end() ? iter->second : INVALID_ID::value;
+}
+
+void TermDict::add_terms(std::vector<TermNode> &terms) {
+    for (auto &term : terms) {
+        term.term_id = add_term(term.token_sign);
+    }
+}
+
+void TermDict::resolve_terms(std::vector<TermNode> &terms) const {
+    for (auto &term : terms) {
+        term.term_id = get_term_id(term.token_sign);
+    }
+}
+
+void TermDict::publish() {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    _publish_locked();
+}
+
+void TermDict::_publish_locked() {
+    if (pending.empty()) {
+        return;
+    }
+    auto snapshot = std::make_shared<TermIdMap>(*std::atomic_load(&term_ids));
+    snapshot->insert(pending.begin(), pending.end());
+    std::atomic_store(&term_ids, std::shared_ptr<const TermIdMap>(snapshot));
+    pending.clear();
+    pending_cnt = 0;
+}
+
+std::size_t TermDict::size() const {
+    return next_id.load();
+}
+
+}; // end of namespace tiny_engine
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -20,7 +20,9 @@ uint32_t TimeUtil::get_curr_timestamp() {
 std::string TimeUtil::get_curr_format_time(const std::string &fmt) {
     time_t curr_time = time(nullptr);
     char fmt_time[MAX_BUFF_SIZE::value];
-    strftime(fmt_time, sizeof(fmt_time), fmt.c_str(), localtime(&curr_time));
+    struct tm curr_tm;
+    // 每条日志都会调用, 用可重入的 localtime_r
+    strftime(fmt_time, sizeof(fmt_time), fmt.c_str(), localtime_r(&curr_time, &curr_tm));
     return std::string(fmt_time);
 }
 
@@ -54,6 +54,7 @@ bool XGBoostMgr::load_feature_map(const string &fpath) {
     if (!feature_map.empty()) {
         feature_map.clear();
     }
+    column_features.clear();
     if (!FileUtil::is_readable(fpath)) {
         LOG_WARNING("file[%s] is not exist/readable", fpath.c_str());
         return false;
@@ -63,7 +64,8 @@ bool XGBoostMgr::load_feature_map(const string &fpath) {
     std::vector<std::string> arr;
     auto index = 0;
     while (std::getline(ifs, line)) {
-        if (StrUtil::is_start_with(line, "#")) {
+        // 空行时 split 不清空 arr, 需先跳过, 否则会把上一行的特征再加一列
+        if (line.empty() || StrUtil::is_start_with(line, "#")) {
             continue;
         }
         StrUtil::split(line, '\t', arr);
@@ -74,6 +76,12 @@ bool XGBoostMgr::load_feature_map(const string &fpath) {
         // auto fid = std::stoi(arr[0]);
         auto &fname = arr[1];
         feature_map[fname] = fid;
+        FEATURE_ID feature_id = FEATURE_NUM;
+        if (!FeatureMgr::get_id(fname, feature_id)) {
+            LOG_WARNING("feature[%s] in %s is not calculated, treat as missing",
+                    fname.c_str(), fpath.c_str());
+        }
+        column_features.push_back(feature_id);
         index += 1;
     }
     LOG_INFO("load %lu items from %s, feature_map[%s]",
@@ -110,47 +118,39 @@ bool XGBoostMgr::load_model(const string &fpath) {
 }
 
 void XGBoostMgr::trans_to_svm_data(
-        const unordered_map<string, float> &features,
+        const FeatureMgr &features,
         unordered_map<int, float> &out) const {
     if (!out.empty()) {
         out.clear();
     }
-    EXPECT_FALSE_OR_RETURN(features.empty(), RETURN_ON_VOID);
+    EXPECT_FALSE_OR_RETURN(features.is_empty(), RETURN_ON_VOID);
 
-    for (auto it = features.begin(); it != features.end(); ++it) {
-        auto &fname = it->first;
-        auto iter = feature_map.find(fname);
-        if (iter == feature_map.end()) {
-            continue;
+    for (std::size_t column = 0; column < column_features.size(); ++column) {
+        auto fid = column_features[column];
+        if (FEATURE_NUM != fid && features.has_feature(fid)) {
+            out[column] = features.values()[fid];
         }
-        auto fvalue = it->second;
-        auto fid = iter->second;
-        out[fid] = fvalue;
     }
 }
 
 bool XGBoostMgr::trans_to_dmatrix(
-        const vector<unordered_map<string, float>> &features,
+        const vector<const FeatureMgr*> &features,
         DMatrixHandle &out) const {
     EXPECT_FALSE_OR_RETURN_LOGGED(features.empty(), false, "input feature empty!");
     const auto nrow = features.size();
-    const auto ncolumn = feature_map.size();
-    float data[nrow][ncolumn];
-    memset(data, missing_value, sizeof(data));
+    const auto ncolumn = column_features.size();
+    vector<float> data(nrow * ncolumn, missing_value);
     for (decltype(features.size()) i = 0; i < nrow; ++i) {
-        const auto &name_value_map = features[i];
-        for (auto it = name_value_map.begin(); it != name_value_map.end(); ++it) {
-            auto &fname = it->first;
-            auto iter = feature_map.find(fname);
-            if (iter == feature_map.end()) {
-                continue;
+        auto row = data.data() + i * ncolumn;
+        auto values = features[i]->values();
+        for (std::size_t column = 0; column < ncolumn; ++column) {
+            auto fid = column_features[column];
+            if (FEATURE_NUM != fid && features[i]->has_feature(fid)) {
+                row[column] = values[fid];
             }
-            auto fid = iter->second;
-            auto fvalue = it->second;
-            data[i][fid] = fvalue;
         }
     }
-    auto ret = XGDMatrixCreateFromMat(reinterpret_cast<float*>(data),
+    auto ret = XGDMatrixCreateFromMat(data.data(),
                                       static_cast<bst_ulong>(nrow),
                                       static_cast<bst_ulong>(ncolumn),
                                       missing_value, &out);
@@ -159,7 +159,7 @@ bool XGBoostMgr::trans_to_dmatrix(
 }
 
 bool XGBoostMgr::predict(
-        const vector<unordered_map<string, float>> &features,
+        const vector<const FeatureMgr*> &features,
         vector<float> &out) {
     if (!out.empty()) {
         out.clear();
@@ -169,7 +169,8 @@ bool XGBoostMgr::predict(
     DMatrixHandle dmatrix;
     trans_to_dmatrix(features, dmatrix);
 
-    // xgb predict
+    // xgb predict, 持锁直到拷贝完 booster 中的输出
+    std::lock_guard<std::mutex> lock(predict_mutex);
     bst_ulong out_len;
     const float* pred_out = nullptr;
     auto ret = XGBoosterPredict(xgb_handler, dmatrix, 0, 0, &out_len, &pred_out);
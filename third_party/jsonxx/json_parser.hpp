@@ -360,32 +360,24 @@ namespace jsonxx
 
                     case 'u':
                     {
-                        // unicode escapes
-                        uint16_t byte = 0;
-
-                        for (const auto factor : {12, 8, 4, 0})
+                        // unicode escapes, stored as utf-8
+                        uint32_t code = 0;
+                        if (!scan_unicode_escape(code))
                         {
-                            const auto n = read_next();
-                            if (n >= L'0' && n <= L'9')
-                            {
-                                byte += ((n - L'0') << factor);
-                            }
-                            else if (n >= L'A' && n <= L'F')
-                            {
-                                byte += ((n - L'A' + 10) << factor);
-                            }
-                            else if (n >= L'a' && n <= L'f')
-                            {
-                                byte += ((n - L'a' + 10) << factor);
-                            }
-                            else
+                            return token_type::parse_error;
+                        }
+                        if (code >= 0xD800 && code <= 0xDBFF)
+                        {
+                            // surrogate pair: '\uD8xx' must be followed by '\uDCxx'
+                            uint32_t low = 0;
+                            if (read_next() != '\\' || read_next() != 'u' || !scan_unicode_escape(low)
+                                || low < 0xDC00 || low > 0xDFFF)
                             {
-                                // '\u' must be followed by 4 hex digits
                                 return token_type::parse_error;
                             }
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
                         }
-
-                        string_buffer.push_back(char_traits::to_char_type(byte));
+                        append_utf8(code);
                         break;
                     }
 
@@ -399,7 +391,8 @@ namespace jsonxx
 
                 default:
                 {
-                    if (ch > 0x1F && ch < 0x7F)
+                    // non-ascii bytes (e.g. utf-8) are kept as is, char may be signed
+                    if ((ch > 0x1F && ch < 0x7F) || ch < 0 || ch > 0x7F)
                     {
                         string_buffer.push_back(char_traits::to_char_type(ch));
                         break;
@@ -413,6 +406,59 @@ namespace jsonxx
             }
         }
 
+        bool scan_unicode_escape(uint32_t &code)
+        {
+            code = 0;
+            for (const auto factor : {12, 8, 4, 0})
+            {
+                const auto n = read_next();
+                if (n >= L'0' && n <= L'9')
+                {
+                    code += ((n - L'0') << factor);
+                }
+                else if (n >= L'A' && n <= L'F')
+                {
+                    code += ((n - L'A' + 10) << factor);
+                }
+                else if (n >= L'a' && n <= L'f')
+                {
+                    code += ((n - L'a' + 10) << factor);
+                }
+                else
+                {
+                    // '\u' must be followed by 4 hex digits
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void append_utf8(uint32_t code)
+        {
+            if (code < 0x80)
+            {
+                string_buffer.push_back(char_traits::to_char_type(code));
+            }
+            else if (code < 0x800)
+            {
+                string_buffer.push_back(char_traits::to_char_type(0xC0 | (code >> 6)));
+                string_buffer.push_back(char_traits::to_char_type(0x80 | (code & 0x3F)));
+            }
+            else if (code < 0x10000)
+            {
+                string_buffer.push_back(char_traits::to_char_type(0xE0 | (code >> 12)));
+                string_buffer.push_back(char_traits::to_char_type(0x80 | ((code >> 6) & 0x3F)));
+                string_buffer.push_back(char_traits::to_char_type(0x80 | (code & 0x3F)));
+            }
+            else
+            {
+                string_buffer.push_back(char_traits::to_char_type(0xF0 | (code >> 18)));
+                string_buffer.push_back(char_traits::to_char_type(0x80 | ((code >> 12) & 0x3F)));
+                string_buffer.push_back(char_traits::to_char_type(0x80 | ((code >> 6) & 0x3F)));
+                string_buffer.push_back(char_traits::to_char_type(0x80 | (code & 0x3F)));
+            }
+        }
+
         token_type scan_number()
         {
             is_negative = false;
@@ -378,8 +378,9 @@ namespace jsonxx
 
                 default:
                 {
-                    const auto char_byte = static_cast<uint16_t>(ch);
-                    if ((char_byte > 0x1F) && (char_byte < 0x7F))
+                    // non-ascii bytes (e.g. utf-8) are written as is
+                    const auto char_byte = static_cast<uint16_t>(static_cast<unsigned char>(ch));
+                    if (char_byte > 0x1F && char_byte != 0x7F)
                     {
                         out->write(ch);
                     }
@@ -0,0 +1,241 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    posting_bench.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/18 17:42:36
+*   @brief:   倒排遍历的 microbenchmark: 每个 query 的堆内存申请次数及耗时
+*
+*   构造长度按 zipf 分布的拉链, 随机生成 2~4 个 term 的 query, 对比:
+*     copy:   每个 term 拷贝整条拉链后遍历(旧的召回写法)
+*     decode: 每个 term 解码到 vector 后遍历 / 求交(旧的短语求交写法)
+*     cursor: PostingCursor 直接在压缩拉链上遍历 / 用 advance_to 求交(只申请存放游标的 vector)
+*   用法: make bench && ./bin/posting_bench [query 数]
+*
+*****************************************************************/
+
+#include "../include/posting_list.h"
+#include "../include/time_util.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <algorithm>
+
+namespace {
+// 统计整个进程的 operator new 调用
+std::size_t g_alloc_cnt = 0;
+std::size_t g_alloc_bytes = 0;
+}
+
+void* operator new(std::size_t size) {
+    ++g_alloc_cnt;
+    g_alloc_bytes += size;
+    void* ptr = std::malloc(size > 0 ? size : 1);
+    if (nullptr == ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+// 不内联, 否则 -O2 时 GCC 在调用处看到 operator new 的指针被 free, 报 -Wmismatched-new-delete
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace tiny_engine {
+
+class PostingBench {
+public:
+    using DOC_NUM = std::integral_constant<uint32_t, 1000000>;
+    using TERM_NUM = std::integral_constant<uint32_t, 2000>;
+    using MAX_LIST_LEN = std::integral_constant<uint32_t, 200000>;
+
+    using Query = std::vector<uint32_t>; // term 下标
+
+    static void build(std::vector<PostingList> &lists) {
+        std::mt19937 rng(20261018);
+        lists.resize(TERM_NUM::value);
+        std::vector<uint32_t> doc_ids;
+        for (uint32_t i = 0; i < TERM_NUM::value; ++i) {
+            auto len = std::max<uint32_t>(MAX_LIST_LEN::value / (i + 1), 16);
+            std::uniform_int_distribution<uint32_t> dist(0, DOC_NUM::value - 1);
+            doc_ids.clear();
+            for (uint32_t k = 0; k < len; ++k) {
+                doc_ids.push_back(dist(rng));
+            }
+            std::sort(doc_ids.begin(), doc_ids.end());
+            doc_ids.erase(std::unique(doc_ids.begin(), doc_ids.end()), doc_ids.end());
+            lists[i].encode(doc_ids);
+        }
+    }
+
+    // term 被查询的概率与拉链长度一致, 高频 term 更常出现
+    static void make_queries(std::size_t query_num, std::vector<Query> &queries) {
+        std::mt19937 rng(4596);
+        std::vector<double> weights;
+        for (uint32_t i = 0; i < TERM_NUM::value; ++i) {
+            weights.push_back(1.0 / (i + 1));
+        }
+        std::discrete_distribution<uint32_t> term_dist(weights.begin(), weights.end());
+        std::uniform_int_distribution<uint32_t> len_dist(2, 4);
+        queries.resize(query_num);
+        for (auto &query : queries) {
+            auto len = len_dist(rng);
+            for (uint32_t k = 0; k < len; ++k) {
+                query.push_back(term_dist(rng));
+            }
+        }
+    }
+
+    // 遍历 query 中每个 term 的拉链, 返回 doc_id 之和
+    static uint64_t scan_by_copy(const std::vector<PostingList> &lists, const Query &query) {
+        uint64_t sum = 0;
+        for (auto term : query) {
+            auto docs = lists[term];
+            for (auto doc_id : docs) {
+                sum += doc_id;
+            }
+        }
+        return sum;
+    }
+
+    static uint64_t scan_by_decode(const std::vector<PostingList> &lists, const Query &query) {
+        uint64_t sum = 0;
+        std::vector<uint32_t> docs;
+        for (auto term : query) {
+            lists[term].decode(docs);
+            for (auto doc_id : docs) {
+                sum += doc_id;
+            }
+        }
+        return sum;
+    }
+
+    static uint64_t scan_by_cursor(const std::vector<PostingList> &lists, const Query &query) {
+        uint64_t sum = 0;
+        for (auto term : query) {
+            for (PostingCursor cursor(lists[term]); !cursor.is_end(); cursor.next()) {
+                sum += cursor.doc_id();
+            }
+        }
+        return sum;
+    }
+
+    // 所有 term 的拉链求交, 返回交集 doc_id 之和
+    static uint64_t intersect_by_decode(const std::vector<PostingList> &lists,
+            const Query &query) {
+        std::vector<std::vector<uint32_t>> docs(query.size());
+        std::size_t shortest = 0;
+        for (std::size_t i = 0; i < query.size(); ++i) {
+            lists[query[i]].decode(docs[i]);
+            if (docs[i].size() < docs[shortest].size()) {
+                shortest = i;
+            }
+        }
+        uint64_t sum = 0;
+        std::vector<std::size_t> offsets(query.size(), 0);
+        for (auto doc_id : docs[shortest]) {
+            bool is_all_hit = true;
+            for (std::size_t i = 0; i < query.size() && is_all_hit; ++i) {
+                auto pos = std::lower_bound(docs[i].begin() + offsets[i], docs[i].end(), doc_id);
+                offsets[i] = pos - docs[i].begin();
+                is_all_hit = pos != docs[i].end() && *pos == doc_id;
+            }
+            if (is_all_hit) {
+                sum += doc_id;
+            }
+        }
+        return sum;
+    }
+
+    static uint64_t intersect_by_cursor(const std::vector<PostingList> &lists,
+            const Query &query) {
+        std::vector<PostingCursor> cursors;
+        cursors.reserve(query.size());
+        for (auto term : query) {
+            cursors.push_back(PostingCursor(lists[term]));
+        }
+        std::size_t shortest = 0;
+        for (std::size_t i = 0; i < query.size(); ++i) {
+            if (cursors[i].cost() < cursors[shortest].cost()) {
+                shortest = i;
+            }
+        }
+        uint64_t sum = 0;
+        auto &lead = cursors[shortest];
+        while (!lead.is_end()) {
+            auto doc_id = lead.doc_id();
+            auto next_doc = doc_id;
+            for (std::size_t i = 0; i < query.size() && next_doc == doc_id; ++i) {
+                next_doc = cursors[i].advance_to(doc_id);
+            }
+            if (next_doc != doc_id) {
+                lead.advance_to(next_doc);
+                continue;
+            }
+            sum += doc_id;
+            lead.next();
+        }
+        return sum;
+    }
+
+    using Func = uint64_t (*)(const std::vector<PostingList>&, const Query&);
+
+    static uint64_t run(const char* name,
+            Func func,
+            const std::vector<PostingList> &lists,
+            const std::vector<Query> &queries) {
+        uint64_t checksum = 0;
+        auto alloc_cnt = g_alloc_cnt;
+        auto alloc_bytes = g_alloc_bytes;
+        auto begin = TimeUtil::get_curr_timeval();
+        for (const auto &query : queries) {
+            checksum += func(lists, query);
+        }
+        auto end = TimeUtil::get_curr_timeval();
+        auto cost_us = TimeUtil::timeval_diff_us(&begin, &end);
+        double query_num = queries.size();
+        printf("%-20s allocs/query=%10.2f  KB/query=%10.2f  us/query=%10.2f  checksum=%lu\n",
+                name,
+                (g_alloc_cnt - alloc_cnt) / query_num,
+                (g_alloc_bytes - alloc_bytes) / 1024.0 / query_num,
+                cost_us / query_num,
+                checksum);
+        return checksum;
+    }
+
+private:
+    PostingBench();
+};
+
+}; // end of namespace tiny_engine
+
+int main(int argc, char** argv) {
+    using tiny_engine::PostingBench;
+    std::size_t query_num = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    std::vector<tiny_engine::PostingList> lists;
+    std::vector<PostingBench::Query> queries;
+    PostingBench::build(lists);
+    PostingBench::make_queries(query_num, queries);
+
+    auto scan_sum = PostingBench::run("scan/copy", PostingBench::scan_by_copy, lists, queries);
+    PostingBench::run("scan/decode", PostingBench::scan_by_decode, lists, queries);
+    auto cursor_sum = PostingBench::run("scan/cursor",
+            PostingBench::scan_by_cursor, lists, queries);
+    auto inter_sum = PostingBench::run("intersect/decode",
+            PostingBench::intersect_by_decode, lists, queries);
+    auto inter_cursor_sum = PostingBench::run("intersect/cursor",
+            PostingBench::intersect_by_cursor, lists, queries);
+    if (scan_sum != cursor_sum || inter_sum != inter_cursor_sum) {
+        printf("checksum mismatch\n");
+        return 1;
+    }
+    return 0;
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
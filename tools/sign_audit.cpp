@@ -0,0 +1,182 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    sign_audit.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/19 00:26:45
+*   @brief:   检查语料中 doc/term 签名的冲突
+*
+*   按配置切词 INDEX_FILE 中所有 title(与建库一致, 转小写后计算签名), 收集不同的 url 及 term,
+*   另外可以指定若干词表文件(每行第一列为词, 如 jieba 词典), 分别检查:
+*     64 位签名(StrUtil::str_to_sign)是否有冲突, 有冲突时逐条输出并返回 1;
+*     取低 32 位时的冲突数, 与均匀分布的期望值 n(n-1)/2^33 对比, 用于检查分布是否均匀;
+*     切词时批量计算的签名与逐个计算的是否一致.
+*   最后对比 std::hash / HashUtil::hash64 / 批量接口计算全部 term 的耗时
+*   用法: make audit && ./bin/sign_audit conf/sys.conf [词表文件 ...]
+*
+*****************************************************************/
+
+#include "../include/config_util.h"
+#include "../include/segment.h"
+#include "../include/hash_util.h"
+#include "../include/time_util.h"
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <unordered_set>
+#include <algorithm>
+
+namespace tiny_engine {
+
+class SignAudit {
+public:
+    using SignStrPair = std::pair<uint64_t, std::string>;
+
+    /**
+     * @brief 输出 64 位冲突及低 32 位冲突统计
+     * @return 64 位签名的冲突数
+     */
+    static std::size_t check(const char* name, const std::unordered_set<std::string> &strs) {
+        std::vector<SignStrPair> signs;
+        signs.reserve(strs.size());
+        for (const auto &str : strs) {
+            signs.push_back(std::make_pair(StrUtil::str_to_sign(str), str));
+        }
+        std::sort(signs.begin(), signs.end());
+        std::size_t collision_cnt = 0;
+        for (std::size_t i = 1; i < signs.size(); ++i) {
+            if (signs[i].first == signs[i - 1].first) {
+                ++collision_cnt;
+                printf("  COLLISION %s sign=%016lx [%s] [%s]\n", name, signs[i].first,
+                        signs[i - 1].second.c_str(), signs[i].second.c_str());
+            }
+        }
+        std::vector<uint32_t> low_signs;
+        low_signs.reserve(signs.size());
+        for (const auto &item : signs) {
+            low_signs.push_back(static_cast<uint32_t>(item.first));
+        }
+        std::sort(low_signs.begin(), low_signs.end());
+        std::size_t low_collision_cnt = 0;
+        for (std::size_t i = 1; i < low_signs.size(); ++i) {
+            low_collision_cnt += low_signs[i] == low_signs[i - 1] ? 1 : 0;
+        }
+        double n = static_cast<double>(signs.size());
+        printf("%-6s distinct=%lu collision64=%lu collision32=%lu (expected %.1f)\n",
+                name, signs.size(), collision_cnt, low_collision_cnt,
+                n * (n - 1) / 8589934592.0);
+        return collision_cnt;
+    }
+
+    // 三种方式各计算一遍所有 term 的签名, 输出每个 term 的耗时
+    static void bench(const std::vector<std::vector<std::string>> &titles, std::size_t term_cnt) {
+        EXPECT_GT_OR_RETURN(term_cnt, 0, RETURN_ON_VOID);
+        uint64_t checksum = 0;
+        std::vector<uint64_t> signs;
+        auto time_begin = TimeUtil::get_curr_timeval();
+        for (const auto &words : titles) {
+            for (const auto &word : words) {
+                checksum += std::hash<std::string>()(word);
+            }
+        }
+        auto time_std = TimeUtil::get_curr_timeval();
+        for (const auto &words : titles) {
+            for (const auto &word : words) {
+                checksum += HashUtil::hash64(word);
+            }
+        }
+        auto time_single = TimeUtil::get_curr_timeval();
+        for (const auto &words : titles) {
+            HashUtil::hash64(words, signs);
+            for (auto sign : signs) {
+                checksum += sign;
+            }
+        }
+        auto time_bulk = TimeUtil::get_curr_timeval();
+        auto ns_per_term = [term_cnt](struct timeval begin, struct timeval end) {
+            return TimeUtil::timeval_diff_us(&begin, &end) * 1000.0 / term_cnt;
+        };
+        printf("hash %lu terms: std::hash %.1f ns, hash64 %.1f ns, bulk %.1f ns (checksum %lu)\n",
+                term_cnt, ns_per_term(time_begin, time_std), ns_per_term(time_std, time_single),
+                ns_per_term(time_single, time_bulk), checksum);
+    }
+};
+
+}; // end of namespace tiny_engine
+
+int main(int argc, char** argv) {
+    using namespace tiny_engine;
+    if (argc < 2) {
+        printf("usage: %s <conf> [term_file ...]\n", argv[0]);
+        return 1;
+    }
+    auto configs = std::make_shared<ConfigUtil>(argv[1]);
+    auto wordseg = std::make_shared<Segment>();
+    std::string index_file;
+    if (!configs->init() || !wordseg->init(configs)
+            || !configs->get_value("INDEX_FILE", index_file)) {
+        printf("init from %s failed\n", argv[1]);
+        return 1;
+    }
+    std::ifstream ifs(index_file.c_str());
+    if (!ifs.is_open()) {
+        printf("open %s failed\n", index_file.c_str());
+        return 1;
+    }
+
+    // 1. 切词收集 url 及 term; 同时核对切词时的签名
+    std::unordered_set<std::string> urls;
+    std::unordered_set<std::string> terms;
+    std::vector<std::vector<std::string>> titles;
+    std::size_t term_cnt = 0;
+    std::size_t mismatch_cnt = 0;
+    std::string line;
+    std::vector<std::string> vec;
+    std::vector<TermNode> tokens;
+    std::vector<uint32_t> chars;
+    while (std::getline(ifs, line)) {
+        StrUtil::split(line, '\t', vec);
+        if (vec.size() < 3 || !wordseg->get_token(vec[1], tokens)) {
+            continue; // query \t title \t url \t label
+        }
+        urls.insert(vec[2]);
+        StrUtil::utf8_to_unicode(vec[1], chars);
+        std::vector<std::string> words;
+        for (const auto &token : tokens) {
+            auto word = StrUtil::to_lower_case(
+                    StrUtil::unicode_to_utf8(chars, token.offset, token.length));
+            mismatch_cnt += StrUtil::str_to_sign(word) != token.token_sign ? 1 : 0;
+            terms.insert(word);
+            words.push_back(std::move(word));
+        }
+        term_cnt += words.size();
+        titles.push_back(std::move(words));
+    }
+    printf("%s: %lu titles, %lu terms, sign mismatch=%lu\n",
+            index_file.c_str(), titles.size(), term_cnt, mismatch_cnt);
+
+    // 2. 词表中的词
+    for (int i = 2; i < argc; ++i) {
+        std::ifstream term_ifs(argv[i]);
+        if (!term_ifs.is_open()) {
+            printf("open %s failed\n", argv[i]);
+            return 1;
+        }
+        std::size_t cnt = 0;
+        while (std::getline(term_ifs, line)) {
+            auto word = line.substr(0, line.find_first_of(" \t"));
+            if (!word.empty()) {
+                terms.insert(StrUtil::to_lower_case(word));
+                ++cnt;
+            }
+        }
+        printf("%s: %lu terms\n", argv[i], cnt);
+    }
+
+    // 3. 冲突检查及耗时
+    auto collision_cnt = SignAudit::check("url", urls) + SignAudit::check("term", terms);
+    SignAudit::bench(titles, term_cnt);
+    return collision_cnt > 0 || mismatch_cnt > 0 ? 1 : 0;
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -0,0 +1,286 @@
+/*****************************************************************
+*   Copyright (C) 2026  Inc. All rights reserved.
+*
+*   @file:    string_dist_bench.cpp
+*   @author:  marinyoung@163.com
+*   @date:    2026/10/19 10:12:05
+*   @brief:   编辑距离/最长公共子序列/最长公共子串的 microbenchmark
+*
+*   随机生成 query/title 对(字节串、unicode 码点及 term 签名序列三种粒度), 对比:
+*     dp:     旧的二维 DP 写法, 每次调用申请 vector<vector<int>>
+*     math:   MathUtil 中的位并行/对角线实现
+*   并校验两者结果一致; 最后用随机长度(含超过位并行上限)的序列做正确性校验
+*   用法: make bench && ./bin/string_dist_bench [pair 数]
+*
+*****************************************************************/
+
+#include "../include/math_util.h"
+#include "../include/str_util.h"
+#include "../include/time_util.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+
+namespace {
+// 统计整个进程的 operator new 调用
+std::size_t g_alloc_cnt = 0;
+}
+
+void* operator new(std::size_t size) {
+    ++g_alloc_cnt;
+    void* ptr = std::malloc(size > 0 ? size : 1);
+    if (nullptr == ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+namespace tiny_engine {
+
+class StringDistBench {
+public:
+    using TermSeq = std::vector<std::size_t>;
+    using CharSeq = std::vector<uint32_t>;
+
+    template <typename Type>
+    struct Pair {
+        Type query;
+        Type title;
+    };
+
+    // 旧实现, 作为基线及正确性参照
+    template <typename Type>
+    static int dp_edit_distance(const Type &first, const Type &second) {
+        const auto ROW = 1 + first.size();
+        const auto COLUMN = 1 + second.size();
+        std::vector<std::vector<int>> dp(ROW, std::vector<int>(COLUMN, 0));
+        for (std::size_t i = 0; i < ROW; ++i) {
+            dp[i][0] = i;
+        }
+        for (std::size_t j = 0; j < COLUMN; ++j) {
+            dp[0][j] = j;
+        }
+        for (std::size_t i = 1; i < ROW; ++i) {
+            for (std::size_t j = 1; j < COLUMN; ++j) {
+                dp[i][j] = (first[i - 1] == second[j - 1] ? dp[i - 1][j - 1] : dp[i - 1][j - 1] + 1);
+                dp[i][j] = std::min(dp[i][j], std::min(dp[i - 1][j] + 1, dp[i][j - 1] + 1));
+            }
+        }
+        return dp[ROW - 1][COLUMN - 1];
+    }
+
+    template <typename Type>
+    static int dp_lcseq(const Type &first, const Type &second) {
+        std::vector<std::vector<int>> dp(first.size() + 1, std::vector<int>(second.size() + 1, 0));
+        for (std::size_t i = 1; i < first.size() + 1; ++i) {
+            for (std::size_t j = 1; j < second.size() + 1; ++j) {
+                if (first[i - 1] == second[j - 1]) {
+                    dp[i][j] = dp[i - 1][j - 1] + 1;
+                } else {
+                    dp[i][j] = std::max(dp[i][j - 1], dp[i - 1][j]);
+                }
+            }
+        }
+        return dp[first.size()][second.size()];
+    }
+
+    template <typename Type>
+    static int dp_lcstr(const Type &first, const Type &second) {
+        int result = -1;
+        std::vector<std::vector<int>> dp(first.size(), std::vector<int>(second.size(), 0));
+        for (std::size_t i = 0; i < first.size(); ++i) {
+            dp[i][0] = (first[i] == second[0] ? 1 : 0);
+        }
+        for (std::size_t j = 0; j < second.size(); ++j) {
+            dp[0][j] = (first[0] == second[j] ? 1 : 0);
+        }
+        for (std::size_t i = 0; i < first.size(); ++i) {
+            for (std::size_t j = 0; j < second.size(); ++j) {
+                if (i < 1 || j < 1) {
+                    result = std::max(result, dp[i][j]);
+                    continue;
+                }
+                dp[i][j] = (first[i] == second[j] ? dp[i - 1][j - 1] + 1 : 0);
+                result = std::max(dp[i][j], result);
+            }
+        }
+        return result;
+    }
+
+    template <typename Type>
+    static int math_edit_distance(const Type &first, const Type &second) {
+        return MathUtil::edit_distance(first, second);
+    }
+
+    template <typename Type>
+    static int math_lcseq(const Type &first, const Type &second) {
+        return MathUtil::longest_common_subsequence(first, second);
+    }
+
+    template <typename Type>
+    static int math_lcstr(const Type &first, const Type &second) {
+        return MathUtil::longest_continuous_substring(first, second);
+    }
+
+    // 标题取自一个小词表, query 从标题中截取片段并做少量替换, 与线上的命中情况相近
+    static void make_pairs(std::size_t pair_num,
+            std::vector<Pair<std::string>> &str_pairs,
+            std::vector<Pair<CharSeq>> &char_pairs,
+            std::vector<Pair<TermSeq>> &term_pairs) {
+        std::mt19937 rng(20261019);
+        std::vector<std::string> vocab;
+        std::uniform_int_distribution<int> byte_dist(0x80, 0xbf);
+        for (int i = 0; i < 300; ++i) {
+            // 3 字节的 utf8 汉字, 同一个 term 由 1~3 个字组成
+            std::string term;
+            for (int k = 0; k < 1 + i % 3; ++k) {
+                term.push_back(static_cast<char>(0xe4 + i % 8));
+                term.push_back(static_cast<char>(byte_dist(rng)));
+                term.push_back(static_cast<char>(byte_dist(rng)));
+            }
+            vocab.push_back(term);
+        }
+        std::uniform_int_distribution<std::size_t> term_dist(0, vocab.size() - 1);
+        std::uniform_int_distribution<std::size_t> title_len_dist(6, 20);
+        std::uniform_int_distribution<std::size_t> query_len_dist(2, 6);
+        std::uniform_int_distribution<int> noise_dist(0, 3);
+        str_pairs.resize(pair_num);
+        char_pairs.resize(pair_num);
+        term_pairs.resize(pair_num);
+        for (std::size_t n = 0; n < pair_num; ++n) {
+            TermSeq title;
+            for (std::size_t k = title_len_dist(rng); k > 0; --k) {
+                title.push_back(term_dist(rng));
+            }
+            auto query_len = std::min(query_len_dist(rng), title.size());
+            std::uniform_int_distribution<std::size_t> begin_dist(0, title.size() - query_len);
+            auto begin = begin_dist(rng);
+            TermSeq query(title.begin() + begin, title.begin() + begin + query_len);
+            for (auto &term : query) {
+                if (0 == noise_dist(rng)) {
+                    term = term_dist(rng);
+                }
+            }
+            term_pairs[n].query = query;
+            term_pairs[n].title = title;
+            for (auto term : query) {
+                str_pairs[n].query += vocab[term];
+            }
+            for (auto term : title) {
+                str_pairs[n].title += vocab[term];
+            }
+            StrUtil::utf8_to_unicode(str_pairs[n].query, char_pairs[n].query);
+            StrUtil::utf8_to_unicode(str_pairs[n].title, char_pairs[n].title);
+        }
+    }
+
+    template <typename Type>
+    using Func = int (*)(const Type&, const Type&);
+
+    template <typename Type>
+    static uint64_t run(const char* name, Func<Type> func, const std::vector<Pair<Type>> &pairs) {
+        uint64_t checksum = 0;
+        auto alloc_cnt = g_alloc_cnt;
+        auto begin = TimeUtil::get_curr_timeval();
+        for (const auto &pair : pairs) {
+            checksum += func(pair.query, pair.title);
+        }
+        auto end = TimeUtil::get_curr_timeval();
+        auto cost_us = TimeUtil::timeval_diff_us(&begin, &end);
+        double pair_num = pairs.size();
+        printf("%-20s allocs/pair=%8.2f  ns/pair=%10.1f  checksum=%lu\n",
+                name,
+                (g_alloc_cnt - alloc_cnt) / pair_num,
+                cost_us * 1000.0 / pair_num,
+                checksum);
+        return checksum;
+    }
+
+    // 随机长度及字母表大小的序列, 覆盖单字/多字位并行及 DP 回退
+    static std::size_t check_random(std::size_t round_num) {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<std::size_t> len_dist(0, MathUtil::BIT_PARALLEL_WORDS::value * 64 + 80);
+        std::uniform_int_distribution<int> alpha_dist(1, 26);
+        std::size_t mismatch = 0;
+        for (std::size_t n = 0; n < round_num; ++n) {
+            auto alpha = alpha_dist(rng);
+            std::uniform_int_distribution<int> char_dist(0, alpha - 1);
+            std::string first(1 + len_dist(rng), 'a');
+            std::string second(1 + len_dist(rng), 'a');
+            for (auto &c : first) {
+                c = static_cast<char>('a' + char_dist(rng));
+            }
+            for (auto &c : second) {
+                c = static_cast<char>('a' + char_dist(rng));
+            }
+            TermSeq first_seq(first.begin(), first.end());
+            TermSeq second_seq(second.begin(), second.end());
+            CharSeq first_chars(first.begin(), first.end());
+            CharSeq second_chars(second.begin(), second.end());
+            auto edist = dp_edit_distance(first, second);
+            auto lcseq = dp_lcseq(first, second);
+            auto lcstr = dp_lcstr(first, second);
+            if (edist != MathUtil::edit_distance(first, second)
+                    || edist != MathUtil::edit_distance(first_seq, second_seq)
+                    || edist != MathUtil::edit_distance(first_chars, second_chars)
+                    || lcseq != MathUtil::longest_common_subsequence(first, second)
+                    || lcseq != MathUtil::longest_common_subsequence(first_seq, second_seq)
+                    || lcseq != MathUtil::longest_common_subsequence(first_chars, second_chars)
+                    || lcstr != MathUtil::longest_continuous_substring(first, second)
+                    || lcstr != MathUtil::longest_continuous_substring(first_seq, second_seq)
+                    || lcstr != MathUtil::longest_continuous_substring(first_chars, second_chars)) {
+                ++mismatch;
+            }
+        }
+        return mismatch;
+    }
+
+private:
+    StringDistBench();
+};
+
+}; // end of namespace tiny_engine
+
+int main(int argc, char** argv) {
+    using tiny_engine::StringDistBench;
+    std::size_t pair_num = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::vector<StringDistBench::Pair<std::string>> str_pairs;
+    std::vector<StringDistBench::Pair<StringDistBench::CharSeq>> char_pairs;
+    std::vector<StringDistBench::Pair<StringDistBench::TermSeq>> term_pairs;
+    StringDistBench::make_pairs(pair_num, str_pairs, char_pairs, term_pairs);
+
+    bool is_same = true;
+    is_same &= StringDistBench::run("str/edist/dp", StringDistBench::dp_edit_distance, str_pairs)
+        == StringDistBench::run("str/edist/math", StringDistBench::math_edit_distance, str_pairs);
+    is_same &= StringDistBench::run("str/lcseq/dp", StringDistBench::dp_lcseq, str_pairs)
+        == StringDistBench::run("str/lcseq/math", StringDistBench::math_lcseq, str_pairs);
+    is_same &= StringDistBench::run("str/lcstr/dp", StringDistBench::dp_lcstr, str_pairs)
+        == StringDistBench::run("str/lcstr/math", StringDistBench::math_lcstr, str_pairs);
+    is_same &= StringDistBench::run("char/edist/dp", StringDistBench::dp_edit_distance, char_pairs)
+        == StringDistBench::run("char/edist/math", StringDistBench::math_edit_distance, char_pairs);
+    is_same &= StringDistBench::run("char/lcseq/dp", StringDistBench::dp_lcseq, char_pairs)
+        == StringDistBench::run("char/lcseq/math", StringDistBench::math_lcseq, char_pairs);
+    is_same &= StringDistBench::run("char/lcstr/dp", StringDistBench::dp_lcstr, char_pairs)
+        == StringDistBench::run("char/lcstr/math", StringDistBench::math_lcstr, char_pairs);
+    is_same &= StringDistBench::run("term/edist/dp", StringDistBench::dp_edit_distance, term_pairs)
+        == StringDistBench::run("term/edist/math", StringDistBench::math_edit_distance, term_pairs);
+    is_same &= StringDistBench::run("term/lcseq/dp", StringDistBench::dp_lcseq, term_pairs)
+        == StringDistBench::run("term/lcseq/math", StringDistBench::math_lcseq, term_pairs);
+    is_same &= StringDistBench::run("term/lcstr/dp", StringDistBench::dp_lcstr, term_pairs)
+        == StringDistBench::run("term/lcstr/math", StringDistBench::math_lcstr, term_pairs);
+    auto mismatch = StringDistBench::check_random(20000);
+    if (!is_same || mismatch > 0) {
+        printf("checksum mismatch, random mismatch[%lu]\n", mismatch);
+        return 1;
+    }
+    printf("random check ok\n");
+    return 0;
+}
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */